@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../jsmn_stream.h"
+#include "../jsmn_stream_filter.h"
+#include "../jsmn_stream_ndjson.h"
+
+/*
+ * Measures the parse cost of string values of increasing length. The time per
+ * string byte stays flat when string scanning is linear in the string length.
+ * Then compares jsmn_stream_parse_buffer() and jsmn_stream_parse_indexed() on
+ * a pretty printed document, and the full event stream with a filter that
+ * subscribes to one field of each record. Last the elements of one large
+ * array are parsed on 1 to 16 threads, which scales only as far as the
+ * machine has cores.
+ *
+ * Build with a buffer that can hold the longest string:
+ *   gcc -O2 -DJSMN_STREAM_BUFFER_SIZE=65536 benchmark.c ../jsmn_stream.c ../jsmn_stream_filter.c \
+ *     ../jsmn_stream_ndjson.c -lpthread -o benchmark
+ */
+
+#define MIN_STRING_LENGTH (64U)
+#define MAX_STRING_LENGTH (32768U)
+#define BYTES_PER_RUN (16U * 1024U * 1024U)
+
+static size_t strings_seen;
+
+void count_string(const char *value, size_t length, void *user_arg) {
+    strings_seen++;
+}
+
+jsmn_stream_callbacks_t cbs = {
+    .string_callback = count_string
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t values_seen;
+
+void count_value(const char *value, size_t length, size_t offset, void *user_arg) {
+    values_seen++;
+}
+
+jsmn_stream_callbacks_t span_cbs = {
+    .object_key_span_callback = count_value,
+    .string_span_callback = count_value,
+    .primitive_span_callback = count_value
+};
+
+static int compare_indexed(void) {
+    const char *record =
+        "%s\n    {\n        \"id\": %d,\n        \"name\": \"user %d\",\n"
+        "        \"active\": true,\n        \"scores\": [\n            1.5,\n"
+        "            -2\n        ]\n    }";
+    char *json = malloc(BYTES_PER_RUN + 256);
+    size_t length = 0;
+    jsmn_stream_parser parser;
+
+    length += sprintf(json, "[");
+    for (int i = 0; length < BYTES_PER_RUN; i++) {
+        length += sprintf(json + length, record, i > 0 ? "," : "", i, i);
+    }
+    length += sprintf(json + length, "\n]");
+
+    printf("\n%12s %12s %12s\n", "function", "ns/byte", "MB/s");
+    for (int indexed = 0; indexed <= 1; indexed++) {
+        int r;
+
+        jsmn_stream_init(&parser, &span_cbs, NULL);
+        values_seen = 0;
+        double start = now_seconds();
+        if (indexed) {
+            r = jsmn_stream_parse_indexed(&parser, json, length, NULL);
+        } else {
+            r = jsmn_stream_parse_buffer(&parser, json, length, NULL);
+        }
+        double elapsed = now_seconds() - start;
+
+        if (r != 0 || values_seen == 0) {
+            return EXIT_FAILURE;
+        }
+        printf("%12s %12.3f %12.1f\n", indexed ? "indexed" : "buffer",
+            elapsed * 1e9 / length, length / elapsed / 1e6);
+    }
+
+    free(json);
+    return EXIT_SUCCESS;
+}
+
+static int compare_filter(void) {
+    const char *record =
+        "%s{\"id\": %d, \"name\": \"user %d\", \"profile\": {\"bio\": \"%s\", "
+        "\"links\": [\"https://example.com/%d\", \"https://example.org/%d\"], "
+        "\"settings\": {\"theme\": \"dark\", \"limits\": [1, 2, 3, 4, 5, 6, 7, 8]}}, "
+        "\"history\": [{\"at\": 1700000000, \"event\": \"login\"}, "
+        "{\"at\": 1700000100, \"event\": \"logout\"}]}";
+    const char *bio = "Writes parsers, reads \\\"manuals\\\" and keeps a long biography in every record";
+    const char *patterns[] = { "/*/id" };
+    char *json = malloc(BYTES_PER_RUN + 512);
+    size_t length = 0;
+
+    length += sprintf(json, "[");
+    for (int i = 0; length < BYTES_PER_RUN; i++) {
+        length += sprintf(json + length, record, i > 0 ? "," : "", i, i, bio, i, i);
+    }
+    length += sprintf(json + length, "]");
+
+    printf("\n%12s %12s %12s %12s\n", "events", "values", "ns/byte", "MB/s");
+    for (int filtered = 0; filtered <= 1; filtered++) {
+        jsmn_stream_filter_t filter;
+        jsmn_stream_parser parser;
+        int r;
+
+        values_seen = 0;
+        double start = now_seconds();
+        if (filtered) {
+            jsmn_stream_filter_init(&filter, patterns, 1, &span_cbs, NULL);
+            r = jsmn_stream_filter_parse(&filter, json, length, NULL);
+        } else {
+            jsmn_stream_init(&parser, &span_cbs, NULL);
+            r = jsmn_stream_parse_buffer(&parser, json, length, NULL);
+        }
+        double elapsed = now_seconds() - start;
+
+        if (r != 0 || values_seen == 0) {
+            return EXIT_FAILURE;
+        }
+        printf("%12s %12zu %12.3f %12.1f\n", filtered ? "/*/id" : "all", values_seen,
+            elapsed * 1e9 / length, length / elapsed / 1e6);
+    }
+
+    free(json);
+    return EXIT_SUCCESS;
+}
+
+#define MAX_THREADS (16U)
+
+/* Padded so that the workers do not share cache lines */
+static struct {
+    size_t elements;
+    char padding[56];
+} elements_seen[MAX_THREADS];
+
+void count_element(size_t start, size_t end, void *user_arg) {
+    ((size_t *)user_arg)[0]++;
+}
+
+jsmn_stream_action_t count_event(jsmn_stream_event_t event, const char *value, size_t length,
+    size_t offset, void *user_arg) {
+    if (event == JSMN_STREAM_EVENT_DOCUMENT_END) {
+        ((size_t *)user_arg)[0]++;
+    }
+    return JSMN_STREAM_CONTINUE;
+}
+
+static int compare_parallel(void) {
+    const char *record =
+        "%s{\"id\": %d, \"name\": \"user %d\", \"active\": true, \"scores\": [1.5, -2, %d],"
+        " \"note\": \"a \\\"quoted\\\" [text], with commas\"}";
+    jsmn_stream_callbacks_t element_cbs = { .document_end_callback = count_element };
+    jsmn_stream_callbacks_t event_cbs = { .event_callback = count_event };
+    void *worker_args[MAX_THREADS];
+    size_t runs = 4;
+    char *json = malloc(runs * BYTES_PER_RUN + 256);
+    size_t length = 0;
+    size_t elements = 0;
+
+    length += sprintf(json, "[");
+    for (int i = 0; length < runs * BYTES_PER_RUN; i++) {
+        length += sprintf(json + length, record, i > 0 ? ", " : "", i, i, i);
+        elements++;
+    }
+    length += sprintf(json + length, "]");
+    for (size_t t = 0; t < MAX_THREADS; t++) {
+        worker_args[t] = &elements_seen[t].elements;
+    }
+
+    printf("\n%12s %12s %12s %12s\n", "threads", "delivery", "ns/byte", "MB/s");
+    for (size_t threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        for (int ordered = 0; ordered <= 1; ordered++) {
+            jsmn_stream_ndjson_parallel_t config = {
+                .callbacks = ordered ? &event_cbs : &element_cbs,
+                .user_arg = &elements_seen[0].elements,
+                .worker_args = worker_args,
+                .threads = threads,
+                .ordered = ordered
+            };
+            size_t seen = 0;
+
+            memset(elements_seen, 0, sizeof(elements_seen));
+            double start = now_seconds();
+            int r = jsmn_stream_ndjson_parse_array_parallel(json, length, &config);
+            double elapsed = now_seconds() - start;
+
+            for (size_t t = 0; t < MAX_THREADS; t++) {
+                seen += elements_seen[t].elements;
+            }
+            if (r != 0 || seen != elements) {
+                return EXIT_FAILURE;
+            }
+            printf("%12zu %12s %12.3f %12.1f\n", threads, ordered ? "ordered" : "unordered",
+                elapsed * 1e9 / length, length / elapsed / 1e6);
+        }
+    }
+
+    free(json);
+    return EXIT_SUCCESS;
+}
+
+int main(void) {
+    char *json = malloc(MAX_STRING_LENGTH + 2);
+    jsmn_stream_parser parser;
+
+    printf("%12s %12s %12s\n", "length", "ns/byte", "MB/s");
+    for (size_t length = MIN_STRING_LENGTH; length <= MAX_STRING_LENGTH; length *= 2) {
+        size_t runs = BYTES_PER_RUN / length;
+
+        json[0] = '"';
+        memset(json + 1, 'x', length);
+        json[length + 1] = '"';
+
+        strings_seen = 0;
+        double start = now_seconds();
+        for (size_t run = 0; run < runs; run++) {
+            jsmn_stream_init(&parser, &cbs, NULL);
+            if (jsmn_stream_parse_buffer(&parser, json, length + 2, NULL) != 0) {
+                fprintf(stderr, "Parse failed, is JSMN_STREAM_BUFFER_SIZE large enough?\n");
+                return EXIT_FAILURE;
+            }
+        }
+        double elapsed = now_seconds() - start;
+
+        if (strings_seen != runs) {
+            return EXIT_FAILURE;
+        }
+        printf("%12zu %12.3f %12.1f\n", length, elapsed * 1e9 / (runs * length),
+            runs * length / elapsed / 1e6);
+    }
+
+    free(json);
+    if (compare_indexed() != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    if (compare_filter() != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    return compare_parallel();
+}
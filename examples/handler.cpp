@@ -0,0 +1,47 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+#include "../jsmn_stream.hpp"
+
+/*
+ * The C++ version of simple.c. The handler only implements the events it
+ * cares about, the parser calls them directly.
+ *
+ *   g++ -std=c++17 -O2 handler.cpp -o handler
+ */
+
+struct printing_handler {
+    int depth = 0;
+
+    void on_start_object() { depth++; }
+    void on_end_object() { depth--; }
+    void on_key(std::string_view key) {
+        printf("%*sObject key: %.*s\n", depth * 2, "", (int)key.size(), key.data());
+    }
+    void on_string(std::string_view value) {
+        printf("%*sString: %.*s\n", depth * 2, "", (int)value.size(), value.data());
+    }
+};
+
+int main(void) {
+    FILE *infile = fopen("example.json", "r");
+    if (infile == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    printing_handler handler;
+    jsmn_stream::basic_parser<printing_handler> parser(handler);
+
+    char chunk[64];
+    size_t read_count;
+    while ((read_count = fread(chunk, 1, sizeof(chunk), infile)) > 0) {
+        if (parser.parse(chunk, read_count) != 0) {
+            fclose(infile);
+            return EXIT_FAILURE;
+        }
+    }
+
+    fclose(infile);
+    return EXIT_SUCCESS;
+}
@@ -4,217 +4,223 @@
  */
 
 #include "jsmn_stream.h"
+#include "jsmn_stream_number.h"
+#include "jsmn_stream_simd.h"
 #include <stdbool.h>
+#include <string.h>
 
 #define JSMN_STREAM_CALLBACK(f, ...) if ((f) != NULL) { (f)(__VA_ARGS__); }
 
-static bool jsmn_stream_stack_push(jsmn_stream_parser *parser, jsmn_streamtype_t type) {
-	if (parser->stack_height >= JSMN_STREAM_MAX_DEPTH) {
-		return false;
-	}
-	parser->type_stack[parser->stack_height++] = type;
-	return true;
-}
+typedef void (* jsmn_stream_value_callback_t)(const char *value, size_t length,
+	void *user_arg);
+typedef void (* jsmn_stream_span_callback_t)(const char *value, size_t length,
+	size_t offset, void *user_arg);
 
-static void jsmn_stream_stack_pop(jsmn_stream_parser *parser) {
-	// We don't need to return the popped item, so just decrement height.
-	if (parser->stack_height > 0) parser->stack_height--;
+/**
+ * Returns the callback for a completed key, string or primitive.
+ */
+static jsmn_stream_value_callback_t jsmn_stream_value_callback(
+	jsmn_stream_parser *parser, jsmn_streamtype_t type) {
+	switch (type) {
+		case JSMN_STREAM_KEY:
+			return parser->callbacks->object_key_callback;
+		case JSMN_STREAM_STRING:
+			return parser->callbacks->string_callback;
+		default:
+			return parser->callbacks->primitive_callback;
+	}
 }
 
-static jsmn_streamtype_t jsmn_stream_stack_top(jsmn_stream_parser *parser) {
-	if (parser->stack_height == 0) {
-		return JSMN_STREAM_UNDEFINED;
+/**
+ * Returns the span callback for a completed key, string or primitive.
+ */
+static jsmn_stream_span_callback_t jsmn_stream_span_callback(
+	jsmn_stream_parser *parser, jsmn_streamtype_t type) {
+	switch (type) {
+		case JSMN_STREAM_KEY:
+			return parser->callbacks->object_key_span_callback;
+		case JSMN_STREAM_STRING:
+			return parser->callbacks->string_span_callback;
+		default:
+			return parser->callbacks->primitive_span_callback;
 	}
-	return parser->type_stack[parser->stack_height - 1];
 }
 
 /**
- * Fills next available token with JSON primitive.
+ * Returns true when a key or string is delivered decoded, see the decoded
+ * callbacks. They are off with the event callback.
  */
-static int jsmn_stream_parse_primitive(jsmn_stream_parser *parser, char cin) {
-	/* Leave space for the terminating null character */
-	if (parser->buffer_size == JSMN_STREAM_BUFFER_SIZE - 1) {
-		return JSMN_STREAM_ERROR_NOMEM;
+static bool jsmn_stream_has_decoded(jsmn_stream_parser *parser, jsmn_streamtype_t type) {
+	if (parser->callbacks->event_callback != NULL) {
+		return false;
 	}
-	parser->buffer[parser->buffer_size++] = cin;
-	size_t len = parser->buffer_size;
-	const char *js = parser->buffer;
-	for (int pos = 0; pos < len && js[pos] != '\0'; pos++) {
-		switch (js[pos]) {
-			case '\t' : case '\r' : case '\n' : case ' ' :
-			case ','  : case ']'  : case '}' :
-				goto found;
-		}
-		if (js[pos] < 32 || js[pos] >= 127) {
-			return JSMN_STREAM_ERROR_INVAL;
-		}
+	switch (type) {
+		case JSMN_STREAM_KEY:
+			return parser->callbacks->object_key_decoded_callback != NULL;
+		case JSMN_STREAM_STRING:
+			return parser->callbacks->string_decoded_callback != NULL;
+		default:
+			return false;
 	}
-	/* In strict mode primitive must be followed by a comma/object/array */
-	return JSMN_STREAM_ERROR_PART;
-
-found:
-	parser->buffer[len - 1] = '\0';
-	JSMN_STREAM_CALLBACK(parser->callbacks.primitive_callback, js, len - 1,
-		parser->user_arg);
-	parser->buffer_size = 0;
-	parser->state = JSMN_STREAM_PARSING;
-	return 0;
 }
 
 /**
- * Fills next token with JSON string.
+ * Returns the fragment callback for a key or string, or NULL if long values
+ * of the type cannot be delivered in fragments.
  */
-static int jsmn_stream_parse_string(jsmn_stream_parser *parser, char cin) {
-	/* Leave space for the terminating null character */
-	if (parser->buffer_size == JSMN_STREAM_BUFFER_SIZE - 1) {
-		return JSMN_STREAM_ERROR_NOMEM;
+static jsmn_stream_fragment_callback_t jsmn_stream_fragment_callback(
+	jsmn_stream_parser *parser, jsmn_streamtype_t type) {
+	switch (type) {
+		case JSMN_STREAM_KEY:
+			return parser->callbacks->key_fragment_callback;
+		case JSMN_STREAM_STRING:
+			return parser->callbacks->string_fragment_callback;
+		default:
+			return NULL;
 	}
-	parser->buffer[parser->buffer_size++] = cin;
-	size_t len = parser->buffer_size;
-	const char *js = parser->buffer;
-	for (int pos = 0; pos < len; pos++) {
-		char c = js[pos];
-
-		/* Quote: end of string */
-		if (c == '\"') {
-			parser->buffer[len - 1] = '\0';
-			JSMN_STREAM_CALLBACK(jsmn_stream_stack_top(parser) == JSMN_STREAM_KEY ?
-				parser->callbacks.string_callback : parser->callbacks.object_key_callback,
-				js, len - 1, parser->user_arg);
-			parser->buffer_size = 0;
-			parser->state = JSMN_STREAM_PARSING;
-			return 0;
-		}
-
-		/* Backslash: Quoted symbol expected */
-		if (c == '\\' && pos + 1 < len) {
-			int i;
-			pos++;
-			switch (js[pos]) {
-				/* Allowed escaped symbols */
-				case '\"': case '/' : case '\\' : case 'b' :
-				case 'f' : case 'r' : case 'n'  : case 't' :
-					break;
-				/* Allows escaped symbol \uXXXX */
-				case 'u':
-					pos++;
-					for(i = 0; i < 4 && pos < len && js[pos] != '\0'; i++) {
-						/* If it isn't a hex character we have an error */
-						if(!((js[pos] >= 48 && js[pos] <= 57) || /* 0-9 */
-									(js[pos] >= 65 && js[pos] <= 70) || /* A-F */
-									(js[pos] >= 97 && js[pos] <= 102))) { /* a-f */
-							return JSMN_STREAM_ERROR_INVAL;
-						}
-						pos++;
-					}
-					pos--;
-					break;
-				/* Unexpected symbol */
-				default:
-					return JSMN_STREAM_ERROR_INVAL;
-			}
-		}
+}
+
+static void jsmn_stream_emit_span(jsmn_stream_parser *parser, jsmn_streamtype_t type,
+	const char *value, size_t length);
+
+/* Event callback codes of the events without a value */
+#define JSMN_STREAM_EVENT_OF_start_object JSMN_STREAM_EVENT_START_OBJECT
+#define JSMN_STREAM_EVENT_OF_end_object JSMN_STREAM_EVENT_END_OBJECT
+#define JSMN_STREAM_EVENT_OF_start_array JSMN_STREAM_EVENT_START_ARRAY
+#define JSMN_STREAM_EVENT_OF_end_array JSMN_STREAM_EVENT_END_ARRAY
+/* Typed primitives are off with the event callback */
+#define JSMN_STREAM_EVENT_OF_null JSMN_STREAM_EVENT_PRIMITIVE
+
+/* Events go to the callbacks table of the parser */
+#define JSMN_STREAM_IMPL_STATIC static
+#define JSMN_STREAM_IMPL_EMITTER static
+#define JSMN_STREAM_IMPL_PARAM
+#define JSMN_STREAM_IMPL_ARG
+#define JSMN_STREAM_EMIT_EVENT(event) \
+	if (parser->callbacks->event_callback != NULL) { \
+		jsmn_stream_impl_request(parser, parser->callbacks->event_callback( \
+			JSMN_STREAM_EVENT_OF_##event, NULL, 0, parser->position - 1, parser->user_arg)); \
+	} else JSMN_STREAM_CALLBACK(parser->callbacks->event##_callback, parser->user_arg)
+#define JSMN_STREAM_HAS_SPAN(type) (parser->callbacks->event_callback != NULL || \
+	jsmn_stream_span_callback(parser, type) != NULL || jsmn_stream_has_decoded(parser, type))
+#define JSMN_STREAM_EMIT_SPAN(type, value, length) \
+	jsmn_stream_emit_span(parser, type, value, length)
+#define JSMN_STREAM_EMIT_VALUE(type, value, length) \
+	JSMN_STREAM_CALLBACK(jsmn_stream_value_callback(parser, type), value, length, \
+		parser->user_arg)
+#define JSMN_STREAM_HAS_DECODED(type) jsmn_stream_has_decoded(parser, type)
+#define JSMN_STREAM_HAS_FRAGMENTS(type) (jsmn_stream_fragment_callback(parser, type) != NULL)
+#define JSMN_STREAM_EMIT_FRAGMENT(type, value, length, final) \
+	jsmn_stream_fragment_callback(parser, type)(value, length, parser->value_offset, \
+		final, parser->user_arg)
+#define JSMN_STREAM_HAS_TYPED(name) (parser->callbacks->name##_callback != NULL && \
+	parser->callbacks->event_callback == NULL)
+#define JSMN_STREAM_EMIT_TYPED(name, ...) \
+	parser->callbacks->name##_callback(__VA_ARGS__, parser->user_arg)
+#define JSMN_STREAM_EMIT_DOCUMENT_END(start, end) \
+	if (parser->callbacks->event_callback != NULL) { \
+		jsmn_stream_impl_request(parser, parser->callbacks->event_callback( \
+			JSMN_STREAM_EVENT_DOCUMENT_END, NULL, (end) - (start), start, parser->user_arg)); \
+	} else JSMN_STREAM_CALLBACK(parser->callbacks->document_end_callback, start, end, \
+		parser->user_arg)
+
+#include "jsmn_stream_impl.h"
+
+/**
+ * Delivers a key, string or primitive to the event callback, the decoded
+ * callback or the span callback.
+ */
+static void jsmn_stream_emit_span(jsmn_stream_parser *parser, jsmn_streamtype_t type,
+	const char *value, size_t length) {
+	if (parser->callbacks->event_callback != NULL) {
+		jsmn_stream_impl_request(parser, parser->callbacks->event_callback(
+			type == JSMN_STREAM_KEY ? JSMN_STREAM_EVENT_KEY :
+			type == JSMN_STREAM_STRING ? JSMN_STREAM_EVENT_STRING : JSMN_STREAM_EVENT_PRIMITIVE,
+			value, length, parser->value_offset, parser->user_arg));
+	} else if (jsmn_stream_has_decoded(parser, type)) {
+		(type == JSMN_STREAM_KEY ? parser->callbacks->object_key_decoded_callback :
+			parser->callbacks->string_decoded_callback)(value, length, parser->value_offset,
+			parser->escaped, parser->user_arg);
+	} else {
+		jsmn_stream_span_callback(parser, type)(value, length, parser->value_offset,
+			parser->user_arg);
 	}
-	return JSMN_STREAM_ERROR_PART;
 }
 
 /**
- * Parse JSON string and fill tokens.
+ * Run JSON parser over a chunk of data.
+ */
+int jsmn_stream_parse_buffer(jsmn_stream_parser *parser, const char *data,
+	size_t len, size_t *consumed) {
+	return jsmn_stream_impl_parse(parser, data, len, consumed);
+}
+
+/**
+ * Run JSON parser over a chunk of data using a structural index.
+ */
+int jsmn_stream_parse_indexed(jsmn_stream_parser *parser, const char *data,
+	size_t len, size_t *consumed) {
+	return jsmn_stream_impl_parse_indexed(parser, data, len, consumed);
+}
+
+/**
+ * Skip the rest of the innermost open object or array.
+ */
+void jsmn_stream_skip(jsmn_stream_parser *parser) {
+	jsmn_stream_impl_skip(parser);
+}
+
+/**
+ * Stop parsing after the current event.
+ */
+void jsmn_stream_stop(jsmn_stream_parser *parser) {
+	jsmn_stream_impl_stop(parser);
+}
+
+/**
+ * Parse a single character of JSON.
  */
 int jsmn_stream_parse(jsmn_stream_parser *parser, char c) {
-	jsmn_streamtype_t type;
-	int r;
-
-	switch (parser->state) {
-		case JSMN_STREAM_PARSING:
-			switch (c) {
-				case '{': case '[':
-					if (c == '{') {
-						type = JSMN_STREAM_OBJECT;
-						JSMN_STREAM_CALLBACK(parser->callbacks.start_object_callback,
-							parser->user_arg);
-					} else {
-						type = JSMN_STREAM_ARRAY;
-						JSMN_STREAM_CALLBACK(parser->callbacks.start_array_callback,
-							parser->user_arg);
-					}
-					if (!jsmn_stream_stack_push(parser, type)) {
-						return JSMN_STREAM_ERROR_MAX_DEPTH;
-					}
-					break;
-				case '}': case ']':
-					if (c == '}') {
-						JSMN_STREAM_CALLBACK(parser->callbacks.end_object_callback,
-							parser->user_arg);
-					} else {
-						JSMN_STREAM_CALLBACK(parser->callbacks.end_array_callback,
-							parser->user_arg);
-					}
-					jsmn_stream_stack_pop(parser);
-					if (jsmn_stream_stack_top(parser) == JSMN_STREAM_KEY) {
-						jsmn_stream_stack_pop(parser);
-					}
-					break;
-				case '\"':
-					parser->state = JSMN_STREAM_PARSING_STRING;
-					break;
-				case '\t' : case '\r' : case '\n' : case ' ' : case ',':
-					break;
-				case ':':
-					if (jsmn_stream_stack_top(parser) == JSMN_STREAM_OBJECT &&
-						!jsmn_stream_stack_push(parser, JSMN_STREAM_KEY)) {
-						return JSMN_STREAM_ERROR_MAX_DEPTH;
-					}
-					break;
-				/* In strict mode primitives are: numbers and booleans */
-				case '-': case '0': case '1' : case '2': case '3' : case '4':
-				case '5': case '6': case '7' : case '8': case '9':
-				case 't': case 'f': case 'n' :
-					if (jsmn_stream_stack_top(parser) == JSMN_STREAM_OBJECT) {
-						return JSMN_STREAM_ERROR_INVAL;
-					}
-					parser->state = JSMN_STREAM_PARSING_PRIMITIVE;
-					jsmn_stream_parse(parser, c);
-					break;
-
-				/* Unexpected char in strict mode */
-				default:
-					return JSMN_STREAM_ERROR_INVAL;
-			}
-			break;
-
-		case JSMN_STREAM_PARSING_STRING:
-			r = jsmn_stream_parse_string(parser, c);
-			if (r < 0) return r;
-			if (jsmn_stream_stack_top(parser) == JSMN_STREAM_KEY) {
-				jsmn_stream_stack_pop(parser);
-			}
-			break;
-
-		case JSMN_STREAM_PARSING_PRIMITIVE:
-			r = jsmn_stream_parse_primitive(parser, c);
-			if (r < 0) return r;
-			else if (r == 0) {
-				if (jsmn_stream_stack_top(parser) == JSMN_STREAM_KEY) {
-					jsmn_stream_stack_pop(parser);
-				}
-				return jsmn_stream_parse(parser, c);
-			}
-			break;
-	}
+	return jsmn_stream_impl_parse(parser, &c, 1, NULL);
+}
 
-	return 0;
+/**
+ * Save the parser state.
+ */
+int jsmn_stream_snapshot(const jsmn_stream_parser *parser, void *data,
+	size_t size, size_t *written) {
+	return jsmn_stream_impl_snapshot(parser, data, size, written);
+}
+
+/**
+ * Restore a saved parser state.
+ */
+int jsmn_stream_restore(jsmn_stream_parser *parser, const void *data,
+	size_t size) {
+	return jsmn_stream_impl_restore(parser, data, size);
+}
+
+/**
+ * Creates a new parser that keeps its buffer and type stack in caller
+ * provided storage.
+ */
+void jsmn_stream_init_with_storage(jsmn_stream_parser *parser,
+	const jsmn_stream_callbacks_t *callbacks, void *user_arg,
+	char *buffer, size_t buffer_capacity,
+	jsmn_stream_stack_t *type_stack, size_t stack_capacity) {
+	jsmn_stream_impl_init(parser, callbacks, user_arg, buffer, buffer_capacity,
+		type_stack, stack_capacity);
 }
 
+#if JSMN_STREAM_DEFAULT_STORAGE
 /**
- * Creates a new parser based over a given  buffer with an array of tokens
- * available.
+ * Creates a new parser using the buffer and type stack embedded in the
+ * parser.
  */
 void jsmn_stream_init(jsmn_stream_parser *parser,
-	jsmn_stream_callbacks_t *callbacks, void *user_arg) {
-	parser->state = JSMN_STREAM_PARSING;
-	parser->stack_height = 0;
-	parser->buffer_size = 0;
-	parser->callbacks = *callbacks;
-	parser->user_arg = user_arg;
+	const jsmn_stream_callbacks_t *callbacks, void *user_arg) {
+	jsmn_stream_init_with_storage(parser, callbacks, user_arg,
+		parser->default_buffer, JSMN_STREAM_BUFFER_SIZE,
+		parser->default_type_stack, JSMN_STREAM_MAX_DEPTH);
 }
+#endif
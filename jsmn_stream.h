@@ -6,15 +6,53 @@
 #define __JSMN_STREAM_H_
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * Set to 1 to store the type stack with 2 bits per level in machine words
+ * instead of a byte per level. An object with an open key shares the level
+ * of the object, so stack_height counts only objects and arrays.
+ */
+#ifndef JSMN_STREAM_PACKED_STACK
+#define JSMN_STREAM_PACKED_STACK 0
+#endif
 /* Determines the maximal nesting level of the JSON */
+#ifndef JSMN_STREAM_MAX_DEPTH
+#if JSMN_STREAM_PACKED_STACK
+#define JSMN_STREAM_MAX_DEPTH 512
+#else
 #define JSMN_STREAM_MAX_DEPTH 32
+#endif
+#endif
 /* Determines the maximal length a primitive or a string can have */
+#ifndef JSMN_STREAM_BUFFER_SIZE
 #define JSMN_STREAM_BUFFER_SIZE 512
+#endif
+/*
+ * The sizes above apply to parsers created with jsmn_stream_init(), which
+ * use storage embedded in the parser. Set to 0 to leave that storage out of
+ * the parser when all parsers are created with jsmn_stream_init_with_storage().
+ */
+#ifndef JSMN_STREAM_DEFAULT_STORAGE
+#define JSMN_STREAM_DEFAULT_STORAGE 1
+#endif
+
+/* Storage unit of the type stack */
+#if JSMN_STREAM_PACKED_STACK
+typedef size_t jsmn_stream_stack_t;
+#define JSMN_STREAM_STACK_LEVELS_PER_WORD (sizeof(jsmn_stream_stack_t) * 4)
+#else
+typedef uint8_t jsmn_stream_stack_t;
+#define JSMN_STREAM_STACK_LEVELS_PER_WORD 1
+#endif
+/* Number of jsmn_stream_stack_t needed for a type stack of depth levels */
+#define JSMN_STREAM_STACK_WORDS(depth) \
+	(((depth) + JSMN_STREAM_STACK_LEVELS_PER_WORD - 1) / JSMN_STREAM_STACK_LEVELS_PER_WORD)
 
 /**
  * JSON type identifier. Basic types are:
@@ -40,17 +78,117 @@ enum jsmn_streamerr {
 	/* The string is not a full JSON packet, more bytes expected */
 	JSMN_STREAM_ERROR_PART = -3,
 	/* Reached maximal stack depth (too deep nesting) */
-	JSMN_STREAM_ERROR_MAX_DEPTH = -4
+	JSMN_STREAM_ERROR_MAX_DEPTH = -4,
+	/* Not an error: a callback stopped the parser, see jsmn_stream_stop() */
+	JSMN_STREAM_STOPPED = -5
 };
 
+/**
+ * What the parser does after an event, as returned by the event callback or
+ * requested with jsmn_stream_skip() and jsmn_stream_stop().
+ */
+typedef enum {
+	JSMN_STREAM_CONTINUE = 0,
+	/* Skip the rest of the innermost open object or array */
+	JSMN_STREAM_SKIP_VALUE = 1,
+	/* Return JSMN_STREAM_STOPPED from the parse function */
+	JSMN_STREAM_STOP = 2
+} jsmn_stream_action_t;
+
+/* Parse events passed to the event callback */
+typedef enum {
+	JSMN_STREAM_EVENT_START_OBJECT = 0,
+	JSMN_STREAM_EVENT_END_OBJECT = 1,
+	JSMN_STREAM_EVENT_START_ARRAY = 2,
+	JSMN_STREAM_EVENT_END_ARRAY = 3,
+	JSMN_STREAM_EVENT_KEY = 4,
+	JSMN_STREAM_EVENT_STRING = 5,
+	JSMN_STREAM_EVENT_PRIMITIVE = 6,
+	JSMN_STREAM_EVENT_DOCUMENT_END = 7
+} jsmn_stream_event_t;
+
 typedef enum {
     JSMN_STREAM_PARSING = 0,
     JSMN_STREAM_PARSING_STRING = 1,
-    JSMN_STREAM_PARSING_PRIMITIVE = 2
+    JSMN_STREAM_PARSING_PRIMITIVE = 2,
+    /* Inside an object or array skipped with jsmn_stream_skip() */
+    JSMN_STREAM_SKIPPING = 3,
+    JSMN_STREAM_SKIPPING_STRING = 4
 } jsmn_streamstate_t;
 
+/**
+ * Progress through an escape sequence inside a string. The hex digits of
+ * \uXXXX are counted from JSMN_STREAM_ESCAPE_UNICODE upwards. While decoding,
+ * a high surrogate waits for the backslash and the u of its low surrogate.
+ */
+enum {
+	JSMN_STREAM_ESCAPE_NONE = 0,
+	JSMN_STREAM_ESCAPE_BACKSLASH = 1,
+	JSMN_STREAM_ESCAPE_UNICODE = 2,
+	JSMN_STREAM_ESCAPE_SURROGATE = 6,
+	JSMN_STREAM_ESCAPE_SURROGATE_BACKSLASH = 7
+};
+
+/**
+ * Receives a key or string that does not fit in the parser buffer in pieces
+ * of up to the buffer capacity - 1 characters. Each piece is a null
+ * terminated copy in the parser buffer, offset is the stream offset of the
+ * first character of the whole value and final is set on the last piece.
+ */
+typedef void (* jsmn_stream_fragment_callback_t)(const char *value, size_t length,
+	size_t offset, bool final, void *user_arg);
+
 /**
  * A structure containing callbacks for the parse events.
+ *
+ * Keys, strings and primitives passed to the plain callbacks are null
+ * terminated copies in the parser buffer. When the span variant of a callback
+ * is set it is called instead. It gets the stream offset of the first
+ * character and a pointer straight into the chunk given to
+ * jsmn_stream_parse_buffer() when the whole value is in that chunk, so such
+ * values are neither copied nor limited by the buffer capacity. Values
+ * that straddle chunks are passed from the parser buffer. Span values are
+ * not null terminated.
+ *
+ * Without a fragment callback a key or string that has to be copied and does
+ * not fit in the parser buffer fails the parse with JSMN_STREAM_ERROR_NOMEM.
+ * With one, such a value is delivered only through the fragment callback.
+ * Values that fit still go to the callbacks above.
+ *
+ * The typed callbacks take primitives converted by the parser, instead of
+ * the primitive callbacks. true and false go to bool_callback and null to
+ * null_callback. An integer goes to int64_callback if it fits, otherwise a
+ * non-negative one to uint64_callback if it fits. Other numbers go to
+ * double_callback, correctly rounded, with overflow set when the value is
+ * beyond the double range (it is then +-HUGE_VAL) or is an integer that did
+ * not fit the integer callbacks that are set. Primitives without a typed
+ * callback that takes them, and primitives that are not valid JSON numbers,
+ * still go to the primitive callbacks as text.
+ *
+ * The decoded callbacks take keys and strings with their escape sequences
+ * replaced by UTF-8, instead of the other key and string callbacks. A \uXXXX
+ * surrogate pair becomes one code point, and a surrogate without its other
+ * half becomes U+FFFD. \u0000 becomes a null character inside the value.
+ * escaped tells whether the value had any escape sequence: when it did not
+ * the value is exactly the characters of the input, and like a span it
+ * points into the chunk when the whole value is there. A decoded value is
+ * otherwise a null terminated copy in the parser buffer, which has to hold
+ * all of it. The fragment callbacks of a decoded type get decoded pieces.
+ * Like the typed callbacks they are off with the event callback.
+ *
+ * The event callback is the variant that steers the parser. When it is set
+ * it receives every event instead of the callbacks above, except the
+ * fragment callbacks, and returns a jsmn_stream_action_t. Keys, strings and
+ * primitives come as spans like in the span callbacks, the other events with
+ * a NULL value and the offset of their bracket.
+ *
+ * The document end callback is called after the last event of each top
+ * level value, so input with several documents one after the other, such as
+ * JSON Lines, can be told apart. It gets the stream offsets of the first
+ * character of the document and just past the last one. A top level
+ * primitive ends only at the following whitespace, like any primitive. The
+ * event callback gets it as JSMN_STREAM_EVENT_DOCUMENT_END with a NULL value,
+ * the start as offset and the size of the document as length.
  */
 typedef struct {
 	void (* start_array_callback)(void *user_arg);
@@ -60,28 +198,76 @@ typedef struct {
 	void (* object_key_callback)(const char *key, size_t key_length, void *user_arg);
 	void (* string_callback)(const char *value, size_t length, void *user_arg);
 	void (* primitive_callback)(const char *value, size_t length, void *user_arg);
+	void (* object_key_span_callback)(const char *key, size_t key_length, size_t offset, void *user_arg);
+	void (* string_span_callback)(const char *value, size_t length, size_t offset, void *user_arg);
+	void (* primitive_span_callback)(const char *value, size_t length, size_t offset, void *user_arg);
+	jsmn_stream_fragment_callback_t key_fragment_callback;
+	jsmn_stream_fragment_callback_t string_fragment_callback;
+	void (* int64_callback)(int64_t value, void *user_arg);
+	void (* uint64_callback)(uint64_t value, void *user_arg);
+	void (* double_callback)(double value, bool overflow, void *user_arg);
+	void (* bool_callback)(bool value, void *user_arg);
+	void (* null_callback)(void *user_arg);
+	jsmn_stream_action_t (* event_callback)(jsmn_stream_event_t event, const char *value,
+		size_t length, size_t offset, void *user_arg);
+	void (* document_end_callback)(size_t start, size_t end, void *user_arg);
+	void (* object_key_decoded_callback)(const char *key, size_t key_length, size_t offset,
+		bool escaped, void *user_arg);
+	void (* string_decoded_callback)(const char *value, size_t length, size_t offset,
+		bool escaped, void *user_arg);
 } jsmn_stream_callbacks_t;
 
 /**
- * JSON parser. Stores the internal state of the parser and a necessary buffer
- * for parsing primitives.
+ * JSON parser. Stores the internal state of the parser and references the
+ * buffer for parsing primitives and the stack for the type structure. The
+ * fields used for every character come first, the storage last.
  */
 typedef struct {
-    jsmn_streamstate_t state;
-	jsmn_stream_callbacks_t callbacks; /* callbacks for parse events */
-	jsmn_streamtype_t type_stack[JSMN_STREAM_MAX_DEPTH]; /* Stack for storing the type structure */
+	jsmn_streamstate_t state;
+	unsigned char escape; /* Escape sequence progress inside a string */
+	bool fragmented; /* Part of the current value was delivered as a fragment */
+	unsigned char action; /* jsmn_stream_action_t requested by a callback */
+	bool lines; /* A newline inside a document is an error, see jsmn_stream_ndjson.h */
+	bool escaped; /* The current key or string had an escape sequence */
+	uint32_t unicode; /* Pending high surrogate << 16 | hex digits of \uXXXX so far */
 	size_t stack_height;
-	char buffer[JSMN_STREAM_BUFFER_SIZE];
+	size_t skip_depth; /* Objects and arrays open inside the skipped one */
 	size_t buffer_size;
+	size_t position; /* Number of characters consumed so far */
+	size_t value_offset; /* Stream offset of the current key, string or primitive */
+	size_t document_start; /* Stream offset of the current top level value */
+	jsmn_stream_stack_t *type_stack; /* Stack for storing the type structure */
+	size_t stack_capacity;
+	char *buffer;
+	size_t buffer_capacity;
+	const jsmn_stream_callbacks_t *callbacks; /* callbacks for parse events */
 	void *user_arg;
+#if JSMN_STREAM_DEFAULT_STORAGE
+	jsmn_stream_stack_t default_type_stack[JSMN_STREAM_STACK_WORDS(JSMN_STREAM_MAX_DEPTH)];
+	char default_buffer[JSMN_STREAM_BUFFER_SIZE];
+#endif
 } jsmn_stream_parser;
 
+#if JSMN_STREAM_DEFAULT_STORAGE
 /**
  * Create JSON parser given an array of event callbacks and an optional user
- * argument that is passed to the callbacks.
+ * argument that is passed to the callbacks. The callbacks are referenced, so
+ * they must outlive the parser.
  */
 void jsmn_stream_init(jsmn_stream_parser *parser,
-	jsmn_stream_callbacks_t *callbacks, void *user_arg);
+	const jsmn_stream_callbacks_t *callbacks, void *user_arg);
+#endif
+
+/**
+ * Create JSON parser like jsmn_stream_init(), but with a caller provided
+ * buffer of buffer_capacity characters and a type stack of stack_capacity
+ * levels, which takes JSMN_STREAM_STACK_WORDS(stack_capacity) words. The
+ * callbacks table can be shared by any number of parsers.
+ */
+void jsmn_stream_init_with_storage(jsmn_stream_parser *parser,
+	const jsmn_stream_callbacks_t *callbacks, void *user_arg,
+	char *buffer, size_t buffer_capacity,
+	jsmn_stream_stack_t *type_stack, size_t stack_capacity);
 
 /**
  * Run JSON parser. It incrementally parses a JSON string character by
@@ -90,6 +276,83 @@ void jsmn_stream_init(jsmn_stream_parser *parser,
  */
 int jsmn_stream_parse(jsmn_stream_parser *parser, char c);
 
+/**
+ * Run JSON parser over a chunk of len characters. Equivalent to calling
+ * jsmn_stream_parse() for each character, but without the per character call
+ * overhead. Chunks may be split at any point. If consumed is not NULL it
+ * receives the number of characters consumed, which on error is the offset of
+ * the offending character within the chunk.
+ */
+int jsmn_stream_parse_buffer(jsmn_stream_parser *parser, const char *data,
+	size_t len, size_t *consumed);
+
+/**
+ * Skip the rest of the innermost open object or array, the one just started
+ * when called from start_object_callback or start_array_callback. Meant to be
+ * called from a callback. The skipped part is only scanned for brackets and
+ * strings, so it is not validated and nothing in it is buffered or reported.
+ * Parsing continues with the end_object_callback or end_array_callback of
+ * the skipped object or array. Does nothing outside of any object or array.
+ */
+void jsmn_stream_skip(jsmn_stream_parser *parser);
+
+/**
+ * Stop parsing after the current event. Meant to be called from a callback.
+ * The parse function then returns JSMN_STREAM_STOPPED right away, with
+ * consumed and the parser position just past the key, value or bracket of
+ * the event, which is before the character that ended a primitive. The
+ * parser stays usable, parsing the rest of the input from there continues
+ * as if it had not stopped. A stop requested by a fragment callback takes effect
+ * at the end of the key or string.
+ */
+void jsmn_stream_stop(jsmn_stream_parser *parser);
+
+/**
+ * Run JSON parser over a chunk like jsmn_stream_parse_buffer(), with the same
+ * events, errors and consumed count. The chunk is first indexed 64
+ * characters at a time with SIMD, then only the characters that affect the
+ * parse are visited. Faster for chunks of a few hundred characters or more,
+ * in particular with long strings or a lot of whitespace. Calls of the two
+ * functions may be mixed on the same parser.
+ */
+int jsmn_stream_parse_indexed(jsmn_stream_parser *parser, const char *data,
+	size_t len, size_t *consumed);
+
+/* Version of the format written by jsmn_stream_snapshot() */
+#define JSMN_STREAM_SNAPSHOT_VERSION 2
+/*
+ * Size of the largest snapshot of a parser with a type stack of
+ * stack_capacity levels and a buffer of buffer_capacity characters.
+ */
+#define JSMN_STREAM_SNAPSHOT_MAX_SIZE(stack_capacity, buffer_capacity) \
+	(7 + 7 * ((sizeof(size_t) * 8 + 6) / 7) + ((stack_capacity) + 3) / 4 + (buffer_capacity))
+
+/**
+ * Save the parser state between two parse calls, so parsing can resume from
+ * the same position in another parser, for instance after a restart. The
+ * snapshot holds the state, the counters, the open objects and arrays and the
+ * part of the current value that is in the buffer, in a compact byte format
+ * that does not depend on the build options. It does not hold the callbacks
+ * or what they keep. Returns 0, or JSMN_STREAM_ERROR_NOMEM when it does not
+ * fit in size bytes. written, if not NULL, receives the size of the snapshot
+ * in both cases, so a first call with a size of 0 gives the size to provide.
+ */
+int jsmn_stream_snapshot(const jsmn_stream_parser *parser, void *data,
+	size_t size, size_t *written);
+
+/**
+ * Restore a snapshot of size bytes taken by jsmn_stream_snapshot() into a
+ * parser initialized with the callbacks and storage to continue with.
+ * Parsing then goes on with the character at the saved position. Returns 0,
+ * JSMN_STREAM_ERROR_INVAL for a snapshot that is damaged or of another
+ * version, JSMN_STREAM_ERROR_MAX_DEPTH when the open objects and arrays do
+ * not fit in the type stack or JSMN_STREAM_ERROR_NOMEM when the buffered
+ * part of the current value does not fit in the buffer. The parser is left
+ * as it was on error.
+ */
+int jsmn_stream_restore(jsmn_stream_parser *parser, const void *data,
+	size_t size);
+
 #ifdef __cplusplus
 }
 #endif
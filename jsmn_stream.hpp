@@ -0,0 +1,316 @@
+/**
+ * Header only C++17 front end of the stream parser. It runs the same state
+ * machine as jsmn_stream.c, but delivers the events by calling member
+ * functions of a handler class directly, so they can be inlined. A handler
+ * implements any subset of:
+ *
+ *   void on_start_object();
+ *   void on_end_object();
+ *   void on_start_array();
+ *   void on_end_array();
+ *   void on_key(std::string_view key);
+ *   void on_string(std::string_view value);
+ *   void on_key(std::string_view key, bool escaped);
+ *   void on_string(std::string_view value, bool escaped);
+ *   void on_primitive(std::string_view value);
+ *   void on_key_fragment(std::string_view piece, bool final);
+ *   void on_string_fragment(std::string_view piece, bool final);
+ *   void on_int64(std::int64_t value);
+ *   void on_uint64(std::uint64_t value);
+ *   void on_double(double value, bool overflow);
+ *   void on_bool(bool value);
+ *   void on_null();
+ *   void on_document_end(std::size_t start, std::size_t end);
+ *
+ * Events the handler does not implement compile to nothing. Any member may
+ * return a jsmn_stream_action_t instead of void to skip the rest of the
+ * current object or array or to stop the parse, like the event callback of
+ * jsmn_stream_callbacks_t. Keys, strings and
+ * primitives point into the parsed chunk when the whole value is in it, like
+ * the span callbacks of jsmn_stream_callbacks_t. Without the fragment
+ * functions a value that straddles chunks and does not fit in the buffer
+ * fails the parse with JSMN_STREAM_ERROR_NOMEM. The typed members take
+ * converted primitives by the rules of the typed callbacks in
+ * jsmn_stream_callbacks_t. Keys and strings are decoded for the members
+ * with an escaped flag, like for the decoded callbacks.
+ */
+#ifndef __JSMN_STREAM_HPP_
+#define __JSMN_STREAM_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "jsmn_stream.h"
+#include "jsmn_stream_number.h"
+#include "jsmn_stream_simd.h"
+
+namespace jsmn_stream {
+namespace detail {
+
+#define JSMN_STREAM_HANDLER_TRAIT_AS(trait, event, ...) \
+	template <class Handler, class = void> \
+	struct trait : std::false_type {}; \
+	template <class Handler> \
+	struct trait<Handler, std::void_t<decltype( \
+		std::declval<Handler &>().event(__VA_ARGS__))>> : std::true_type {};
+#define JSMN_STREAM_HANDLER_TRAIT(event, ...) \
+	JSMN_STREAM_HANDLER_TRAIT_AS(has_##event, event, __VA_ARGS__)
+/* Events without arguments, an empty __VA_ARGS__ is not portable */
+#define JSMN_STREAM_HANDLER_TRAIT_NOARGS(event) \
+	template <class Handler, class = void> \
+	struct has_##event : std::false_type {}; \
+	template <class Handler> \
+	struct has_##event<Handler, std::void_t<decltype( \
+		std::declval<Handler &>().event())>> : std::true_type {};
+
+JSMN_STREAM_HANDLER_TRAIT_NOARGS(on_start_object)
+JSMN_STREAM_HANDLER_TRAIT_NOARGS(on_end_object)
+JSMN_STREAM_HANDLER_TRAIT_NOARGS(on_start_array)
+JSMN_STREAM_HANDLER_TRAIT_NOARGS(on_end_array)
+JSMN_STREAM_HANDLER_TRAIT(on_key, std::string_view())
+JSMN_STREAM_HANDLER_TRAIT(on_string, std::string_view())
+JSMN_STREAM_HANDLER_TRAIT(on_primitive, std::string_view())
+JSMN_STREAM_HANDLER_TRAIT_AS(has_on_key_decoded, on_key, std::string_view(), false)
+JSMN_STREAM_HANDLER_TRAIT_AS(has_on_string_decoded, on_string, std::string_view(), false)
+JSMN_STREAM_HANDLER_TRAIT(on_key_fragment, std::string_view(), false)
+JSMN_STREAM_HANDLER_TRAIT(on_string_fragment, std::string_view(), false)
+JSMN_STREAM_HANDLER_TRAIT(on_int64, std::int64_t())
+JSMN_STREAM_HANDLER_TRAIT(on_uint64, std::uint64_t())
+JSMN_STREAM_HANDLER_TRAIT(on_double, 0.0, false)
+JSMN_STREAM_HANDLER_TRAIT(on_bool, false)
+JSMN_STREAM_HANDLER_TRAIT_NOARGS(on_null)
+JSMN_STREAM_HANDLER_TRAIT(on_document_end, std::size_t(), std::size_t())
+
+#undef JSMN_STREAM_HANDLER_TRAIT
+#undef JSMN_STREAM_HANDLER_TRAIT_AS
+#undef JSMN_STREAM_HANDLER_TRAIT_NOARGS
+
+/* Calls a handler member, which returns an action or void */
+template <class Call>
+inline jsmn_stream_action_t action_of(Call &&call) {
+	if constexpr (std::is_same_v<decltype(call()), jsmn_stream_action_t>) {
+		return call();
+	} else {
+		call();
+		return JSMN_STREAM_CONTINUE;
+	}
+}
+
+template <class Handler>
+constexpr bool has_decoded(jsmn_streamtype_t type) {
+	return (type == JSMN_STREAM_KEY && has_on_key_decoded<Handler>::value) ||
+		(type == JSMN_STREAM_STRING && has_on_string_decoded<Handler>::value);
+}
+
+template <class Handler>
+inline jsmn_stream_action_t emit_value(Handler &handler, jsmn_streamtype_t type,
+	const char *value, std::size_t length, bool escaped) {
+	std::string_view view(value, length);
+
+	switch (type) {
+		case JSMN_STREAM_KEY:
+			if constexpr (has_on_key_decoded<Handler>::value) {
+				return action_of([&] { return handler.on_key(view, escaped); });
+			} else if constexpr (has_on_key<Handler>::value) {
+				return action_of([&] { return handler.on_key(view); });
+			}
+			break;
+		case JSMN_STREAM_STRING:
+			if constexpr (has_on_string_decoded<Handler>::value) {
+				return action_of([&] { return handler.on_string(view, escaped); });
+			} else if constexpr (has_on_string<Handler>::value) {
+				return action_of([&] { return handler.on_string(view); });
+			}
+			break;
+		default:
+			if constexpr (has_on_primitive<Handler>::value) {
+				return action_of([&] { return handler.on_primitive(view); });
+			}
+			break;
+	}
+	return JSMN_STREAM_CONTINUE;
+}
+
+template <class Handler>
+constexpr bool has_fragments(jsmn_streamtype_t type) {
+	return (type == JSMN_STREAM_KEY && has_on_key_fragment<Handler>::value) ||
+		(type == JSMN_STREAM_STRING && has_on_string_fragment<Handler>::value);
+}
+
+template <class Handler>
+inline jsmn_stream_action_t emit_fragment(Handler &handler, jsmn_streamtype_t type,
+	const char *value, std::size_t length, bool final) {
+	std::string_view view(value, length);
+
+	if (type == JSMN_STREAM_KEY) {
+		if constexpr (has_on_key_fragment<Handler>::value) {
+			return action_of([&] { return handler.on_key_fragment(view, final); });
+		}
+	} else {
+		if constexpr (has_on_string_fragment<Handler>::value) {
+			return action_of([&] { return handler.on_string_fragment(view, final); });
+		}
+	}
+	return JSMN_STREAM_CONTINUE;
+}
+
+/* Events go straight to the handler */
+#define JSMN_STREAM_IMPL_STATIC inline
+#define JSMN_STREAM_IMPL_EMITTER template <class Handler> inline
+#define JSMN_STREAM_IMPL_PARAM Handler &handler,
+#define JSMN_STREAM_IMPL_ARG handler,
+#define JSMN_STREAM_EMIT_EVENT(event) \
+	if constexpr (has_on_##event<Handler>::value) { \
+		jsmn_stream_impl_request(parser, action_of([&] { return handler.on_##event(); })); \
+	}
+#define JSMN_STREAM_HAS_SPAN(type) true
+#define JSMN_STREAM_EMIT_SPAN(type, value, length) \
+	jsmn_stream_impl_request(parser, emit_value(handler, type, value, length, parser->escaped))
+#define JSMN_STREAM_EMIT_VALUE(type, value, length) \
+	jsmn_stream_impl_request(parser, emit_value(handler, type, value, length, parser->escaped))
+#define JSMN_STREAM_HAS_DECODED(type) has_decoded<Handler>(type)
+#define JSMN_STREAM_HAS_FRAGMENTS(type) has_fragments<Handler>(type)
+#define JSMN_STREAM_EMIT_FRAGMENT(type, value, length, final) \
+	jsmn_stream_impl_request(parser, emit_fragment(handler, type, value, length, final))
+#define JSMN_STREAM_HAS_TYPED(name) has_on_##name<Handler>::value
+#define JSMN_STREAM_EMIT_TYPED(name, ...) \
+	if constexpr (has_on_##name<Handler>::value) { \
+		jsmn_stream_impl_request(parser, \
+			action_of([&] { return handler.on_##name(__VA_ARGS__); })); \
+	}
+#define JSMN_STREAM_EMIT_DOCUMENT_END(start, end) \
+	if constexpr (has_on_document_end<Handler>::value) { \
+		jsmn_stream_impl_request(parser, \
+			action_of([&] { return handler.on_document_end(start, end); })); \
+	}
+
+#include "jsmn_stream_impl.h"
+
+#undef JSMN_STREAM_IMPL_STATIC
+#undef JSMN_STREAM_IMPL_EMITTER
+#undef JSMN_STREAM_IMPL_PARAM
+#undef JSMN_STREAM_IMPL_ARG
+#undef JSMN_STREAM_EMIT_EVENT
+#undef JSMN_STREAM_HAS_SPAN
+#undef JSMN_STREAM_EMIT_SPAN
+#undef JSMN_STREAM_EMIT_VALUE
+#undef JSMN_STREAM_HAS_DECODED
+#undef JSMN_STREAM_HAS_FRAGMENTS
+#undef JSMN_STREAM_EMIT_FRAGMENT
+#undef JSMN_STREAM_HAS_TYPED
+#undef JSMN_STREAM_EMIT_TYPED
+#undef JSMN_STREAM_EMIT_DOCUMENT_END
+
+} // namespace detail
+
+/**
+ * Stream parser delivering its events to a Handler. Like jsmn_stream_parse_buffer(),
+ * parse() can be given the input in chunks split at any point.
+ */
+template <class Handler>
+class basic_parser {
+public:
+#if JSMN_STREAM_DEFAULT_STORAGE
+	/**
+	 * Creates a parser using the buffer and type stack embedded in the parser.
+	 */
+	explicit basic_parser(Handler &handler) : handler_(handler) {
+		detail::jsmn_stream_impl_init(&parser_, nullptr, nullptr,
+			parser_.default_buffer, JSMN_STREAM_BUFFER_SIZE,
+			parser_.default_type_stack, JSMN_STREAM_MAX_DEPTH);
+	}
+#endif
+
+	/**
+	 * Creates a parser with a caller provided buffer and type stack, see
+	 * jsmn_stream_init_with_storage().
+	 */
+	basic_parser(Handler &handler, char *buffer, std::size_t buffer_capacity,
+		jsmn_stream_stack_t *type_stack, std::size_t stack_capacity)
+		: handler_(handler) {
+		detail::jsmn_stream_impl_init(&parser_, nullptr, nullptr,
+			buffer, buffer_capacity, type_stack, stack_capacity);
+	}
+
+	basic_parser(const basic_parser &) = delete;
+	basic_parser &operator=(const basic_parser &) = delete;
+
+	/**
+	 * Parses a chunk. Returns 0 or a jsmn_streamerr code, consumed receives
+	 * the number of characters consumed like in jsmn_stream_parse_buffer().
+	 */
+	int parse(const char *data, std::size_t length, std::size_t *consumed = nullptr) {
+		return detail::jsmn_stream_impl_parse(handler_, &parser_, data, length, consumed);
+	}
+
+	int parse(std::string_view data, std::size_t *consumed = nullptr) {
+		return parse(data.data(), data.size(), consumed);
+	}
+
+	/**
+	 * Parses a chunk like parse(), using a structural index as in
+	 * jsmn_stream_parse_indexed().
+	 */
+	int parse_indexed(const char *data, std::size_t length, std::size_t *consumed = nullptr) {
+		return detail::jsmn_stream_impl_parse_indexed(handler_, &parser_, data, length, consumed);
+	}
+
+	/**
+	 * Skips the rest of the innermost open object or array, see
+	 * jsmn_stream_skip(). Meant to be called from a handler member.
+	 */
+	void skip() {
+		detail::jsmn_stream_impl_skip(&parser_);
+	}
+
+	/**
+	 * Stops the parse after the current event, see jsmn_stream_stop().
+	 * Meant to be called from a handler member.
+	 */
+	void stop() {
+		detail::jsmn_stream_impl_stop(&parser_);
+	}
+
+	/**
+	 * Starts over with a new document, keeping the storage.
+	 */
+	void reset() {
+		detail::jsmn_stream_impl_init(&parser_, nullptr, nullptr,
+			parser_.buffer, parser_.buffer_capacity,
+			parser_.type_stack, parser_.stack_capacity);
+	}
+
+	/**
+	 * Saves the parser state, see jsmn_stream_snapshot().
+	 */
+	int snapshot(void *data, std::size_t size, std::size_t *written = nullptr) const {
+		return detail::jsmn_stream_impl_snapshot(&parser_, data, size, written);
+	}
+
+	/**
+	 * Restores a state saved by snapshot() or jsmn_stream_snapshot(), see
+	 * jsmn_stream_restore().
+	 */
+	int restore(const void *data, std::size_t size) {
+		return detail::jsmn_stream_impl_restore(&parser_, data, size);
+	}
+
+	/**
+	 * The underlying parser state, e.g. for position and stack_height.
+	 */
+	const jsmn_stream_parser &state() const {
+		return parser_;
+	}
+
+private:
+	Handler &handler_;
+	jsmn_stream_parser parser_;
+};
+
+} // namespace jsmn_stream
+
+#endif /* __JSMN_STREAM_HPP_ */
@@ -0,0 +1,296 @@
+#include "jsmn_stream_bind.h"
+#include <math.h>
+#include <string.h>
+
+static void jsmn_stream_bind_start_container(void *user_arg);
+static void jsmn_stream_bind_string(const char *value, size_t length, size_t offset, bool escaped, void *user_arg);
+static void jsmn_stream_bind_primitive(const char *value, size_t length, void *user_arg);
+static void jsmn_stream_bind_string_fragment(const char *value, size_t length, size_t offset, bool final, void *user_arg);
+static void jsmn_stream_bind_int64(int64_t value, void *user_arg);
+static void jsmn_stream_bind_uint64(uint64_t value, void *user_arg);
+static void jsmn_stream_bind_double(double value, bool overflow, void *user_arg);
+static void jsmn_stream_bind_bool(bool value, void *user_arg);
+static void jsmn_stream_bind_null(void *user_arg);
+
+/**
+ * @brief Initialize the jsmn_stream_bind_t object.
+ * 	The bindings and the target are referenced, so they must outlive the
+ * 	bind object, which must not move after this.
+ *
+ * 	Each bound value that has the type of its binding is written to the
+ * 	target and sets its bit in seen. A value of another type, an integer
+ * 	out of the range of its field, or an object or array sets its bit in
+ * 	invalid instead and leaves the field alone. An object or array is
+ * 	skipped without being parsed. null leaves the field alone without
+ * 	setting any bit. Integer fields only take numbers written without a
+ * 	fraction or exponent. Strings are decoded to UTF-8 and cut to fit
+ * 	their field.
+ *
+ * @param bind
+ * @param bindings array of num_bindings bindings.
+ * @param num_bindings at most JSMN_STREAM_BIND_MAX_BINDINGS.
+ * @param target struct the values are written to.
+ * @return int 0, or JSMN_STREAM_ERROR_INVAL for an invalid path or binding.
+ */
+int jsmn_stream_bind_init(jsmn_stream_bind_t *bind, const jsmn_stream_binding_t *bindings, int num_bindings, void *target)
+{
+	jsmn_stream_callbacks_t *bind_callbacks = &bind->bind_callbacks;
+
+	bind->bindings = bindings;
+	bind->target = target;
+	bind->string_length = 0;
+	bind->seen = 0;
+	bind->invalid = 0;
+	bind->truncated = 0;
+
+	if (num_bindings < 0 || num_bindings > JSMN_STREAM_BIND_MAX_BINDINGS)
+	{
+		return JSMN_STREAM_ERROR_INVAL;
+	}
+	for (int i = 0; i < num_bindings; i++)
+	{
+		if (bindings[i].type > JSMN_STREAM_BIND_STRING
+			|| (bindings[i].type == JSMN_STREAM_BIND_STRING && bindings[i].max_length == 0))
+		{
+			return JSMN_STREAM_ERROR_INVAL;
+		}
+		bind->paths[i] = bindings[i].path;
+	}
+
+	// the typed callbacks convert numbers, the rest is not a valid number
+	memset(bind_callbacks, 0, sizeof(*bind_callbacks));
+	bind_callbacks->start_array_callback = jsmn_stream_bind_start_container;
+	bind_callbacks->start_object_callback = jsmn_stream_bind_start_container;
+	bind_callbacks->string_decoded_callback = jsmn_stream_bind_string;
+	bind_callbacks->primitive_callback = jsmn_stream_bind_primitive;
+	bind_callbacks->string_fragment_callback = jsmn_stream_bind_string_fragment;
+	bind_callbacks->int64_callback = jsmn_stream_bind_int64;
+	bind_callbacks->uint64_callback = jsmn_stream_bind_uint64;
+	bind_callbacks->double_callback = jsmn_stream_bind_double;
+	bind_callbacks->bool_callback = jsmn_stream_bind_bool;
+	bind_callbacks->null_callback = jsmn_stream_bind_null;
+
+	return jsmn_stream_filter_init(&bind->filter, bind->paths, num_bindings, bind_callbacks, bind);
+}
+
+/**
+ * @brief Parse a chunk of characters.
+ *
+ * @param bind
+ * @param data
+ * @param length
+ * @param consumed receives the number of characters consumed. May be NULL.
+ * @return int 0, or a jsmn_stream_filter_parse() error.
+ */
+int jsmn_stream_bind_parse(jsmn_stream_bind_t *bind, const char *data, size_t length, size_t *consumed)
+{
+	return jsmn_stream_filter_parse(&bind->filter, data, length, consumed);
+}
+
+/**
+ * @brief Binding of the value being reported.
+ *
+ * @param bind
+ * @return const jsmn_stream_binding_t*
+ */
+static const jsmn_stream_binding_t *jsmn_stream_bind_current(jsmn_stream_bind_t *bind)
+{
+	return &bind->bindings[jsmn_stream_filter_match(&bind->filter)];
+}
+
+/**
+ * @brief Write the value being reported to its field.
+ *
+ * @param bind
+ * @param value
+ * @param size size of the field.
+ */
+static void jsmn_stream_bind_store(jsmn_stream_bind_t *bind, const void *value, size_t size)
+{
+	int match = jsmn_stream_filter_match(&bind->filter);
+
+	memcpy((char *)bind->target + bind->bindings[match].offset, value, size);
+	bind->seen |= (uint32_t)1 << match;
+}
+
+/**
+ * @brief Mark the value being reported as not fitting its binding.
+ *
+ * @param bind
+ */
+static void jsmn_stream_bind_reject(jsmn_stream_bind_t *bind)
+{
+	bind->invalid |= (uint32_t)1 << jsmn_stream_filter_match(&bind->filter);
+}
+
+static void jsmn_stream_bind_start_container(void *user_arg)
+{
+	jsmn_stream_bind_t *bind = (jsmn_stream_bind_t *)user_arg;
+
+	// no binding takes an object or array, so none of its values are reported
+	jsmn_stream_bind_reject(bind);
+	jsmn_stream_skip(&bind->filter.stream_parser);
+}
+
+/**
+ * @brief Callback used for a decoded string, copied to its field and cut
+ * 	to fit.
+ */
+static void jsmn_stream_bind_string(const char *value, size_t length, size_t offset, bool escaped, void *user_arg)
+{
+	jsmn_stream_bind_t *bind = (jsmn_stream_bind_t *)user_arg;
+	const jsmn_stream_binding_t *binding;
+	char *field;
+
+	binding = jsmn_stream_bind_current(bind);
+	if (binding->type != JSMN_STREAM_BIND_STRING)
+	{
+		jsmn_stream_bind_reject(bind);
+		return;
+	}
+
+	field = (char *)bind->target + binding->offset;
+	if (length > binding->max_length - 1)
+	{
+		length = binding->max_length - 1;
+		bind->truncated |= (uint32_t)1 << jsmn_stream_filter_match(&bind->filter);
+	}
+	memcpy(field, value, length);
+	field[length] = '\0';
+	bind->seen |= (uint32_t)1 << jsmn_stream_filter_match(&bind->filter);
+}
+
+static void jsmn_stream_bind_primitive(const char *value, size_t length, void *user_arg)
+{
+	jsmn_stream_bind_t *bind = (jsmn_stream_bind_t *)user_arg;
+
+	// not a valid JSON number
+	jsmn_stream_bind_reject(bind);
+}
+
+/**
+ * @brief Callback used for the decoded pieces of a string that does not
+ * 	fit in the parser buffer. The pieces are copied as they come.
+ */
+static void jsmn_stream_bind_string_fragment(const char *value, size_t length, size_t offset, bool final, void *user_arg)
+{
+	jsmn_stream_bind_t *bind = (jsmn_stream_bind_t *)user_arg;
+	const jsmn_stream_binding_t *binding;
+	char *field;
+	size_t capacity;
+
+	binding = jsmn_stream_bind_current(bind);
+	if (binding->type != JSMN_STREAM_BIND_STRING)
+	{
+		if (final)
+		{
+			jsmn_stream_bind_reject(bind);
+		}
+		return;
+	}
+
+	field = (char *)bind->target + binding->offset;
+	capacity = binding->max_length - 1;
+	if (bind->string_length < capacity)
+	{
+		memcpy(field + bind->string_length, value, length < capacity - bind->string_length ? length : capacity - bind->string_length);
+	}
+	bind->string_length += length;
+
+	if (final)
+	{
+		if (bind->string_length > capacity)
+		{
+			bind->string_length = capacity;
+			bind->truncated |= (uint32_t)1 << jsmn_stream_filter_match(&bind->filter);
+		}
+		field[bind->string_length] = '\0';
+		bind->seen |= (uint32_t)1 << jsmn_stream_filter_match(&bind->filter);
+		bind->string_length = 0;
+	}
+}
+
+static void jsmn_stream_bind_int64(int64_t value, void *user_arg)
+{
+	jsmn_stream_bind_t *bind = (jsmn_stream_bind_t *)user_arg;
+
+	switch (jsmn_stream_bind_current(bind)->type)
+	{
+	case JSMN_STREAM_BIND_INT32:
+		if (value >= INT32_MIN && value <= INT32_MAX)
+		{
+			int32_t field = (int32_t)value;
+			jsmn_stream_bind_store(bind, &field, sizeof(field));
+			return;
+		}
+		break;
+	case JSMN_STREAM_BIND_INT64:
+		jsmn_stream_bind_store(bind, &value, sizeof(value));
+		return;
+	case JSMN_STREAM_BIND_UINT32:
+		if (value >= 0 && value <= UINT32_MAX)
+		{
+			uint32_t field = (uint32_t)value;
+			jsmn_stream_bind_store(bind, &field, sizeof(field));
+			return;
+		}
+		break;
+	case JSMN_STREAM_BIND_DOUBLE:
+	{
+		double field = (double)value;
+		jsmn_stream_bind_store(bind, &field, sizeof(field));
+		return;
+	}
+	default:
+		break;
+	}
+
+	jsmn_stream_bind_reject(bind);
+}
+
+static void jsmn_stream_bind_uint64(uint64_t value, void *user_arg)
+{
+	jsmn_stream_bind_t *bind = (jsmn_stream_bind_t *)user_arg;
+
+	// only integers past INT64_MAX come here, they fit none of the integer fields
+	if (jsmn_stream_bind_current(bind)->type == JSMN_STREAM_BIND_DOUBLE)
+	{
+		double field = (double)value;
+		jsmn_stream_bind_store(bind, &field, sizeof(field));
+		return;
+	}
+
+	jsmn_stream_bind_reject(bind);
+}
+
+static void jsmn_stream_bind_double(double value, bool overflow, void *user_arg)
+{
+	jsmn_stream_bind_t *bind = (jsmn_stream_bind_t *)user_arg;
+
+	// overflow is also set for integers past UINT64_MAX, which are still good doubles
+	if (jsmn_stream_bind_current(bind)->type == JSMN_STREAM_BIND_DOUBLE && !(overflow && isinf(value)))
+	{
+		jsmn_stream_bind_store(bind, &value, sizeof(value));
+		return;
+	}
+
+	jsmn_stream_bind_reject(bind);
+}
+
+static void jsmn_stream_bind_bool(bool value, void *user_arg)
+{
+	jsmn_stream_bind_t *bind = (jsmn_stream_bind_t *)user_arg;
+
+	if (jsmn_stream_bind_current(bind)->type == JSMN_STREAM_BIND_BOOL)
+	{
+		jsmn_stream_bind_store(bind, &value, sizeof(value));
+		return;
+	}
+
+	jsmn_stream_bind_reject(bind);
+}
+
+static void jsmn_stream_bind_null(void *user_arg)
+{
+	// null leaves the field as it was
+}
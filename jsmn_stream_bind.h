@@ -0,0 +1,68 @@
+#ifndef __JSMN_STREAM_BIND_H_
+#define __JSMN_STREAM_BIND_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "jsmn_stream.h"
+#include "jsmn_stream_filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bindings of a table, as many as the filter has patterns */
+#define JSMN_STREAM_BIND_MAX_BINDINGS JSMN_STREAM_FILTER_MAX_PATTERNS
+
+typedef enum {
+  JSMN_STREAM_BIND_INT32 = 0, // int32_t
+  JSMN_STREAM_BIND_INT64 = 1, // int64_t
+  JSMN_STREAM_BIND_UINT32 = 2, // uint32_t
+  JSMN_STREAM_BIND_DOUBLE = 3, // double, also takes integers
+  JSMN_STREAM_BIND_BOOL = 4, // bool
+  JSMN_STREAM_BIND_STRING = 5 // char array, null terminated
+} jsmn_stream_bind_type_t;
+
+/**
+ * @brief Binds the value at a path to a field of the target struct.
+ * 	Paths are the patterns of jsmn_stream_filter_t, e.g. "/config/name".
+ *
+ */
+typedef struct {
+  const char *path;
+  size_t offset; // offset of the field in the target struct
+  jsmn_stream_bind_type_t type;
+  size_t max_length; // capacity of a string field, null terminator included
+} jsmn_stream_binding_t;
+
+/* Binding of a struct member, e.g.
+ * JSMN_STREAM_BIND_FIELD("/name", struct config, name, JSMN_STREAM_BIND_STRING) */
+#define JSMN_STREAM_BIND_FIELD(path, struct_type, member, type) \
+	{ (path), offsetof(struct_type, member), (type), sizeof(((struct_type *)0)->member) }
+
+/**
+ * @brief Decodes the values at the bound paths straight into a struct as
+ * 	they stream by, without tokens. Everything else is skipped by the
+ * 	filter underneath.
+ *
+ */
+typedef struct {
+  jsmn_stream_filter_t filter;
+  jsmn_stream_callbacks_t bind_callbacks;
+  const char *paths[JSMN_STREAM_BIND_MAX_BINDINGS]; // patterns of the filter
+  const jsmn_stream_binding_t *bindings;
+  void *target;
+  size_t string_length; // characters of a fragmented string so far
+  uint32_t seen; // bindings that were decoded, bit i for binding i
+  uint32_t invalid; // bindings whose value had the wrong type or range
+  uint32_t truncated; // string bindings cut to max_length - 1 characters
+} jsmn_stream_bind_t;
+
+int jsmn_stream_bind_init(jsmn_stream_bind_t *bind, const jsmn_stream_binding_t *bindings, int num_bindings, void *target);
+int jsmn_stream_bind_parse(jsmn_stream_bind_t *bind, const char *data, size_t length, size_t *consumed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSMN_STREAM_BIND_H_ */
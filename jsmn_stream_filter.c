@@ -0,0 +1,658 @@
+#include "jsmn_stream_filter.h"
+#include "jsmn_stream_simd.h"
+#include <string.h>
+
+#define JSMN_STREAM_FILTER_SEGMENT_KEY -1
+#define JSMN_STREAM_FILTER_SEGMENT_WILDCARD -2
+
+static void jsmn_stream_filter_start_array(void *user_arg);
+static void jsmn_stream_filter_end_array(void *user_arg);
+static void jsmn_stream_filter_start_object(void *user_arg);
+static void jsmn_stream_filter_end_object(void *user_arg);
+static void jsmn_stream_filter_object_key(const char *key, size_t key_length, void *user_arg);
+static void jsmn_stream_filter_string(const char *value, size_t length, void *user_arg);
+static void jsmn_stream_filter_primitive(const char *value, size_t length, void *user_arg);
+static void jsmn_stream_filter_object_key_span(const char *key, size_t key_length, size_t offset, void *user_arg);
+static void jsmn_stream_filter_string_span(const char *value, size_t length, size_t offset, void *user_arg);
+static void jsmn_stream_filter_primitive_span(const char *value, size_t length, size_t offset, void *user_arg);
+static void jsmn_stream_filter_object_key_decoded(const char *key, size_t key_length, size_t offset, bool escaped, void *user_arg);
+static void jsmn_stream_filter_string_decoded(const char *value, size_t length, size_t offset, bool escaped, void *user_arg);
+static void jsmn_stream_filter_key_fragment(const char *key, size_t key_length, size_t offset, bool final, void *user_arg);
+static void jsmn_stream_filter_string_fragment(const char *value, size_t length, size_t offset, bool final, void *user_arg);
+static void jsmn_stream_filter_int64(int64_t value, void *user_arg);
+static void jsmn_stream_filter_uint64(uint64_t value, void *user_arg);
+static void jsmn_stream_filter_double(double value, bool overflow, void *user_arg);
+static void jsmn_stream_filter_bool(bool value, void *user_arg);
+static void jsmn_stream_filter_null(void *user_arg);
+static void jsmn_stream_filter_document_end(size_t start, size_t end, void *user_arg);
+
+/**
+ * @brief Split a pattern into segments.
+ *
+ * @param filter
+ * @param p index of the pattern.
+ * @return int 0, or JSMN_STREAM_ERROR_INVAL if the pattern does not start
+ * 	with / or has too many segments.
+ */
+static int jsmn_stream_filter_compile(jsmn_stream_filter_t *filter, int p)
+{
+	const char *pattern = filter->patterns[p];
+	size_t pattern_length = strlen(pattern);
+	size_t start;
+	int count = 0;
+
+	// the empty pattern subscribes to the whole document
+	if (pattern_length == 0)
+	{
+		filter->segment_count[p] = 0;
+		return 0;
+	}
+	if (pattern[0] != '/' || pattern_length > UINT16_MAX)
+	{
+		return JSMN_STREAM_ERROR_INVAL;
+	}
+
+	for (start = 1; start <= pattern_length; count++)
+	{
+		size_t end = start;
+		int32_t index = 0;
+
+		if (count == JSMN_STREAM_FILTER_MAX_SEGMENTS)
+		{
+			return JSMN_STREAM_ERROR_INVAL;
+		}
+		while (end < pattern_length && pattern[end] != '/')
+		{
+			end++;
+		}
+
+		filter->segment_start[p][count] = (uint16_t)start;
+		filter->segment_length[p][count] = (uint16_t)(end - start);
+		if (end - start == 1 && pattern[start] == '*')
+		{
+			index = JSMN_STREAM_FILTER_SEGMENT_WILDCARD;
+		}
+		else if (end == start || end - start > 9 || (pattern[start] == '0' && end - start > 1))
+		{
+			index = JSMN_STREAM_FILTER_SEGMENT_KEY;
+		}
+		else
+		{
+			// a segment of digits without leading zeros also matches that array index
+			for (size_t i = start; i < end; i++)
+			{
+				if (pattern[i] < '0' || pattern[i] > '9')
+				{
+					index = JSMN_STREAM_FILTER_SEGMENT_KEY;
+					break;
+				}
+				index = index * 10 + (pattern[i] - '0');
+			}
+		}
+		filter->segment_index[p][count] = index;
+
+		start = end + 1;
+	}
+
+	filter->segment_count[p] = (uint8_t)count;
+	return 0;
+}
+
+/**
+ * @brief Initialize the jsmn_stream_filter_t object.
+ * 	This in turn initializes the regular jsmn_stream_parser. The patterns
+ * 	and the callbacks are referenced, so they must outlive the filter.
+ * 	Only the values at paths matching a pattern are reported to the
+ * 	callbacks, objects and arrays in full. Other objects and arrays are
+ * 	skipped inside the parser without buffering or validating them.
+ *
+ * 	A segment is compared with the key as it appears in the JSON text,
+ * 	escapes included, or with the decoded key when object_key_decoded_callback
+ * 	is set. Keys that do not fit in the parser buffer only match the *
+ * 	segment.
+ *
+ * 	The event callback is not supported. The callbacks can still skip or
+ * 	stop with jsmn_stream_skip() and jsmn_stream_stop() on stream_parser.
+ *
+ * @param filter
+ * @param patterns array of num_patterns patterns.
+ * @param num_patterns at most JSMN_STREAM_FILTER_MAX_PATTERNS.
+ * @param callbacks
+ * @param user_arg passed to the callbacks.
+ * @return int 0, or JSMN_STREAM_ERROR_INVAL for an invalid pattern or an
+ * 	event callback.
+ */
+int jsmn_stream_filter_init(jsmn_stream_filter_t *filter, const char *const *patterns, int num_patterns, const jsmn_stream_callbacks_t *callbacks, void *user_arg)
+{
+	jsmn_stream_callbacks_t *filter_callbacks = &filter->filter_callbacks;
+
+	filter->callbacks = callbacks;
+	filter->user_arg = user_arg;
+	filter->patterns = patterns;
+	filter->num_patterns = num_patterns;
+	filter->depth = 0;
+	filter->delivering = 0;
+	filter->match = JSMN_STREAM_FILTER_NO_MATCH;
+	filter->fragmenting = false;
+	filter->fragment_matched = false;
+	filter->error = 0;
+
+	if (num_patterns < 0 || num_patterns > JSMN_STREAM_FILTER_MAX_PATTERNS || callbacks->event_callback != NULL)
+	{
+		return JSMN_STREAM_ERROR_INVAL;
+	}
+	for (int p = 0; p < num_patterns; p++)
+	{
+		int r = jsmn_stream_filter_compile(filter, p);
+		if (r != 0)
+		{
+			return r;
+		}
+	}
+
+	// Every value has to be seen to count array indices, so the filter takes
+	// the span variant of a callback the user left out. Decoded callbacks
+	// are taken in place of the others when set, as in the parser, and so
+	// are typed callbacks, which fall back to the primitive callbacks.
+	memset(filter_callbacks, 0, sizeof(*filter_callbacks));
+	filter_callbacks->start_array_callback = jsmn_stream_filter_start_array;
+	filter_callbacks->end_array_callback = jsmn_stream_filter_end_array;
+	filter_callbacks->start_object_callback = jsmn_stream_filter_start_object;
+	filter_callbacks->end_object_callback = jsmn_stream_filter_end_object;
+	if (callbacks->object_key_decoded_callback != NULL)
+	{
+		filter_callbacks->object_key_decoded_callback = jsmn_stream_filter_object_key_decoded;
+	}
+	else if (callbacks->object_key_span_callback == NULL && callbacks->object_key_callback != NULL)
+	{
+		filter_callbacks->object_key_callback = jsmn_stream_filter_object_key;
+	}
+	else
+	{
+		filter_callbacks->object_key_span_callback = jsmn_stream_filter_object_key_span;
+	}
+	if (callbacks->string_decoded_callback != NULL)
+	{
+		filter_callbacks->string_decoded_callback = jsmn_stream_filter_string_decoded;
+	}
+	else if (callbacks->string_span_callback == NULL && callbacks->string_callback != NULL)
+	{
+		filter_callbacks->string_callback = jsmn_stream_filter_string;
+	}
+	else
+	{
+		filter_callbacks->string_span_callback = jsmn_stream_filter_string_span;
+	}
+	if (callbacks->primitive_span_callback == NULL && callbacks->primitive_callback != NULL)
+	{
+		filter_callbacks->primitive_callback = jsmn_stream_filter_primitive;
+	}
+	else
+	{
+		filter_callbacks->primitive_span_callback = jsmn_stream_filter_primitive_span;
+	}
+	filter_callbacks->key_fragment_callback = jsmn_stream_filter_key_fragment;
+	filter_callbacks->string_fragment_callback = jsmn_stream_filter_string_fragment;
+	filter_callbacks->int64_callback = callbacks->int64_callback ? jsmn_stream_filter_int64 : NULL;
+	filter_callbacks->uint64_callback = callbacks->uint64_callback ? jsmn_stream_filter_uint64 : NULL;
+	filter_callbacks->double_callback = callbacks->double_callback ? jsmn_stream_filter_double : NULL;
+	filter_callbacks->bool_callback = callbacks->bool_callback ? jsmn_stream_filter_bool : NULL;
+	filter_callbacks->null_callback = callbacks->null_callback ? jsmn_stream_filter_null : NULL;
+	filter_callbacks->document_end_callback = callbacks->document_end_callback ? jsmn_stream_filter_document_end : NULL;
+
+#if JSMN_STREAM_DEFAULT_STORAGE
+	jsmn_stream_init(&filter->stream_parser, filter_callbacks, filter);
+#else
+	jsmn_stream_init_with_storage(&filter->stream_parser, filter_callbacks, filter,
+		filter->stream_buffer, JSMN_STREAM_BUFFER_SIZE,
+		filter->stream_type_stack, JSMN_STREAM_MAX_DEPTH);
+#endif
+
+	return 0;
+}
+
+/**
+ * @brief Parse a chunk of characters.
+ *
+ * @param filter
+ * @param data
+ * @param length
+ * @param consumed receives the number of characters consumed. May be NULL.
+ * @return int 0, a jsmn_stream_parse_buffer() error, or
+ * 	JSMN_STREAM_ERROR_NOMEM when a subscribed key or string does not fit in
+ * 	the parser buffer and there is no fragment callback for it.
+ */
+int jsmn_stream_filter_parse(jsmn_stream_filter_t *filter, const char *data, size_t length, size_t *consumed)
+{
+	int r = jsmn_stream_parse_buffer(&filter->stream_parser, data, length, consumed);
+
+	return r != 0 ? r : filter->error;
+}
+
+/**
+ * @brief Index of the pattern that matched the value being reported.
+ * 	The first one when several patterns match.
+ *
+ * @param filter
+ * @return int pattern index, or JSMN_STREAM_FILTER_NO_MATCH before the first match.
+ */
+int jsmn_stream_filter_match(const jsmn_stream_filter_t *filter)
+{
+	return filter->match;
+}
+
+/**
+ * @brief Patterns whose segment at a level matches an object key.
+ *
+ * @param filter
+ * @param patterns set of patterns to test.
+ * @param level
+ * @param key raw key text, NULL for a key that only matches *.
+ * @param key_length
+ * @return uint32_t the matching subset of patterns.
+ */
+static uint32_t jsmn_stream_filter_match_key(jsmn_stream_filter_t *filter, uint32_t patterns, int level, const char *key, size_t key_length)
+{
+	uint32_t matched = 0;
+
+	for (; patterns != 0; patterns &= patterns - 1)
+	{
+		int p = (int)jsmn_stream_ctz64(patterns);
+
+		if (filter->segment_index[p][level] == JSMN_STREAM_FILTER_SEGMENT_WILDCARD ||
+			(key != NULL && filter->segment_length[p][level] == key_length &&
+			memcmp(filter->patterns[p] + filter->segment_start[p][level], key, key_length) == 0))
+		{
+			matched |= (uint32_t)1 << p;
+		}
+	}
+
+	return matched;
+}
+
+/**
+ * @brief Patterns whose segment at a level matches an array index.
+ *
+ * @param filter
+ * @param patterns set of patterns to test.
+ * @param level
+ * @param index
+ * @return uint32_t the matching subset of patterns.
+ */
+static uint32_t jsmn_stream_filter_match_index(jsmn_stream_filter_t *filter, uint32_t patterns, int level, int32_t index)
+{
+	uint32_t matched = 0;
+
+	for (; patterns != 0; patterns &= patterns - 1)
+	{
+		int p = (int)jsmn_stream_ctz64(patterns);
+		int32_t segment_index = filter->segment_index[p][level];
+
+		if (segment_index == JSMN_STREAM_FILTER_SEGMENT_WILDCARD || segment_index == index)
+		{
+			matched |= (uint32_t)1 << p;
+		}
+	}
+
+	return matched;
+}
+
+/**
+ * @brief Decide what to do with a value at the current path.
+ * 	Objects and arrays that cannot contain a match are skipped.
+ *
+ * @param filter
+ * @param type JSMN_STREAM_OBJECT or JSMN_STREAM_ARRAY for the start of one,
+ * 	JSMN_STREAM_UNDEFINED for other values.
+ * @return true if the value is reported.
+ */
+static bool jsmn_stream_filter_begin_value(jsmn_stream_filter_t *filter, jsmn_streamtype_t type)
+{
+	bool container = type != JSMN_STREAM_UNDEFINED;
+	uint32_t candidates;
+	uint32_t matched = 0;
+	uint32_t deeper = 0;
+
+	if (filter->delivering > 0)
+	{
+		filter->delivering += container;
+		return true;
+	}
+
+	if (filter->depth == 0)
+	{
+		candidates = filter->num_patterns == 32 ? UINT32_MAX : ((uint32_t)1 << filter->num_patterns) - 1;
+	}
+	else
+	{
+		jsmn_stream_filter_level_t *level = &filter->levels[filter->depth - 1];
+
+		if (level->index >= 0)
+		{
+			candidates = jsmn_stream_filter_match_index(filter, level->patterns, filter->depth - 1, level->index);
+			level->index++;
+		}
+		else
+		{
+			candidates = level->candidates;
+		}
+	}
+
+	for (; candidates != 0; candidates &= candidates - 1)
+	{
+		int p = (int)jsmn_stream_ctz64(candidates);
+
+		if (filter->segment_count[p] == filter->depth)
+		{
+			matched |= (uint32_t)1 << p;
+		}
+		else
+		{
+			deeper |= (uint32_t)1 << p;
+		}
+	}
+
+	if (matched != 0)
+	{
+		filter->match = (int)jsmn_stream_ctz64(matched);
+		filter->delivering = container;
+		return true;
+	}
+
+	if (container)
+	{
+		// levels only get as deep as the longest pattern, plus a skipped one
+		jsmn_stream_filter_level_t *level = &filter->levels[filter->depth++];
+
+		level->patterns = deeper;
+		level->candidates = 0;
+		level->index = type == JSMN_STREAM_ARRAY ? 0 : -1;
+		if (deeper == 0)
+		{
+			jsmn_stream_skip(&filter->stream_parser);
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief Handle the end of an object or array.
+ *
+ * @param filter
+ * @return true if the end is reported.
+ */
+static bool jsmn_stream_filter_end_container(jsmn_stream_filter_t *filter)
+{
+	if (filter->delivering > 0)
+	{
+		filter->delivering--;
+		return true;
+	}
+
+	filter->depth--;
+	return false;
+}
+
+/**
+ * @brief Handle an object key outside of a match.
+ *
+ * @param filter
+ * @param key raw key text, NULL for a key that only matches *.
+ * @param key_length
+ * @return true if the key is reported.
+ */
+static bool jsmn_stream_filter_key(jsmn_stream_filter_t *filter, const char *key, size_t key_length)
+{
+	jsmn_stream_filter_level_t *level;
+
+	if (filter->delivering > 0)
+	{
+		return true;
+	}
+
+	level = &filter->levels[filter->depth - 1];
+	level->candidates = jsmn_stream_filter_match_key(filter, level->patterns, filter->depth - 1, key, key_length);
+	return false;
+}
+
+static void jsmn_stream_filter_start_array(void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_begin_value(filter, JSMN_STREAM_ARRAY) && filter->callbacks->start_array_callback)
+	{
+		filter->callbacks->start_array_callback(filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_end_array(void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_end_container(filter) && filter->callbacks->end_array_callback)
+	{
+		filter->callbacks->end_array_callback(filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_start_object(void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_begin_value(filter, JSMN_STREAM_OBJECT) && filter->callbacks->start_object_callback)
+	{
+		filter->callbacks->start_object_callback(filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_end_object(void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_end_container(filter) && filter->callbacks->end_object_callback)
+	{
+		filter->callbacks->end_object_callback(filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_object_key(const char *key, size_t key_length, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_key(filter, key, key_length))
+	{
+		filter->callbacks->object_key_callback(key, key_length, filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_string(const char *value, size_t length, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_begin_value(filter, JSMN_STREAM_UNDEFINED))
+	{
+		filter->callbacks->string_callback(value, length, filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_primitive(const char *value, size_t length, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_begin_value(filter, JSMN_STREAM_UNDEFINED))
+	{
+		filter->callbacks->primitive_callback(value, length, filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_object_key_span(const char *key, size_t key_length, size_t offset, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_key(filter, key, key_length) && filter->callbacks->object_key_span_callback)
+	{
+		filter->callbacks->object_key_span_callback(key, key_length, offset, filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_string_span(const char *value, size_t length, size_t offset, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_begin_value(filter, JSMN_STREAM_UNDEFINED) && filter->callbacks->string_span_callback)
+	{
+		filter->callbacks->string_span_callback(value, length, offset, filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_primitive_span(const char *value, size_t length, size_t offset, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_begin_value(filter, JSMN_STREAM_UNDEFINED) && filter->callbacks->primitive_span_callback)
+	{
+		filter->callbacks->primitive_span_callback(value, length, offset, filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_object_key_decoded(const char *key, size_t key_length, size_t offset, bool escaped, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_key(filter, key, key_length))
+	{
+		filter->callbacks->object_key_decoded_callback(key, key_length, offset, escaped, filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_string_decoded(const char *value, size_t length, size_t offset, bool escaped, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_begin_value(filter, JSMN_STREAM_UNDEFINED))
+	{
+		filter->callbacks->string_decoded_callback(value, length, offset, escaped, filter->user_arg);
+	}
+}
+
+/**
+ * @brief Callback used for the pieces of a long key.
+ * 	Outside of a match the key is only compared with * segments, when the
+ * 	last piece arrives.
+ */
+static void jsmn_stream_filter_key_fragment(const char *key, size_t key_length, size_t offset, bool final, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (!filter->fragmenting)
+	{
+		filter->fragmenting = true;
+		filter->fragment_matched = filter->delivering > 0;
+	}
+	if (final)
+	{
+		filter->fragmenting = false;
+		jsmn_stream_filter_key(filter, NULL, 0);
+	}
+
+	if (filter->fragment_matched)
+	{
+		if (filter->callbacks->key_fragment_callback)
+		{
+			filter->callbacks->key_fragment_callback(key, key_length, offset, final, filter->user_arg);
+		}
+		else
+		{
+			filter->error = JSMN_STREAM_ERROR_NOMEM;
+		}
+	}
+}
+
+/**
+ * @brief Callback used for the pieces of a long string.
+ */
+static void jsmn_stream_filter_string_fragment(const char *value, size_t length, size_t offset, bool final, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (!filter->fragmenting)
+	{
+		filter->fragmenting = true;
+		filter->fragment_matched = jsmn_stream_filter_begin_value(filter, JSMN_STREAM_UNDEFINED);
+	}
+	if (final)
+	{
+		filter->fragmenting = false;
+	}
+
+	if (filter->fragment_matched)
+	{
+		if (filter->callbacks->string_fragment_callback)
+		{
+			filter->callbacks->string_fragment_callback(value, length, offset, final, filter->user_arg);
+		}
+		else
+		{
+			filter->error = JSMN_STREAM_ERROR_NOMEM;
+		}
+	}
+}
+
+static void jsmn_stream_filter_int64(int64_t value, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_begin_value(filter, JSMN_STREAM_UNDEFINED))
+	{
+		filter->callbacks->int64_callback(value, filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_uint64(uint64_t value, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_begin_value(filter, JSMN_STREAM_UNDEFINED))
+	{
+		filter->callbacks->uint64_callback(value, filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_double(double value, bool overflow, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_begin_value(filter, JSMN_STREAM_UNDEFINED))
+	{
+		filter->callbacks->double_callback(value, overflow, filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_bool(bool value, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_begin_value(filter, JSMN_STREAM_UNDEFINED))
+	{
+		filter->callbacks->bool_callback(value, filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_null(void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	if (jsmn_stream_filter_begin_value(filter, JSMN_STREAM_UNDEFINED))
+	{
+		filter->callbacks->null_callback(filter->user_arg);
+	}
+}
+
+static void jsmn_stream_filter_document_end(size_t start, size_t end, void *user_arg)
+{
+	jsmn_stream_filter_t *filter = (jsmn_stream_filter_t *)user_arg;
+
+	// every document ends, matched or not
+	filter->callbacks->document_end_callback(start, end, filter->user_arg);
+}
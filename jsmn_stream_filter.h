@@ -0,0 +1,74 @@
+#ifndef __JSMN_STREAM_FILTER_H_
+#define __JSMN_STREAM_FILTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "jsmn_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Determines how many patterns a filter can subscribe to, at most 32 */
+#ifndef JSMN_STREAM_FILTER_MAX_PATTERNS
+#define JSMN_STREAM_FILTER_MAX_PATTERNS 8
+#endif
+#if JSMN_STREAM_FILTER_MAX_PATTERNS > 32
+#error "JSMN_STREAM_FILTER_MAX_PATTERNS must be at most 32"
+#endif
+/* Determines how many segments a pattern can have */
+#ifndef JSMN_STREAM_FILTER_MAX_SEGMENTS
+#define JSMN_STREAM_FILTER_MAX_SEGMENTS 16
+#endif
+
+#define JSMN_STREAM_FILTER_NO_MATCH -1
+
+/**
+ * @brief Object or array on the path to a subscribed value.
+ *
+ */
+typedef struct {
+  uint32_t patterns; // patterns that match the path up to this level
+  uint32_t candidates; // patterns that match the path up to the current key
+  int32_t index; // index of the next array element, -1 in an object
+} jsmn_stream_filter_level_t;
+
+/**
+ * @brief Parser that reports only the values at subscribed paths.
+ * 	Patterns are JSON Pointer like, e.g. "/users/0/name", and a segment of
+ * 	just * matches any key or array index.
+ *
+ */
+typedef struct {
+  jsmn_stream_parser stream_parser;
+#if !JSMN_STREAM_DEFAULT_STORAGE
+  char stream_buffer[JSMN_STREAM_BUFFER_SIZE];
+  jsmn_stream_stack_t stream_type_stack[JSMN_STREAM_STACK_WORDS(JSMN_STREAM_MAX_DEPTH)];
+#endif
+  jsmn_stream_callbacks_t filter_callbacks;
+  const jsmn_stream_callbacks_t *callbacks;
+  void *user_arg;
+  const char *const *patterns;
+  int num_patterns;
+  uint8_t segment_count[JSMN_STREAM_FILTER_MAX_PATTERNS];
+  uint16_t segment_start[JSMN_STREAM_FILTER_MAX_PATTERNS][JSMN_STREAM_FILTER_MAX_SEGMENTS];
+  uint16_t segment_length[JSMN_STREAM_FILTER_MAX_PATTERNS][JSMN_STREAM_FILTER_MAX_SEGMENTS];
+  int32_t segment_index[JSMN_STREAM_FILTER_MAX_PATTERNS][JSMN_STREAM_FILTER_MAX_SEGMENTS];
+  jsmn_stream_filter_level_t levels[JSMN_STREAM_FILTER_MAX_SEGMENTS + 1];
+  int depth; // number of open objects and arrays outside of a match
+  int delivering; // number of open objects and arrays inside a match
+  int match;
+  bool fragmenting; // a key or string is being parsed in fragments
+  bool fragment_matched; // and it is delivered
+  int error;
+} jsmn_stream_filter_t;
+
+int jsmn_stream_filter_init(jsmn_stream_filter_t *filter, const char *const *patterns, int num_patterns, const jsmn_stream_callbacks_t *callbacks, void *user_arg);
+int jsmn_stream_filter_parse(jsmn_stream_filter_t *filter, const char *data, size_t length, size_t *consumed);
+int jsmn_stream_filter_match(const jsmn_stream_filter_t *filter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSMN_STREAM_FILTER_H_ */
@@ -0,0 +1,1341 @@
+/**
+ * The parser state machine, shared by jsmn_stream.c and the C++ parser in
+ * jsmn_stream.hpp. It has no include guard and no includes of its own: the
+ * including file includes jsmn_stream.h, jsmn_stream_simd.h,
+ * jsmn_stream_number.h and string.h first and defines how events are
+ * delivered:
+ *
+ *   JSMN_STREAM_IMPL_STATIC      storage class of functions without events
+ *   JSMN_STREAM_IMPL_EMITTER     storage class (and template head) of
+ *                                functions that deliver events
+ *   JSMN_STREAM_IMPL_PARAM       leading parameter of those functions that
+ *                                carries the event consumer, may be empty
+ *   JSMN_STREAM_IMPL_ARG         the matching leading argument
+ *   JSMN_STREAM_EMIT_EVENT(event)
+ *                                start_object, end_object, start_array or
+ *                                end_array happened
+ *   JSMN_STREAM_HAS_SPAN(type)   the consumer of a key, string or primitive
+ *                                takes a pointer and length, no copy needed
+ *   JSMN_STREAM_EMIT_SPAN(type, value, length)
+ *   JSMN_STREAM_EMIT_VALUE(type, value, length)
+ *                                deliver a null terminated copy
+ *   JSMN_STREAM_HAS_DECODED(type)
+ *                                the consumer of a key or string takes it
+ *                                with escape sequences decoded
+ *   JSMN_STREAM_HAS_FRAGMENTS(type)
+ *                                values too long for the buffer may be
+ *                                delivered in pieces
+ *   JSMN_STREAM_EMIT_FRAGMENT(type, value, length, final)
+ *   JSMN_STREAM_HAS_TYPED(name)  the consumer takes primitives converted to
+ *                                int64, uint64, double, bool or null
+ *   JSMN_STREAM_EMIT_TYPED(name, value...)
+ *                                deliver a converted primitive, null goes
+ *                                through JSMN_STREAM_EMIT_EVENT(null)
+ *   JSMN_STREAM_EMIT_DOCUMENT_END(start, end)
+ *                                a top level value ended
+ *
+ * The value macros may refer to parser->value_offset, and to
+ * parser->escaped for a decoded key or string. A consumer that
+ * returns a jsmn_stream_action_t hands it to jsmn_stream_impl_request().
+ */
+
+/*
+ * jsmn_stream_step() is called per character from more than one loop. The
+ * C++ parser functions are inline already.
+ */
+#if defined(__GNUC__) && defined(__cplusplus)
+#define JSMN_STREAM_IMPL_INLINE __attribute__((always_inline))
+#elif defined(__GNUC__)
+#define JSMN_STREAM_IMPL_INLINE __attribute__((always_inline)) inline
+#elif defined(__cplusplus)
+#define JSMN_STREAM_IMPL_INLINE
+#else
+#define JSMN_STREAM_IMPL_INLINE inline
+#endif
+
+/**
+ * Records what a callback asked the parser to do after the current event.
+ * Stopping wins over skipping.
+ */
+JSMN_STREAM_IMPL_STATIC void jsmn_stream_impl_request(jsmn_stream_parser *parser,
+	jsmn_stream_action_t action) {
+	if (action > parser->action) {
+		parser->action = (unsigned char)action;
+	}
+}
+
+#if JSMN_STREAM_PACKED_STACK
+/* Type codes of the packed stack levels */
+#define JSMN_STREAM_PACKED_OBJECT 1U
+#define JSMN_STREAM_PACKED_ARRAY 2U
+#define JSMN_STREAM_PACKED_OBJECT_KEY 3U
+
+/* Word and bit position of a level in the packed stack */
+#define JSMN_STREAM_PACKED_WORD(level) ((level) / JSMN_STREAM_STACK_LEVELS_PER_WORD)
+#define JSMN_STREAM_PACKED_SHIFT(level) (((level) % JSMN_STREAM_STACK_LEVELS_PER_WORD) * 2)
+
+JSMN_STREAM_IMPL_STATIC size_t jsmn_stream_stack_top_code(jsmn_stream_parser *parser) {
+	size_t level = parser->stack_height - 1;
+	return (parser->type_stack[JSMN_STREAM_PACKED_WORD(level)] >>
+		JSMN_STREAM_PACKED_SHIFT(level)) & 3U;
+}
+
+JSMN_STREAM_IMPL_STATIC void jsmn_stream_stack_set_top_code(jsmn_stream_parser *parser, size_t code) {
+	size_t level = parser->stack_height - 1;
+	jsmn_stream_stack_t *word = &parser->type_stack[JSMN_STREAM_PACKED_WORD(level)];
+	*word = (*word & ~((jsmn_stream_stack_t)3U << JSMN_STREAM_PACKED_SHIFT(level))) |
+		((jsmn_stream_stack_t)code << JSMN_STREAM_PACKED_SHIFT(level));
+}
+
+/*
+ * A key is only ever pushed on top of an object, so it is stored by marking
+ * the object level instead of taking a level of its own.
+ */
+JSMN_STREAM_IMPL_STATIC bool jsmn_stream_stack_push(jsmn_stream_parser *parser, jsmn_streamtype_t type) {
+	if (type == JSMN_STREAM_KEY) {
+		jsmn_stream_stack_set_top_code(parser, JSMN_STREAM_PACKED_OBJECT_KEY);
+		return true;
+	}
+	if (parser->stack_height >= parser->stack_capacity) {
+		return false;
+	}
+	parser->stack_height++;
+	jsmn_stream_stack_set_top_code(parser, type == JSMN_STREAM_OBJECT ?
+		JSMN_STREAM_PACKED_OBJECT : JSMN_STREAM_PACKED_ARRAY);
+	return true;
+}
+
+JSMN_STREAM_IMPL_STATIC void jsmn_stream_stack_pop(jsmn_stream_parser *parser) {
+	if (parser->stack_height == 0) {
+		return;
+	}
+	if (jsmn_stream_stack_top_code(parser) == JSMN_STREAM_PACKED_OBJECT_KEY) {
+		jsmn_stream_stack_set_top_code(parser, JSMN_STREAM_PACKED_OBJECT);
+	} else {
+		parser->stack_height--;
+	}
+}
+
+JSMN_STREAM_IMPL_STATIC jsmn_streamtype_t jsmn_stream_stack_top(jsmn_stream_parser *parser) {
+	if (parser->stack_height == 0) {
+		return JSMN_STREAM_UNDEFINED;
+	}
+	switch (jsmn_stream_stack_top_code(parser)) {
+		case JSMN_STREAM_PACKED_OBJECT:
+			return JSMN_STREAM_OBJECT;
+		case JSMN_STREAM_PACKED_ARRAY:
+			return JSMN_STREAM_ARRAY;
+		default:
+			return JSMN_STREAM_KEY;
+	}
+}
+#else
+JSMN_STREAM_IMPL_STATIC bool jsmn_stream_stack_push(jsmn_stream_parser *parser, jsmn_streamtype_t type) {
+	if (parser->stack_height >= parser->stack_capacity) {
+		return false;
+	}
+	parser->type_stack[parser->stack_height++] = (jsmn_stream_stack_t)type;
+	return true;
+}
+
+JSMN_STREAM_IMPL_STATIC void jsmn_stream_stack_pop(jsmn_stream_parser *parser) {
+	// We don't need to return the popped item, so just decrement height.
+	if (parser->stack_height > 0) parser->stack_height--;
+}
+
+JSMN_STREAM_IMPL_STATIC jsmn_streamtype_t jsmn_stream_stack_top(jsmn_stream_parser *parser) {
+	if (parser->stack_height == 0) {
+		return JSMN_STREAM_UNDEFINED;
+	}
+	return (jsmn_streamtype_t)parser->type_stack[parser->stack_height - 1];
+}
+#endif
+
+/**
+ * Appends characters of the current value to the buffer. When the buffer
+ * fills up and the type can be delivered in fragments, the buffer is
+ * delivered as a fragment and emptied.
+ */
+JSMN_STREAM_IMPL_EMITTER int jsmn_stream_buffer_append(JSMN_STREAM_IMPL_PARAM
+	jsmn_stream_parser *parser, jsmn_streamtype_t type, const char *chars,
+	size_t length) {
+	/* Leave space for the terminating null character */
+	size_t room = parser->buffer_capacity - 1 - parser->buffer_size;
+
+	while (length > room) {
+		if (!JSMN_STREAM_HAS_FRAGMENTS(type)) {
+			return JSMN_STREAM_ERROR_NOMEM;
+		}
+		memcpy(parser->buffer + parser->buffer_size, chars, room);
+		parser->buffer_size += room;
+		parser->buffer[parser->buffer_size] = '\0';
+		JSMN_STREAM_EMIT_FRAGMENT(type, parser->buffer, parser->buffer_size, false);
+		parser->buffer_size = 0;
+		parser->fragmented = true;
+		chars += room;
+		length -= room;
+		room = parser->buffer_capacity - 1;
+	}
+	memcpy(parser->buffer + parser->buffer_size, chars, length);
+	parser->buffer_size += length;
+	return 0;
+}
+
+/**
+ * Delivers a primitive to the typed callbacks. Returns false if it has to go
+ * to the primitive callbacks instead: there is no typed consumer for it, it
+ * is not a valid number or literal, or it needs the exact conversion and is
+ * too long to copy into the buffer.
+ */
+JSMN_STREAM_IMPL_EMITTER bool jsmn_stream_emit_typed(JSMN_STREAM_IMPL_PARAM
+	jsmn_stream_parser *parser, const char *chars, size_t length) {
+	jsmn_stream_number_t number;
+	double value;
+	bool overflow;
+
+	switch (chars[0]) {
+		case 't':
+			if (!JSMN_STREAM_HAS_TYPED(bool) || !jsmn_stream_is_true(chars, length)) {
+				return false;
+			}
+			JSMN_STREAM_EMIT_TYPED(bool, true);
+			return true;
+		case 'f':
+			if (!JSMN_STREAM_HAS_TYPED(bool) || !jsmn_stream_is_false(chars, length)) {
+				return false;
+			}
+			JSMN_STREAM_EMIT_TYPED(bool, false);
+			return true;
+		case 'n':
+			if (!JSMN_STREAM_HAS_TYPED(null) || !jsmn_stream_is_null(chars, length)) {
+				return false;
+			}
+			JSMN_STREAM_EMIT_EVENT(null);
+			return true;
+		default:
+			break;
+	}
+
+	if (!(JSMN_STREAM_HAS_TYPED(int64) || JSMN_STREAM_HAS_TYPED(uint64) ||
+		JSMN_STREAM_HAS_TYPED(double)) || !jsmn_stream_number_scan(chars, length, &number)) {
+		return false;
+	}
+	if (number.integer && number.exponent == 0 && !number.truncated) {
+		if (JSMN_STREAM_HAS_TYPED(int64) && number.mantissa <=
+			(number.negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX)) {
+			JSMN_STREAM_EMIT_TYPED(int64, number.negative && number.mantissa != 0 ?
+				-(int64_t)(number.mantissa - 1) - 1 : (int64_t)number.mantissa);
+			return true;
+		}
+		if (JSMN_STREAM_HAS_TYPED(uint64) && !number.negative) {
+			JSMN_STREAM_EMIT_TYPED(uint64, number.mantissa);
+			return true;
+		}
+	}
+	if (!JSMN_STREAM_HAS_TYPED(double)) {
+		return false;
+	}
+	/* An integer that did not fit the integer callbacks loses precision */
+	overflow = number.integer &&
+		(JSMN_STREAM_HAS_TYPED(int64) || JSMN_STREAM_HAS_TYPED(uint64));
+	if (!jsmn_stream_number_fast_double(&number, &value)) {
+		/* The exact conversion needs a null terminated copy */
+		if (chars != parser->buffer) {
+			if (length >= parser->buffer_capacity) {
+				return false;
+			}
+			memcpy(parser->buffer, chars, length);
+			parser->buffer[length] = '\0';
+		}
+		value = strtod(parser->buffer, NULL);
+		overflow |= jsmn_stream_double_overflow(value);
+	}
+	JSMN_STREAM_EMIT_TYPED(double, value, overflow);
+	return true;
+}
+
+/**
+ * Delivers a completed key, string or primitive. The characters of the value
+ * that arrived in the current chunk are passed in, earlier characters are
+ * already in the buffer. A span consumer gets a pointer into the chunk when
+ * the whole value is there, otherwise the value is copied into the buffer.
+ * Values that were already partly delivered in fragments are finished with
+ * a final fragment. Primitives go to the typed callbacks first.
+ */
+JSMN_STREAM_IMPL_EMITTER int jsmn_stream_emit_value(JSMN_STREAM_IMPL_PARAM
+	jsmn_stream_parser *parser, jsmn_streamtype_t type, const char *chars,
+	size_t length) {
+	bool typed = type == JSMN_STREAM_PRIMITIVE && (JSMN_STREAM_HAS_TYPED(int64) ||
+		JSMN_STREAM_HAS_TYPED(uint64) || JSMN_STREAM_HAS_TYPED(double) ||
+		JSMN_STREAM_HAS_TYPED(bool) || JSMN_STREAM_HAS_TYPED(null));
+	int r;
+
+	if (typed && parser->buffer_size == 0) {
+		if (jsmn_stream_emit_typed(JSMN_STREAM_IMPL_ARG parser, chars, length)) {
+			return 0;
+		}
+		typed = false;
+	}
+
+	if (JSMN_STREAM_HAS_SPAN(type) && parser->buffer_size == 0 && !parser->fragmented) {
+		JSMN_STREAM_EMIT_SPAN(type, chars, length);
+		return 0;
+	}
+
+	r = jsmn_stream_buffer_append(JSMN_STREAM_IMPL_ARG parser, type, chars, length);
+	if (r < 0) return r;
+	parser->buffer[parser->buffer_size] = '\0';
+	if (parser->fragmented) {
+		JSMN_STREAM_EMIT_FRAGMENT(type, parser->buffer, parser->buffer_size, true);
+		parser->fragmented = false;
+	} else if (typed && jsmn_stream_emit_typed(JSMN_STREAM_IMPL_ARG parser,
+		parser->buffer, parser->buffer_size)) {
+		/* Delivered converted */
+	} else if (JSMN_STREAM_HAS_SPAN(type)) {
+		JSMN_STREAM_EMIT_SPAN(type, parser->buffer, parser->buffer_size);
+	} else {
+		JSMN_STREAM_EMIT_VALUE(type, parser->buffer, parser->buffer_size);
+	}
+	parser->buffer_size = 0;
+	return 0;
+}
+
+/**
+ * Checks the next character of a JSON primitive. Returns 0 when the
+ * character ends the primitive.
+ */
+JSMN_STREAM_IMPL_STATIC int jsmn_stream_parse_primitive(jsmn_stream_parser *parser, char c) {
+	(void)parser;
+	switch (c) {
+		case '\t' : case '\r' : case '\n' : case ' ' :
+		case ','  : case ']'  : case '}' :
+			return 0;
+	}
+	if ((unsigned char)c < 32 || (unsigned char)c >= 127) {
+		return JSMN_STREAM_ERROR_INVAL;
+	}
+	/* In strict mode primitive must be followed by a comma/object/array */
+	return JSMN_STREAM_ERROR_PART;
+}
+
+/**
+ * Checks the next character of a JSON string. Returns 0 when the character
+ * ends the string. The progress through escape sequences is kept in the
+ * parser, so each character is looked at exactly once.
+ */
+JSMN_STREAM_IMPL_STATIC int jsmn_stream_parse_string(jsmn_stream_parser *parser, char c) {
+	switch (parser->escape) {
+		case JSMN_STREAM_ESCAPE_NONE:
+			/* Quote: end of string */
+			if (c == '\"') {
+				return 0;
+			}
+			/* Backslash: Quoted symbol expected */
+			if (c == '\\') {
+				parser->escape = JSMN_STREAM_ESCAPE_BACKSLASH;
+			}
+			/* Control characters must be escaped */
+			else if ((unsigned char)c < 32) {
+				return JSMN_STREAM_ERROR_INVAL;
+			}
+			break;
+
+		case JSMN_STREAM_ESCAPE_BACKSLASH:
+			switch (c) {
+				/* Allowed escaped symbols */
+				case '\"': case '/' : case '\\' : case 'b' :
+				case 'f' : case 'r' : case 'n'  : case 't' :
+					parser->escape = JSMN_STREAM_ESCAPE_NONE;
+					break;
+				/* Allows escaped symbol \uXXXX */
+				case 'u':
+					parser->escape = JSMN_STREAM_ESCAPE_UNICODE;
+					parser->unicode &= 0xFFFF0000U;
+					break;
+				/* Unexpected symbol */
+				default:
+					return JSMN_STREAM_ERROR_INVAL;
+			}
+			break;
+
+		default:
+			/* If it isn't a hex character we have an error */
+			if (!((c >= 48 && c <= 57) || /* 0-9 */
+						(c >= 65 && c <= 70) || /* A-F */
+						(c >= 97 && c <= 102))) { /* a-f */
+				return JSMN_STREAM_ERROR_INVAL;
+			}
+			parser->unicode = (parser->unicode & 0xFFFF0000U) | ((parser->unicode << 4) & 0xFFF0U) |
+				(uint32_t)(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+			/* Count the hex digits up to the fourth one */
+			parser->escape = parser->escape == JSMN_STREAM_ESCAPE_UNICODE + 3 ?
+				JSMN_STREAM_ESCAPE_NONE : parser->escape + 1;
+			break;
+	}
+	return JSMN_STREAM_ERROR_PART;
+}
+
+/**
+ * Handles a character outside of strings and primitives. May switch the
+ * parser into string or primitive state.
+ */
+JSMN_STREAM_IMPL_EMITTER int jsmn_stream_parse_structural(JSMN_STREAM_IMPL_PARAM
+	jsmn_stream_parser *parser, char c, jsmn_streamstate_t *state) {
+	jsmn_streamtype_t type;
+
+	switch (c) {
+		case '{': case '[':
+			if (parser->stack_height == 0) {
+				parser->document_start = parser->position - 1;
+			}
+			if (c == '{') {
+				type = JSMN_STREAM_OBJECT;
+				JSMN_STREAM_EMIT_EVENT(start_object);
+			} else {
+				type = JSMN_STREAM_ARRAY;
+				JSMN_STREAM_EMIT_EVENT(start_array);
+			}
+			if (!jsmn_stream_stack_push(parser, type)) {
+				return JSMN_STREAM_ERROR_MAX_DEPTH;
+			}
+			break;
+		case '}': case ']':
+			if (c == '}') {
+				JSMN_STREAM_EMIT_EVENT(end_object);
+			} else {
+				JSMN_STREAM_EMIT_EVENT(end_array);
+			}
+			jsmn_stream_stack_pop(parser);
+			if (jsmn_stream_stack_top(parser) == JSMN_STREAM_KEY) {
+				jsmn_stream_stack_pop(parser);
+			}
+			if (parser->stack_height == 0) {
+				JSMN_STREAM_EMIT_DOCUMENT_END(parser->document_start, parser->position);
+			}
+			break;
+		case '\"':
+			if (parser->stack_height == 0) {
+				parser->document_start = parser->position - 1;
+			}
+			parser->escaped = false;
+			*state = JSMN_STREAM_PARSING_STRING;
+			break;
+		case '\n':
+			/* In lines mode a document cannot span lines */
+			if (parser->lines && parser->stack_height > 0) {
+				return JSMN_STREAM_ERROR_INVAL;
+			}
+			break;
+		case '\t' : case '\r' : case ' ' : case ',':
+			break;
+		case ':':
+			if (jsmn_stream_stack_top(parser) == JSMN_STREAM_OBJECT &&
+				!jsmn_stream_stack_push(parser, JSMN_STREAM_KEY)) {
+				return JSMN_STREAM_ERROR_MAX_DEPTH;
+			}
+			break;
+		/* In strict mode primitives are: numbers and booleans */
+		case '-': case '0': case '1' : case '2': case '3' : case '4':
+		case '5': case '6': case '7' : case '8': case '9':
+		case 't': case 'f': case 'n' :
+			if (jsmn_stream_stack_top(parser) == JSMN_STREAM_OBJECT) {
+				return JSMN_STREAM_ERROR_INVAL;
+			}
+			if (parser->stack_height == 0) {
+				parser->document_start = parser->position - 1;
+			}
+			*state = JSMN_STREAM_PARSING_PRIMITIVE;
+			break;
+
+		/* Unexpected char in strict mode */
+		default:
+			return JSMN_STREAM_ERROR_INVAL;
+	}
+	return 0;
+}
+
+/* Progress of the parser through one chunk of input */
+typedef struct {
+	const char *data;
+	size_t len;
+	size_t position; /* Stream offset of data[0] */
+	size_t segment; /* Start of the characters of the current value within data */
+	jsmn_streamstate_t state;
+} jsmn_stream_chunk_t;
+
+/**
+ * Appends a code point to the buffer as UTF-8.
+ */
+JSMN_STREAM_IMPL_EMITTER int jsmn_stream_buffer_append_utf8(JSMN_STREAM_IMPL_PARAM
+	jsmn_stream_parser *parser, jsmn_streamtype_t type, uint32_t code_point) {
+	char utf8[4];
+	size_t length;
+
+	if (code_point < 0x80) {
+		utf8[0] = (char)code_point;
+		length = 1;
+	} else if (code_point < 0x800) {
+		utf8[0] = (char)(0xC0 | (code_point >> 6));
+		utf8[1] = (char)(0x80 | (code_point & 0x3F));
+		length = 2;
+	} else if (code_point < 0x10000) {
+		utf8[0] = (char)(0xE0 | (code_point >> 12));
+		utf8[1] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+		utf8[2] = (char)(0x80 | (code_point & 0x3F));
+		length = 3;
+	} else {
+		utf8[0] = (char)(0xF0 | (code_point >> 18));
+		utf8[1] = (char)(0x80 | ((code_point >> 12) & 0x3F));
+		utf8[2] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+		utf8[3] = (char)(0x80 | (code_point & 0x3F));
+		length = 4;
+	}
+	return jsmn_stream_buffer_append(JSMN_STREAM_IMPL_ARG parser, type, utf8, length);
+}
+
+/**
+ * Checks the next character of a JSON string like jsmn_stream_parse_string()
+ * and decodes escape sequences on the way. The plain characters before an
+ * escape sequence are moved to the buffer at its backslash, and the
+ * sequence is replaced by its UTF-8 there once it is complete, so the
+ * current value continues in the chunk after it. A high surrogate is held
+ * in the parser until the next character shows whether its low surrogate
+ * follows.
+ */
+JSMN_STREAM_IMPL_EMITTER int jsmn_stream_decode_string(JSMN_STREAM_IMPL_PARAM
+	jsmn_stream_parser *parser, jsmn_stream_chunk_t *chunk, size_t i,
+	jsmn_streamtype_t type) {
+	char c = chunk->data[i];
+	unsigned char escape = parser->escape;
+	uint32_t unit;
+	int r;
+
+	if ((escape == JSMN_STREAM_ESCAPE_SURROGATE && c != '\\') ||
+		(escape == JSMN_STREAM_ESCAPE_SURROGATE_BACKSLASH && c != 'u')) {
+		/* The high surrogate is alone, c is looked at as usual */
+		r = jsmn_stream_buffer_append_utf8(JSMN_STREAM_IMPL_ARG parser, type, 0xFFFD);
+		if (r < 0) return r;
+		parser->unicode = 0;
+		escape = escape == JSMN_STREAM_ESCAPE_SURROGATE ?
+			JSMN_STREAM_ESCAPE_NONE : JSMN_STREAM_ESCAPE_BACKSLASH;
+		parser->escape = escape;
+	}
+	switch (escape) {
+		case JSMN_STREAM_ESCAPE_SURROGATE:
+			parser->escape = JSMN_STREAM_ESCAPE_SURROGATE_BACKSLASH;
+			chunk->segment = i + 1;
+			return JSMN_STREAM_ERROR_PART;
+		case JSMN_STREAM_ESCAPE_SURROGATE_BACKSLASH:
+			parser->escape = JSMN_STREAM_ESCAPE_UNICODE;
+			parser->unicode &= 0xFFFF0000U;
+			chunk->segment = i + 1;
+			return JSMN_STREAM_ERROR_PART;
+		case JSMN_STREAM_ESCAPE_NONE:
+			if (c != '\\') {
+				return jsmn_stream_parse_string(parser, c);
+			}
+			r = jsmn_stream_buffer_append(JSMN_STREAM_IMPL_ARG parser, type,
+				chunk->data + chunk->segment, i - chunk->segment);
+			if (r < 0) return r;
+			parser->escaped = true;
+			break;
+		default:
+			break;
+	}
+
+	r = jsmn_stream_parse_string(parser, c);
+	if (r != JSMN_STREAM_ERROR_PART) {
+		return r;
+	}
+	chunk->segment = i + 1;
+	if (escape == JSMN_STREAM_ESCAPE_NONE || parser->escape != JSMN_STREAM_ESCAPE_NONE) {
+		return JSMN_STREAM_ERROR_PART;
+	}
+
+	/* c ended the escape sequence */
+	if (escape == JSMN_STREAM_ESCAPE_BACKSLASH) {
+		switch (c) {
+			case 'b': c = '\b'; break;
+			case 'f': c = '\f'; break;
+			case 'n': c = '\n'; break;
+			case 'r': c = '\r'; break;
+			case 't': c = '\t'; break;
+			default: break;
+		}
+		r = jsmn_stream_buffer_append(JSMN_STREAM_IMPL_ARG parser, type, &c, 1);
+		return r < 0 ? r : JSMN_STREAM_ERROR_PART;
+	}
+	unit = parser->unicode & 0xFFFFU;
+	if (parser->unicode >> 16 != 0) {
+		if (unit >= 0xDC00 && unit <= 0xDFFF) {
+			r = jsmn_stream_buffer_append_utf8(JSMN_STREAM_IMPL_ARG parser, type,
+				0x10000 + (((parser->unicode >> 16) - 0xD800) << 10) + (unit - 0xDC00));
+			parser->unicode = 0;
+			return r < 0 ? r : JSMN_STREAM_ERROR_PART;
+		}
+		r = jsmn_stream_buffer_append_utf8(JSMN_STREAM_IMPL_ARG parser, type, 0xFFFD);
+		if (r < 0) return r;
+	}
+	if (unit >= 0xD800 && unit <= 0xDBFF) {
+		parser->unicode = unit << 16;
+		parser->escape = JSMN_STREAM_ESCAPE_SURROGATE;
+		return JSMN_STREAM_ERROR_PART;
+	}
+	parser->unicode = 0;
+	r = jsmn_stream_buffer_append_utf8(JSMN_STREAM_IMPL_ARG parser, type,
+		unit >= 0xDC00 && unit <= 0xDFFF ? 0xFFFD : unit);
+	return r < 0 ? r : JSMN_STREAM_ERROR_PART;
+}
+
+/**
+ * Returns true in the states inside a string, skipped or not.
+ */
+JSMN_STREAM_IMPL_STATIC bool jsmn_stream_state_is_string(jsmn_streamstate_t state) {
+	return state == JSMN_STREAM_PARSING_STRING || state == JSMN_STREAM_SKIPPING_STRING;
+}
+
+/**
+ * Returns true in the states inside a skipped object or array.
+ */
+JSMN_STREAM_IMPL_STATIC bool jsmn_stream_state_is_skipping(jsmn_streamstate_t state) {
+	return state == JSMN_STREAM_SKIPPING || state == JSMN_STREAM_SKIPPING_STRING;
+}
+
+/**
+ * Carries out the action a callback asked for during the current event.
+ * Skipping starts on the rest of the innermost open object or array,
+ * outside of any there is nothing to skip.
+ */
+JSMN_STREAM_IMPL_STATIC int jsmn_stream_take_action(jsmn_stream_parser *parser,
+	jsmn_stream_chunk_t *chunk) {
+	jsmn_stream_action_t action = (jsmn_stream_action_t)parser->action;
+
+	parser->action = JSMN_STREAM_CONTINUE;
+	if (action == JSMN_STREAM_STOP) {
+		return JSMN_STREAM_STOPPED;
+	}
+	if (parser->stack_height > 0) {
+		parser->skip_depth = 0;
+		chunk->state = JSMN_STREAM_SKIPPING;
+	}
+	return 0;
+}
+
+/**
+ * Handles the character at offset i of the chunk.
+ */
+JSMN_STREAM_IMPL_EMITTER JSMN_STREAM_IMPL_INLINE int jsmn_stream_step(JSMN_STREAM_IMPL_PARAM
+	jsmn_stream_parser *parser, jsmn_stream_chunk_t *chunk, size_t i) {
+	char c = chunk->data[i];
+	jsmn_streamtype_t type;
+	int r;
+
+	switch (chunk->state) {
+		case JSMN_STREAM_PARSING_STRING:
+			type = jsmn_stream_stack_top(parser) == JSMN_STREAM_OBJECT ?
+				JSMN_STREAM_KEY : JSMN_STREAM_STRING;
+			if (JSMN_STREAM_HAS_DECODED(type)) {
+				r = jsmn_stream_decode_string(JSMN_STREAM_IMPL_ARG parser, chunk, i, type);
+			} else {
+				r = jsmn_stream_parse_string(parser, c);
+			}
+			if (r == JSMN_STREAM_ERROR_PART) {
+				return 0;
+			}
+			if (r < 0) return r;
+			/* Callbacks may look at the position of the current event */
+			parser->position = chunk->position + i + 1;
+			r = jsmn_stream_emit_value(JSMN_STREAM_IMPL_ARG parser, type,
+				chunk->data + chunk->segment, i - chunk->segment);
+			if (r < 0) return r;
+			if (jsmn_stream_stack_top(parser) == JSMN_STREAM_KEY) {
+				jsmn_stream_stack_pop(parser);
+			} else if (parser->stack_height == 0) {
+				JSMN_STREAM_EMIT_DOCUMENT_END(parser->document_start, parser->position);
+			}
+			chunk->state = JSMN_STREAM_PARSING;
+			if (parser->action != JSMN_STREAM_CONTINUE) {
+				return jsmn_stream_take_action(parser, chunk);
+			}
+			return 0;
+
+		case JSMN_STREAM_PARSING_PRIMITIVE:
+			r = jsmn_stream_parse_primitive(parser, c);
+			if (r == JSMN_STREAM_ERROR_PART) {
+				return 0;
+			}
+			if (r < 0) return r;
+			parser->position = chunk->position + i + 1;
+			r = jsmn_stream_emit_value(JSMN_STREAM_IMPL_ARG parser, JSMN_STREAM_PRIMITIVE,
+				chunk->data + chunk->segment, i - chunk->segment);
+			if (r < 0) return r;
+			if (jsmn_stream_stack_top(parser) == JSMN_STREAM_KEY) {
+				jsmn_stream_stack_pop(parser);
+			} else if (parser->stack_height == 0) {
+				/* The document ends before the character that ended it */
+				JSMN_STREAM_EMIT_DOCUMENT_END(parser->document_start, chunk->position + i);
+			}
+			chunk->state = JSMN_STREAM_PARSING;
+			if (parser->action == JSMN_STREAM_STOP) {
+				/* The character that ended the primitive is left for later */
+				parser->position = chunk->position + i;
+				return jsmn_stream_take_action(parser, chunk);
+			}
+			if (parser->action == JSMN_STREAM_SKIP_VALUE) {
+				if (c != '}' && c != ']') {
+					return jsmn_stream_take_action(parser, chunk);
+				}
+				/* The rest of the object or array is empty */
+				parser->action = JSMN_STREAM_CONTINUE;
+			}
+			/* The character that ended the primitive is handled as usual */
+			/* fall through */
+
+		case JSMN_STREAM_PARSING:
+			parser->position = chunk->position + i + 1;
+			r = jsmn_stream_parse_structural(JSMN_STREAM_IMPL_ARG parser, c, &chunk->state);
+			if (r < 0) return r;
+			if (parser->action != JSMN_STREAM_CONTINUE) {
+				return jsmn_stream_take_action(parser, chunk);
+			}
+			if (chunk->state == JSMN_STREAM_PARSING_STRING) {
+				chunk->segment = i + 1;
+			} else if (chunk->state == JSMN_STREAM_PARSING_PRIMITIVE) {
+				chunk->segment = i;
+			} else {
+				return 0;
+			}
+			parser->value_offset = chunk->position + chunk->segment;
+			return 0;
+
+		case JSMN_STREAM_SKIPPING:
+			/*
+			 * Only brackets and strings matter, nothing is buffered or
+			 * reported. A backslash escapes the next character like
+			 * in a string, as jsmn_stream_skip_blocks() sees it.
+			 */
+			if (parser->escape != JSMN_STREAM_ESCAPE_NONE) {
+				parser->escape = JSMN_STREAM_ESCAPE_NONE;
+				return 0;
+			}
+			switch (c) {
+				case '\"':
+					chunk->state = JSMN_STREAM_SKIPPING_STRING;
+					return 0;
+				case '\\':
+					parser->escape = JSMN_STREAM_ESCAPE_BACKSLASH;
+					return 0;
+				case '{': case '[':
+					parser->skip_depth++;
+					return 0;
+				case '}': case ']':
+					if (parser->skip_depth > 0) {
+						parser->skip_depth--;
+						return 0;
+					}
+					break;
+				default:
+					return 0;
+			}
+			/* The end of the skipped object or array is handled as usual */
+			chunk->state = JSMN_STREAM_PARSING;
+			parser->position = chunk->position + i + 1;
+			r = jsmn_stream_parse_structural(JSMN_STREAM_IMPL_ARG parser, c, &chunk->state);
+			if (r < 0) return r;
+			if (parser->action != JSMN_STREAM_CONTINUE) {
+				return jsmn_stream_take_action(parser, chunk);
+			}
+			return 0;
+
+		case JSMN_STREAM_SKIPPING_STRING:
+			/* Escape sequences are not checked, only their backslash matters */
+			if (parser->escape != JSMN_STREAM_ESCAPE_NONE) {
+				parser->escape = JSMN_STREAM_ESCAPE_NONE;
+			} else if (c == '\\') {
+				parser->escape = JSMN_STREAM_ESCAPE_BACKSLASH;
+			} else if (c == '\"') {
+				chunk->state = JSMN_STREAM_SKIPPING;
+			}
+			return 0;
+	}
+	return 0;
+}
+#undef JSMN_STREAM_IMPL_INLINE
+
+/**
+ * Skips 64 character blocks from *index while the parser is skipping with no
+ * escape pending, counting the brackets outside of strings in each block.
+ * Returns true with *index at the bracket that ends the skipped object or
+ * array, or false with the parser state updated up to *index when fewer
+ * than 64 characters are left.
+ */
+JSMN_STREAM_IMPL_STATIC bool jsmn_stream_skip_blocks(jsmn_stream_parser *parser,
+	jsmn_stream_chunk_t *chunk, size_t *index) {
+	uint64_t prev_escaped = 0;
+	uint64_t prev_in_string = chunk->state == JSMN_STREAM_SKIPPING_STRING ? ~(uint64_t)0 : 0;
+	size_t depth = parser->skip_depth;
+	size_t i = *index;
+	bool found = false;
+
+	for (; chunk->len - i >= 64; i += 64) {
+		jsmn_stream_skip_block_t block;
+		uint64_t escaped, quote, in_string, open, close;
+
+		jsmn_stream_classify_skipped(chunk->data + i, &block);
+		escaped = jsmn_stream_find_escaped(block.backslash, &prev_escaped);
+		quote = block.quote & ~escaped;
+		in_string = jsmn_stream_prefix_xor(quote) ^ prev_in_string;
+		prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+		open = block.open & ~in_string & ~escaped;
+		close = block.close & ~in_string & ~escaped;
+
+		if ((size_t)jsmn_stream_popcount64(close) <= depth) {
+			depth += (size_t)jsmn_stream_popcount64(open);
+			depth -= (size_t)jsmn_stream_popcount64(close);
+			continue;
+		}
+		/* The skipped object or array may end in this block */
+		for (open |= close; open != 0; open &= open - 1) {
+			uint64_t bit = open & -open;
+			if ((close & bit) == 0) {
+				depth++;
+			} else if (depth > 0) {
+				depth--;
+			} else {
+				i += (size_t)jsmn_stream_ctz64(bit);
+				found = true;
+				break;
+			}
+		}
+		if (found) {
+			/* The bracket is outside of a string and not escaped */
+			prev_escaped = 0;
+			prev_in_string = 0;
+			break;
+		}
+	}
+
+	parser->skip_depth = depth;
+	parser->escape = prev_escaped ? JSMN_STREAM_ESCAPE_BACKSLASH : JSMN_STREAM_ESCAPE_NONE;
+	chunk->state = prev_in_string ? JSMN_STREAM_SKIPPING_STRING : JSMN_STREAM_SKIPPING;
+	*index = i;
+	return found;
+}
+
+/**
+ * Handles the characters from *index while the parser is skipping, up to
+ * and including the bracket that ends the skipped object or array. On
+ * error *index is the offset of the offending character.
+ */
+JSMN_STREAM_IMPL_EMITTER int jsmn_stream_run_skipped(JSMN_STREAM_IMPL_PARAM
+	jsmn_stream_parser *parser, jsmn_stream_chunk_t *chunk, size_t *index) {
+	size_t i = *index;
+	int r = 0;
+
+	while (i < chunk->len && jsmn_stream_state_is_skipping(chunk->state)) {
+		if (parser->escape == JSMN_STREAM_ESCAPE_NONE) {
+			if (chunk->len - i >= 64) {
+				if (!jsmn_stream_skip_blocks(parser, chunk, &i)) {
+					continue;
+				}
+			} else {
+				i += chunk->state == JSMN_STREAM_SKIPPING ?
+					jsmn_stream_scan_skipped(chunk->data + i, chunk->len - i) :
+					jsmn_stream_scan_string(chunk->data + i, chunk->len - i);
+				if (i == chunk->len) {
+					break;
+				}
+			}
+		}
+		r = jsmn_stream_step(JSMN_STREAM_IMPL_ARG parser, chunk, i);
+		if (r < 0) {
+			break;
+		}
+		i++;
+	}
+	*index = i;
+	return r;
+}
+
+/**
+ * Handles the characters from *index to the end of the chunk. On error
+ * *index is the offset of the offending character.
+ */
+JSMN_STREAM_IMPL_EMITTER int jsmn_stream_run(JSMN_STREAM_IMPL_PARAM
+	jsmn_stream_parser *parser, jsmn_stream_chunk_t *chunk, size_t *index) {
+	size_t i;
+	int r;
+
+	for (i = *index; i < chunk->len; i++) {
+		if (jsmn_stream_state_is_skipping(chunk->state)) {
+			r = jsmn_stream_run_skipped(JSMN_STREAM_IMPL_ARG parser, chunk, &i);
+			if (r < 0) {
+				*index = i;
+				return r;
+			}
+			if (i == chunk->len) {
+				break;
+			}
+		}
+		/* Skip plain string content up to the next interesting character */
+		if (jsmn_stream_state_is_string(chunk->state) &&
+			parser->escape == JSMN_STREAM_ESCAPE_NONE) {
+			i += jsmn_stream_scan_string(chunk->data + i, chunk->len - i);
+			if (i == chunk->len) {
+				break;
+			}
+		}
+		r = jsmn_stream_step(JSMN_STREAM_IMPL_ARG parser, chunk, i);
+		if (r < 0) {
+			*index = i;
+			return r;
+		}
+	}
+	*index = chunk->len;
+	return 0;
+}
+
+/**
+ * Stores the parser state at the end of a chunk. r is the result of
+ * handling the chunk up to offset i, which is the whole chunk unless r is an
+ * error.
+ */
+JSMN_STREAM_IMPL_EMITTER int jsmn_stream_finish(JSMN_STREAM_IMPL_PARAM
+	jsmn_stream_parser *parser, jsmn_stream_chunk_t *chunk, size_t i, int r,
+	size_t *consumed) {
+	/* Keep the part of an unfinished value for the next chunk */
+	if (r == 0 && chunk->state == JSMN_STREAM_PARSING_STRING) {
+		r = jsmn_stream_buffer_append(JSMN_STREAM_IMPL_ARG parser,
+			jsmn_stream_stack_top(parser) == JSMN_STREAM_OBJECT ?
+			JSMN_STREAM_KEY : JSMN_STREAM_STRING,
+			chunk->data + chunk->segment, chunk->len - chunk->segment);
+	} else if (r == 0 && chunk->state == JSMN_STREAM_PARSING_PRIMITIVE) {
+		r = jsmn_stream_buffer_append(JSMN_STREAM_IMPL_ARG parser, JSMN_STREAM_PRIMITIVE,
+			chunk->data + chunk->segment, chunk->len - chunk->segment);
+	}
+
+	/* Report the first character that did not fit in the buffer */
+	if (r == JSMN_STREAM_ERROR_NOMEM) {
+		i = chunk->segment + (parser->buffer_capacity - 1 - parser->buffer_size);
+	}
+	/* A stop takes effect right after the event, which set the position */
+	if (r == JSMN_STREAM_STOPPED) {
+		i = parser->position - chunk->position;
+	}
+	parser->state = chunk->state;
+	parser->position = chunk->position + i;
+	if (consumed != NULL) {
+		*consumed = i;
+	}
+	return r;
+}
+
+/**
+ * Run JSON parser over a chunk of data. The parser state is kept in locals
+ * for the whole chunk, so this is much cheaper than feeding the characters
+ * one by one. Values are copied into the buffer only when the chunk ends in
+ * the middle of one.
+ */
+JSMN_STREAM_IMPL_EMITTER int jsmn_stream_impl_parse(JSMN_STREAM_IMPL_PARAM
+	jsmn_stream_parser *parser, const char *data, size_t len, size_t *consumed) {
+	jsmn_stream_chunk_t chunk;
+	size_t i = 0;
+	int r;
+
+	chunk.data = data;
+	chunk.len = len;
+	chunk.position = parser->position;
+	chunk.segment = 0;
+	chunk.state = parser->state;
+	r = jsmn_stream_run(JSMN_STREAM_IMPL_ARG parser, &chunk, &i);
+	return jsmn_stream_finish(JSMN_STREAM_IMPL_ARG parser, &chunk, i, r, consumed);
+}
+
+/**
+ * Run JSON parser over a chunk of data in two stages. Stage 1 classifies
+ * a block of 64 characters and works out which of them are inside strings,
+ * resolving escapes. Stage 2 hands only the characters that can change the
+ * parser state to jsmn_stream_step(): quotes, structural characters,
+ * backslashes and control characters in strings, and the first and last
+ * characters of primitives. Whitespace, plain string content and the inside
+ * of primitives are skipped.
+ *
+ * Each block starts where stage 2 left off and takes its in-string and
+ * in-primitive state from the parser. Escape sequences are finished before
+ * a block starts, also one left open by the previous chunk, so chunks may
+ * still be split at any point. A block that starts inside a string first
+ * skips plain content with jsmn_stream_scan_string().
+ *
+ * After each character stage 2 checks that the parser agrees with stage 1
+ * about being in a string or primitive. Input where they disagree, such as
+ * a quote inside a primitive, is finished by jsmn_stream_run(), so the
+ * result is always that of jsmn_stream_impl_parse().
+ */
+JSMN_STREAM_IMPL_EMITTER int jsmn_stream_impl_parse_indexed(JSMN_STREAM_IMPL_PARAM
+	jsmn_stream_parser *parser, const char *data, size_t len, size_t *consumed) {
+	jsmn_stream_chunk_t chunk;
+	size_t base;
+	size_t i = 0;
+	int r = 0;
+
+	chunk.data = data;
+	chunk.len = len;
+	chunk.position = parser->position;
+	chunk.segment = 0;
+	chunk.state = parser->state;
+
+	/* Finish an escape sequence left open by the previous chunk */
+	while (i < len && jsmn_stream_state_is_string(chunk.state) &&
+		parser->escape != JSMN_STREAM_ESCAPE_NONE) {
+		r = jsmn_stream_step(JSMN_STREAM_IMPL_ARG parser, &chunk, i);
+		if (r < 0) goto done;
+		i++;
+	}
+
+	while (i < len) {
+		jsmn_stream_block_t block;
+		/* Escape sequences are always finished before a new block */
+		uint64_t prev_escaped = 0;
+		uint64_t escaped, quote, in_string, primitive, follows_primitive, positions;
+
+		/* Skipped objects and arrays need less than a full index */
+		if (jsmn_stream_state_is_skipping(chunk.state)) {
+			r = jsmn_stream_run_skipped(JSMN_STREAM_IMPL_ARG parser, &chunk, &i);
+			if (r < 0) goto done;
+			if (i == len) {
+				break;
+			}
+		}
+
+		/* Plain string content is skipped faster than it is classified */
+		if (jsmn_stream_state_is_string(chunk.state)) {
+			i += jsmn_stream_scan_string(data + i, len - i);
+			if (i == len) {
+				break;
+			}
+		}
+		base = i;
+
+		/* Stage 1 */
+		if (len - base >= 64) {
+			jsmn_stream_classify_block(data + base, &block);
+		} else {
+			char tail[64];
+			memset(tail, ' ', sizeof(tail));
+			memcpy(tail, data + base, len - base);
+			jsmn_stream_classify_block(tail, &block);
+		}
+		escaped = jsmn_stream_find_escaped(block.backslash, &prev_escaped);
+		quote = block.quote & ~escaped;
+		in_string = jsmn_stream_prefix_xor(quote) ^
+			(jsmn_stream_state_is_string(chunk.state) ? ~(uint64_t)0 : 0);
+		primitive = ~in_string & ~(block.whitespace | block.structural | quote);
+		follows_primitive = primitive << 1 |
+			(chunk.state == JSMN_STREAM_PARSING_PRIMITIVE ? 1 : 0);
+		positions = quote |
+			(in_string & (block.backslash | block.control)) |
+			(~in_string & (block.structural | (block.control & ~block.whitespace) | block.high)) |
+			(primitive & ~follows_primitive) |
+			(~in_string & block.whitespace & follows_primitive);
+		if (parser->lines) {
+			/* Newlines, with tabs and carriage returns along */
+			positions |= ~in_string & block.whitespace & block.control;
+		}
+		if (len - base < 64) {
+			positions &= ((uint64_t)1 << (len - base)) - 1;
+		}
+
+		/* Stage 2 */
+		while (positions != 0) {
+			unsigned int bit = jsmn_stream_ctz64(positions);
+			size_t p = base + bit;
+			positions &= positions - 1;
+			if (p < i) {
+				/* Already handled as part of an escape sequence */
+				continue;
+			}
+			r = jsmn_stream_step(JSMN_STREAM_IMPL_ARG parser, &chunk, p);
+			if (r < 0) {
+				i = p;
+				goto done;
+			}
+			i = p + 1;
+			if (jsmn_stream_state_is_skipping(chunk.state)) {
+				/* The index of the rest of the block does not apply */
+				break;
+			}
+			if (jsmn_stream_state_is_string(chunk.state) &&
+				parser->escape != JSMN_STREAM_ESCAPE_NONE) {
+				/* Escape sequences are checked character by character */
+				while (i < len && parser->escape != JSMN_STREAM_ESCAPE_NONE) {
+					r = jsmn_stream_step(JSMN_STREAM_IMPL_ARG parser, &chunk, i);
+					if (r < 0) goto done;
+					i++;
+				}
+			} else if (jsmn_stream_state_is_string(chunk.state) != ((in_string >> bit) & 1) ||
+				(chunk.state == JSMN_STREAM_PARSING_PRIMITIVE) != ((primitive >> bit) & 1)) {
+				r = jsmn_stream_run(JSMN_STREAM_IMPL_ARG parser, &chunk, &i);
+				goto done;
+			}
+		}
+		/* The rest of the block does not change the parser state */
+		if (i < base + 64 && !jsmn_stream_state_is_skipping(chunk.state)) {
+			i = base + 64 < len ? base + 64 : len;
+		}
+	}
+
+done:
+	return jsmn_stream_finish(JSMN_STREAM_IMPL_ARG parser, &chunk, i, r, consumed);
+}
+
+/**
+ * Asks the parser to skip the rest of the innermost open object or array.
+ */
+JSMN_STREAM_IMPL_STATIC void jsmn_stream_impl_skip(jsmn_stream_parser *parser) {
+	jsmn_stream_impl_request(parser, JSMN_STREAM_SKIP_VALUE);
+}
+
+/**
+ * Asks the parser to stop after the current event.
+ */
+JSMN_STREAM_IMPL_STATIC void jsmn_stream_impl_stop(jsmn_stream_parser *parser) {
+	jsmn_stream_impl_request(parser, JSMN_STREAM_STOP);
+}
+
+/**
+ * Creates a new parser that keeps its buffer and type stack in caller
+ * provided storage. The callbacks table is referenced, not copied.
+ */
+JSMN_STREAM_IMPL_STATIC void jsmn_stream_impl_init(jsmn_stream_parser *parser,
+	const jsmn_stream_callbacks_t *callbacks, void *user_arg,
+	char *buffer, size_t buffer_capacity,
+	jsmn_stream_stack_t *type_stack, size_t stack_capacity) {
+	parser->state = JSMN_STREAM_PARSING;
+	parser->escape = JSMN_STREAM_ESCAPE_NONE;
+	parser->fragmented = false;
+	parser->action = JSMN_STREAM_CONTINUE;
+	parser->lines = false;
+	parser->escaped = false;
+	parser->unicode = 0;
+	parser->stack_height = 0;
+	parser->skip_depth = 0;
+	parser->buffer_size = 0;
+	parser->position = 0;
+	parser->value_offset = 0;
+	parser->document_start = 0;
+	parser->callbacks = callbacks;
+	parser->user_arg = user_arg;
+	parser->type_stack = type_stack;
+	parser->stack_capacity = stack_capacity;
+	parser->buffer = buffer;
+	parser->buffer_capacity = buffer_capacity;
+}
+
+/* First bytes of a snapshot, followed by JSMN_STREAM_SNAPSHOT_VERSION */
+#define JSMN_STREAM_SNAPSHOT_MAGIC "jss"
+#define JSMN_STREAM_SNAPSHOT_FRAGMENTED 1U
+#define JSMN_STREAM_SNAPSHOT_LINES 2U
+#define JSMN_STREAM_SNAPSHOT_ESCAPED 4U
+
+/**
+ * Writes value as 7 bit groups, least significant first, at offset at of a
+ * snapshot of size bytes. Bytes past the end are counted but not written.
+ * Returns the offset past the value.
+ */
+JSMN_STREAM_IMPL_STATIC size_t jsmn_stream_snapshot_put(unsigned char *data,
+	size_t size, size_t at, size_t value) {
+	do {
+		unsigned char byte = (unsigned char)(value & 0x7FU);
+		value >>= 7;
+		if (value != 0) {
+			byte |= 0x80U;
+		}
+		if (at < size) {
+			data[at] = byte;
+		}
+		at++;
+	} while (value != 0);
+	return at;
+}
+
+/**
+ * Reads a value written by jsmn_stream_snapshot_put(). Returns false when
+ * the snapshot ends or the value does not fit a size_t.
+ */
+JSMN_STREAM_IMPL_STATIC bool jsmn_stream_snapshot_get(const unsigned char *data,
+	size_t size, size_t *at, size_t *value) {
+	unsigned shift = 0;
+
+	*value = 0;
+	while (*at < size && shift < sizeof(size_t) * 8) {
+		unsigned char byte = data[(*at)++];
+		if (shift > 0 && (size_t)(byte & 0x7FU) > (SIZE_MAX >> shift)) {
+			return false;
+		}
+		*value |= (size_t)(byte & 0x7FU) << shift;
+		if ((byte & 0x80U) == 0) {
+			return true;
+		}
+		shift += 7;
+	}
+	return false;
+}
+
+/**
+ * Returns the code of the type stack level at *level and moves past it.
+ * Snapshots store the levels with the codes of the packed stack, where an
+ * object with an open key takes a single level, so they restore into
+ * either kind of stack.
+ */
+JSMN_STREAM_IMPL_STATIC unsigned jsmn_stream_snapshot_level(const jsmn_stream_parser *parser,
+	size_t *level) {
+#if JSMN_STREAM_PACKED_STACK
+	size_t i = (*level)++;
+	return (unsigned)((parser->type_stack[JSMN_STREAM_PACKED_WORD(i)] >>
+		JSMN_STREAM_PACKED_SHIFT(i)) & 3U);
+#else
+	if (parser->type_stack[(*level)++] == JSMN_STREAM_ARRAY) {
+		return 2U;
+	}
+	if (*level < parser->stack_height && parser->type_stack[*level] == JSMN_STREAM_KEY) {
+		(*level)++;
+		return 3U;
+	}
+	return 1U;
+#endif
+}
+
+/**
+ * Serializes the parser state into data, see jsmn_stream_snapshot().
+ */
+JSMN_STREAM_IMPL_STATIC int jsmn_stream_impl_snapshot(const jsmn_stream_parser *parser,
+	void *data, size_t size, size_t *written) {
+	unsigned char *out = (unsigned char *)data;
+	size_t levels = 0;
+	size_t at = 0;
+	size_t level;
+	unsigned char flags = (unsigned char)((parser->fragmented ? JSMN_STREAM_SNAPSHOT_FRAGMENTED : 0U) |
+		(parser->lines ? JSMN_STREAM_SNAPSHOT_LINES : 0U) |
+		(parser->escaped ? JSMN_STREAM_SNAPSHOT_ESCAPED : 0U));
+	const unsigned char header[7] = {
+		JSMN_STREAM_SNAPSHOT_MAGIC[0], JSMN_STREAM_SNAPSHOT_MAGIC[1], JSMN_STREAM_SNAPSHOT_MAGIC[2],
+		JSMN_STREAM_SNAPSHOT_VERSION, (unsigned char)parser->state, parser->escape, flags
+	};
+
+	for (level = 0; level < parser->stack_height; levels++) {
+		jsmn_stream_snapshot_level(parser, &level);
+	}
+
+	for (at = 0; at < sizeof(header); at++) {
+		if (at < size) {
+			out[at] = header[at];
+		}
+	}
+	at = jsmn_stream_snapshot_put(out, size, at, parser->position);
+	at = jsmn_stream_snapshot_put(out, size, at, parser->value_offset);
+	at = jsmn_stream_snapshot_put(out, size, at, parser->document_start);
+	at = jsmn_stream_snapshot_put(out, size, at, parser->skip_depth);
+	at = jsmn_stream_snapshot_put(out, size, at, parser->unicode);
+	at = jsmn_stream_snapshot_put(out, size, at, levels);
+	at = jsmn_stream_snapshot_put(out, size, at, parser->buffer_size);
+
+	/* Four levels to a byte, the first in the low bits */
+	for (level = 0; level < parser->stack_height; at++) {
+		unsigned char byte = 0;
+		unsigned shift;
+		for (shift = 0; shift < 8 && level < parser->stack_height; shift += 2) {
+			byte |= (unsigned char)(jsmn_stream_snapshot_level(parser, &level) << shift);
+		}
+		if (at < size) {
+			out[at] = byte;
+		}
+	}
+
+	if (at + parser->buffer_size <= size) {
+		memcpy(out + at, parser->buffer, parser->buffer_size);
+	}
+	at += parser->buffer_size;
+
+	if (written != NULL) {
+		*written = at;
+	}
+	return at <= size ? 0 : JSMN_STREAM_ERROR_NOMEM;
+}
+
+/**
+ * Restores a state serialized by jsmn_stream_impl_snapshot(), see
+ * jsmn_stream_restore().
+ */
+JSMN_STREAM_IMPL_STATIC int jsmn_stream_impl_restore(jsmn_stream_parser *parser,
+	const void *data, size_t size) {
+	const unsigned char *in = (const unsigned char *)data;
+	size_t position, value_offset, document_start, skip_depth, unicode, levels, buffer_size;
+	size_t height = 0;
+	size_t at = 7;
+	size_t level;
+
+	if (size < at || memcmp(in, JSMN_STREAM_SNAPSHOT_MAGIC, 3) != 0 ||
+		in[3] != JSMN_STREAM_SNAPSHOT_VERSION ||
+		in[4] > JSMN_STREAM_SKIPPING_STRING ||
+		in[5] > JSMN_STREAM_ESCAPE_SURROGATE_BACKSLASH ||
+		(in[6] & ~(JSMN_STREAM_SNAPSHOT_FRAGMENTED | JSMN_STREAM_SNAPSHOT_LINES |
+			JSMN_STREAM_SNAPSHOT_ESCAPED)) != 0) {
+		return JSMN_STREAM_ERROR_INVAL;
+	}
+	if (!jsmn_stream_snapshot_get(in, size, &at, &position) ||
+		!jsmn_stream_snapshot_get(in, size, &at, &value_offset) ||
+		!jsmn_stream_snapshot_get(in, size, &at, &document_start) ||
+		!jsmn_stream_snapshot_get(in, size, &at, &skip_depth) ||
+		!jsmn_stream_snapshot_get(in, size, &at, &unicode) || unicode > UINT32_MAX ||
+		!jsmn_stream_snapshot_get(in, size, &at, &levels) ||
+		!jsmn_stream_snapshot_get(in, size, &at, &buffer_size) ||
+		value_offset > position || document_start > position ||
+		levels > (size - at) * 4 || buffer_size != size - at - (levels + 3) / 4) {
+		return JSMN_STREAM_ERROR_INVAL;
+	}
+
+	/* Check the levels before anything is changed */
+	for (level = 0; level < levels; level++) {
+		unsigned code = (in[at + level / 4] >> (level % 4 * 2)) & 3U;
+		if (code == 0) {
+			return JSMN_STREAM_ERROR_INVAL;
+		}
+#if JSMN_STREAM_PACKED_STACK
+		height++;
+#else
+		height += code == 3U ? 2 : 1;
+#endif
+	}
+	if (height > parser->stack_capacity) {
+		return JSMN_STREAM_ERROR_MAX_DEPTH;
+	}
+	/* The buffer keeps room for a terminating null character */
+	if (buffer_size >= parser->buffer_capacity) {
+		return JSMN_STREAM_ERROR_NOMEM;
+	}
+
+	parser->stack_height = 0;
+	for (level = 0; level < levels; level++) {
+		unsigned code = (in[at + level / 4] >> (level % 4 * 2)) & 3U;
+		jsmn_stream_stack_push(parser, code == 2U ? JSMN_STREAM_ARRAY : JSMN_STREAM_OBJECT);
+		if (code == 3U) {
+			jsmn_stream_stack_push(parser, JSMN_STREAM_KEY);
+		}
+	}
+	at += (levels + 3) / 4;
+	memcpy(parser->buffer, in + at, buffer_size);
+
+	parser->state = (jsmn_streamstate_t)in[4];
+	parser->escape = in[5];
+	parser->fragmented = (in[6] & JSMN_STREAM_SNAPSHOT_FRAGMENTED) != 0;
+	parser->lines = (in[6] & JSMN_STREAM_SNAPSHOT_LINES) != 0;
+	parser->escaped = (in[6] & JSMN_STREAM_SNAPSHOT_ESCAPED) != 0;
+	parser->unicode = (uint32_t)unicode;
+	parser->action = JSMN_STREAM_CONTINUE;
+	parser->skip_depth = skip_depth;
+	parser->buffer_size = buffer_size;
+	parser->position = position;
+	parser->value_offset = value_offset;
+	parser->document_start = document_start;
+	return 0;
+}
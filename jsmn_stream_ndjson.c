@@ -0,0 +1,866 @@
+#include "jsmn_stream_ndjson.h"
+#include <string.h>
+
+#if JSMN_STREAM_NDJSON_THREADS
+#include "jsmn_stream_simd.h"
+#include <pthread.h>
+#include <stdlib.h>
+#endif
+
+/**
+ * @brief Start a new record at a stream offset.
+ *
+ * @param ndjson
+ * @param position stream offset of the next character.
+ */
+static void jsmn_stream_ndjson_reset(jsmn_stream_ndjson_t *ndjson, size_t position)
+{
+#if JSMN_STREAM_DEFAULT_STORAGE
+	jsmn_stream_init(&ndjson->stream_parser, ndjson->callbacks, ndjson->user_arg);
+#else
+	jsmn_stream_init_with_storage(&ndjson->stream_parser, ndjson->callbacks, ndjson->user_arg,
+		ndjson->stream_buffer, JSMN_STREAM_BUFFER_SIZE,
+		ndjson->stream_type_stack, JSMN_STREAM_MAX_DEPTH);
+#endif
+	ndjson->stream_parser.lines = true;
+	ndjson->stream_parser.position = position;
+}
+
+/**
+ * @brief Initialize a JSON Lines parser.
+ * 	The callbacks get the events of every record, and the document end
+ * 	callback (or JSMN_STREAM_EVENT_DOCUMENT_END) after each one. A record
+ * 	may hold several documents one after the other, but a document cannot
+ * 	span lines. A record whose objects or arrays are skipped with
+ * 	jsmn_stream_skip() is only checked for brackets and strings, so a line
+ * 	that ends inside a skipped part is not detected until its brackets
+ * 	balance.
+ *
+ * @param ndjson
+ * @param callbacks
+ * @param user_arg passed to the callbacks and the error callback.
+ * @param error_callback receives the malformed records. May be NULL.
+ */
+void jsmn_stream_ndjson_init(jsmn_stream_ndjson_t *ndjson, const jsmn_stream_callbacks_t *callbacks, void *user_arg, jsmn_stream_ndjson_error_callback_t error_callback)
+{
+	ndjson->callbacks = callbacks;
+	ndjson->user_arg = user_arg;
+	ndjson->error_callback = error_callback;
+	ndjson->resyncing = false;
+	ndjson->errors = 0;
+	jsmn_stream_ndjson_reset(ndjson, 0);
+}
+
+/**
+ * @brief Parse a chunk of characters. Chunks may be split at any point.
+ * 	A malformed record, including one that is too deep or has a value that
+ * 	does not fit in the parser buffer, is reported to the error callback and
+ * 	the rest of its line is dropped.
+ *
+ * @param ndjson
+ * @param data
+ * @param length
+ * @param consumed receives the number of characters consumed. May be NULL.
+ * @return int 0, or JSMN_STREAM_STOPPED when a callback stopped the parse.
+ */
+int jsmn_stream_ndjson_parse(jsmn_stream_ndjson_t *ndjson, const char *data, size_t length, size_t *consumed)
+{
+	jsmn_stream_parser *parser = &ndjson->stream_parser;
+	size_t i = 0;
+	int r = 0;
+
+	while (i < length)
+	{
+		size_t start = parser->position;
+		size_t used = 0;
+
+		if (ndjson->resyncing)
+		{
+			const char *newline = memchr(data + i, '\n', length - i);
+
+			used = newline != NULL ? (size_t)(newline - (data + i)) + 1 : length - i;
+			ndjson->resyncing = newline == NULL;
+			parser->position += used;
+			i += used;
+			continue;
+		}
+
+		r = jsmn_stream_parse_buffer(parser, data + i, length - i, &used);
+		i += used;
+		if (r == 0 || r == JSMN_STREAM_STOPPED)
+		{
+			break;
+		}
+
+		// drop the record up to the end of its line, the offending
+		// character may be that newline
+		ndjson->errors++;
+		if (ndjson->error_callback != NULL)
+		{
+			ndjson->error_callback(start + used, r, ndjson->user_arg);
+		}
+		jsmn_stream_ndjson_reset(ndjson, start + used);
+		ndjson->resyncing = true;
+		r = 0;
+	}
+
+	if (consumed != NULL)
+	{
+		*consumed = i;
+	}
+	return r;
+}
+
+/**
+ * @brief End the input. Delivers a last record that is not followed by a
+ * 	newline, or reports it as malformed when it is unfinished.
+ *
+ * @param ndjson
+ * @return int 0, or JSMN_STREAM_STOPPED when a callback stopped the parse.
+ */
+int jsmn_stream_ndjson_finish(jsmn_stream_ndjson_t *ndjson)
+{
+	return jsmn_stream_ndjson_parse(ndjson, "\n", 1, NULL);
+}
+
+#if JSMN_STREAM_NDJSON_THREADS
+
+#define JSMN_STREAM_NDJSON_ERROR_ENTRY -1
+#define JSMN_STREAM_NDJSON_NO_ELEMENT SIZE_MAX
+
+/**
+ * @brief Event or malformed record recorded by a worker for ordered delivery.
+ *
+ */
+typedef struct {
+	size_t offset;
+	size_t length;
+	int event; // jsmn_stream_event_t, or JSMN_STREAM_NDJSON_ERROR_ENTRY
+	int error;
+} jsmn_stream_ndjson_entry_t;
+
+/**
+ * @brief Whole lines, or whole array elements, parsed by one worker.
+ *
+ */
+typedef struct {
+	size_t start;
+	size_t end;
+	jsmn_stream_ndjson_entry_t *entries;
+	size_t count;
+	size_t capacity;
+	bool done;
+	bool nomem;
+	int result;
+} jsmn_stream_ndjson_slice_t;
+
+typedef struct {
+	const char *data;
+	const jsmn_stream_ndjson_parallel_t *config;
+	jsmn_stream_ndjson_slice_t *slices;
+	size_t slice_count;
+	bool array; // the slices hold array elements instead of lines
+	size_t next; // first slice not taken by a worker
+	size_t delivered; // slices delivered in order
+	size_t window; // slices taken but not delivered, at most
+	bool stopping;
+	int result;
+	size_t failed; // first slice that failed
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+} jsmn_stream_ndjson_pool_t;
+
+typedef struct {
+	jsmn_stream_ndjson_pool_t *pool;
+	void *user_arg;
+	pthread_t thread;
+	jsmn_stream_ndjson_t ndjson;
+} jsmn_stream_ndjson_worker_t;
+
+/**
+ * @brief Objects and arrays open in the records being delivered in order.
+ *
+ */
+typedef struct {
+	size_t depth;
+	size_t skip_depth;
+	bool skipping;
+} jsmn_stream_ndjson_replay_t;
+
+/**
+ * @brief Part of a top level array summarized by the pre-pass, as if it
+ * 	started outside of a string and as if it started inside of one.
+ *
+ */
+typedef struct {
+	size_t start;
+	size_t end;
+	bool odd_quotes; // the part flips between inside and outside of a string
+	long depth_outside; // objects and arrays opened minus closed, starting outside
+	long depth_inside; // the same starting inside a string
+} jsmn_stream_ndjson_chunk_t;
+
+typedef struct {
+	const char *data;
+	jsmn_stream_ndjson_chunk_t *chunks;
+	size_t first;
+	size_t last;
+	pthread_t thread;
+} jsmn_stream_ndjson_summary_t;
+
+static bool jsmn_stream_ndjson_record(jsmn_stream_ndjson_slice_t *slice, int event, size_t offset, size_t length, int error)
+{
+	if (slice->count == slice->capacity)
+	{
+		size_t capacity = slice->capacity != 0 ? slice->capacity * 2 : 64;
+		jsmn_stream_ndjson_entry_t *entries = realloc(slice->entries, capacity * sizeof(*entries));
+
+		if (entries == NULL)
+		{
+			slice->nomem = true;
+			return false;
+		}
+		slice->entries = entries;
+		slice->capacity = capacity;
+	}
+	slice->entries[slice->count].offset = offset;
+	slice->entries[slice->count].length = length;
+	slice->entries[slice->count].event = event;
+	slice->entries[slice->count].error = error;
+	slice->count++;
+	return true;
+}
+
+static jsmn_stream_action_t jsmn_stream_ndjson_record_event(jsmn_stream_event_t event, const char *value, size_t length, size_t offset, void *user_arg)
+{
+	// values are spans into the input, which outlives the delivery
+	(void)value;
+	return jsmn_stream_ndjson_record(user_arg, event, offset, length, 0) ?
+		JSMN_STREAM_CONTINUE : JSMN_STREAM_STOP;
+}
+
+static void jsmn_stream_ndjson_record_error(size_t offset, int error, void *user_arg)
+{
+	jsmn_stream_ndjson_record(user_arg, JSMN_STREAM_NDJSON_ERROR_ENTRY, offset, 0, error);
+}
+
+static const jsmn_stream_callbacks_t jsmn_stream_ndjson_record_callbacks = {
+	.event_callback = jsmn_stream_ndjson_record_event
+};
+
+/**
+ * @brief Parse the array elements of a slice as documents one after the
+ * 	other. Unlike a malformed record, a malformed element fails the parse.
+ *
+ * @param worker
+ * @param slice
+ * @return int 0, JSMN_STREAM_STOPPED, or the error of the element.
+ */
+static int jsmn_stream_ndjson_parse_elements(jsmn_stream_ndjson_worker_t *worker, jsmn_stream_ndjson_slice_t *slice)
+{
+	jsmn_stream_ndjson_t *ndjson = &worker->ndjson;
+	jsmn_stream_parser *parser = &ndjson->stream_parser;
+	size_t used = 0;
+	int r;
+
+	parser->lines = false;
+	r = jsmn_stream_parse_buffer(parser, worker->pool->data + slice->start, slice->end - slice->start, &used);
+	if (r == 0)
+	{
+		// the comma or bracket after the slice ends a last primitive
+		r = jsmn_stream_parse_buffer(parser, ",", 1, NULL);
+		if (r == 0 && (parser->state != JSMN_STREAM_PARSING || parser->stack_height != 0))
+		{
+			r = JSMN_STREAM_ERROR_INVAL;
+		}
+	}
+	if (r != 0 && r != JSMN_STREAM_STOPPED && ndjson->error_callback != NULL)
+	{
+		ndjson->error_callback(slice->start + used, r, ndjson->user_arg);
+	}
+	return r;
+}
+
+/**
+ * @brief Take slices and parse them until there are none left.
+ *
+ * @param arg the jsmn_stream_ndjson_worker_t.
+ * @return void* NULL.
+ */
+static void *jsmn_stream_ndjson_work(void *arg)
+{
+	jsmn_stream_ndjson_worker_t *worker = arg;
+	jsmn_stream_ndjson_pool_t *pool = worker->pool;
+	const jsmn_stream_ndjson_parallel_t *config = pool->config;
+
+	pthread_mutex_lock(&pool->mutex);
+	for (;;)
+	{
+		jsmn_stream_ndjson_slice_t *slice;
+		int r;
+
+		while (!pool->stopping && pool->next < pool->slice_count &&
+			config->ordered && pool->next >= pool->delivered + pool->window)
+		{
+			pthread_cond_wait(&pool->cond, &pool->mutex);
+		}
+		if (pool->stopping || pool->next == pool->slice_count)
+		{
+			break;
+		}
+		slice = &pool->slices[pool->next++];
+		pthread_mutex_unlock(&pool->mutex);
+
+		if (config->ordered)
+		{
+			jsmn_stream_ndjson_init(&worker->ndjson, &jsmn_stream_ndjson_record_callbacks, slice, jsmn_stream_ndjson_record_error);
+		}
+		else
+		{
+			jsmn_stream_ndjson_init(&worker->ndjson, config->callbacks, worker->user_arg, config->error_callback);
+		}
+		worker->ndjson.stream_parser.position = slice->start;
+		if (pool->array)
+		{
+			r = jsmn_stream_ndjson_parse_elements(worker, slice);
+		}
+		else
+		{
+			r = jsmn_stream_ndjson_parse(&worker->ndjson, pool->data + slice->start, slice->end - slice->start, NULL);
+			if (r == 0)
+			{
+				r = jsmn_stream_ndjson_finish(&worker->ndjson);
+			}
+		}
+		if (slice->nomem)
+		{
+			r = JSMN_STREAM_ERROR_NOMEM;
+		}
+
+		pthread_mutex_lock(&pool->mutex);
+		slice->done = true;
+		slice->result = r;
+		if (r != 0)
+		{
+			// later slices are not delivered, earlier ones still are
+			pool->stopping = true;
+			if (pool->result == 0 || (size_t)(slice - pool->slices) < pool->failed)
+			{
+				pool->result = r;
+				pool->failed = (size_t)(slice - pool->slices);
+			}
+		}
+		pthread_cond_broadcast(&pool->cond);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+/**
+ * @brief Deliver the recorded events of a slice to the event callback.
+ * 	Skipping works like in the parser: the events up to the end of the
+ * 	skipped object or array are left out.
+ *
+ * @param pool
+ * @param slice
+ * @param replay carried over from the previous slice.
+ * @return int 0, or JSMN_STREAM_STOPPED.
+ */
+static int jsmn_stream_ndjson_replay(jsmn_stream_ndjson_pool_t *pool, const jsmn_stream_ndjson_slice_t *slice, jsmn_stream_ndjson_replay_t *replay)
+{
+	const jsmn_stream_ndjson_parallel_t *config = pool->config;
+
+	for (size_t e = 0; e < slice->count; e++)
+	{
+		const jsmn_stream_ndjson_entry_t *entry = &slice->entries[e];
+		bool start = entry->event == JSMN_STREAM_EVENT_START_OBJECT || entry->event == JSMN_STREAM_EVENT_START_ARRAY;
+		bool end = entry->event == JSMN_STREAM_EVENT_END_OBJECT || entry->event == JSMN_STREAM_EVENT_END_ARRAY;
+		bool value = entry->event == JSMN_STREAM_EVENT_KEY || entry->event == JSMN_STREAM_EVENT_STRING ||
+			entry->event == JSMN_STREAM_EVENT_PRIMITIVE;
+		jsmn_stream_action_t action;
+
+		if (entry->event == JSMN_STREAM_NDJSON_ERROR_ENTRY)
+		{
+			// the objects and arrays of the malformed record are never closed
+			replay->depth = 0;
+			replay->skipping = false;
+			if (config->error_callback != NULL)
+			{
+				config->error_callback(entry->offset, entry->error, config->user_arg);
+			}
+			continue;
+		}
+		if (replay->skipping)
+		{
+			if (start)
+			{
+				replay->skip_depth++;
+				continue;
+			}
+			if (!end)
+			{
+				continue;
+			}
+			if (replay->skip_depth > 0)
+			{
+				replay->skip_depth--;
+				continue;
+			}
+			replay->skipping = false;
+		}
+
+		replay->depth += start ? 1 : 0;
+		replay->depth -= end ? 1 : 0;
+		action = config->callbacks->event_callback((jsmn_stream_event_t)entry->event,
+			value ? pool->data + entry->offset : NULL, entry->length, entry->offset, config->user_arg);
+		if (action == JSMN_STREAM_STOP)
+		{
+			return JSMN_STREAM_STOPPED;
+		}
+		if (action == JSMN_STREAM_SKIP_VALUE && replay->depth > 0)
+		{
+			replay->skipping = true;
+			replay->skip_depth = 0;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Deliver the slices in input order as the workers finish them, up
+ * 	to the first one that failed.
+ *
+ * @param pool
+ */
+static void jsmn_stream_ndjson_deliver(jsmn_stream_ndjson_pool_t *pool)
+{
+	jsmn_stream_ndjson_replay_t replay = { 0 };
+
+	for (size_t k = 0; k < pool->slice_count; k++)
+	{
+		jsmn_stream_ndjson_slice_t *slice = &pool->slices[k];
+		int r;
+
+		// a slice taken by a worker is finished even when stopping
+		pthread_mutex_lock(&pool->mutex);
+		while (!slice->done && !(pool->stopping && k >= pool->next))
+		{
+			pthread_cond_wait(&pool->cond, &pool->mutex);
+		}
+		pthread_mutex_unlock(&pool->mutex);
+		if (!slice->done || slice->result == JSMN_STREAM_ERROR_NOMEM)
+		{
+			return;
+		}
+
+		r = jsmn_stream_ndjson_replay(pool, slice, &replay);
+		free(slice->entries);
+		slice->entries = NULL;
+
+		pthread_mutex_lock(&pool->mutex);
+		pool->delivered++;
+		if (r != 0)
+		{
+			pool->stopping = true;
+			pool->result = r;
+		}
+		pthread_cond_broadcast(&pool->cond);
+		pthread_mutex_unlock(&pool->mutex);
+		if (r != 0 || slice->result != 0)
+		{
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Parse the slices of a pool on config->threads workers.
+ *
+ * @param pool with the slices set up.
+ * @return int the result of the parse.
+ */
+static int jsmn_stream_ndjson_run(jsmn_stream_ndjson_pool_t *pool)
+{
+	const jsmn_stream_ndjson_parallel_t *config = pool->config;
+	jsmn_stream_ndjson_worker_t *workers = calloc(config->threads, sizeof(*workers));
+	size_t started = 0;
+
+	if (workers == NULL)
+	{
+		return JSMN_STREAM_ERROR_NOMEM;
+	}
+	pool->window = config->threads * 2;
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+	for (; started < config->threads; started++)
+	{
+		workers[started].pool = pool;
+		workers[started].user_arg = config->worker_args != NULL ? config->worker_args[started] : config->user_arg;
+		if (pthread_create(&workers[started].thread, NULL, jsmn_stream_ndjson_work, &workers[started]) != 0)
+		{
+			pthread_mutex_lock(&pool->mutex);
+			pool->stopping = true;
+			pool->result = JSMN_STREAM_ERROR_NOMEM;
+			pthread_cond_broadcast(&pool->cond);
+			pthread_mutex_unlock(&pool->mutex);
+			break;
+		}
+	}
+
+	if (config->ordered && started == config->threads)
+	{
+		jsmn_stream_ndjson_deliver(pool);
+	}
+	for (size_t t = 0; t < started; t++)
+	{
+		pthread_join(workers[t].thread, NULL);
+	}
+
+	pthread_cond_destroy(&pool->cond);
+	pthread_mutex_destroy(&pool->mutex);
+	for (size_t k = 0; k < pool->slice_count; k++)
+	{
+		free(pool->slices[k].entries);
+	}
+	free(workers);
+	return pool->result;
+}
+
+/**
+ * @brief Check a configuration and allocate the slices of a pool.
+ *
+ * @param pool
+ * @param config
+ * @param max_slices
+ * @return int 0, JSMN_STREAM_ERROR_INVAL or JSMN_STREAM_ERROR_NOMEM.
+ */
+static int jsmn_stream_ndjson_pool_init(jsmn_stream_ndjson_pool_t *pool, const char *data, const jsmn_stream_ndjson_parallel_t *config, size_t max_slices)
+{
+	memset(pool, 0, sizeof(*pool));
+	if (config->threads == 0 || (config->ordered && config->callbacks->event_callback == NULL))
+	{
+		return JSMN_STREAM_ERROR_INVAL;
+	}
+	pool->data = data;
+	pool->config = config;
+	pool->slices = calloc(max_slices, sizeof(*pool->slices));
+	return pool->slices != NULL ? 0 : JSMN_STREAM_ERROR_NOMEM;
+}
+
+/**
+ * @brief Parse JSON Lines in memory on a pool of threads.
+ * 	The input is split at newlines into slices of about slice_size
+ * 	characters and each worker parses the slices it takes with a parser of
+ * 	its own, like jsmn_stream_ndjson_parse() followed by
+ * 	jsmn_stream_ndjson_finish() on every slice.
+ *
+ * 	Not ordered, the workers call the callbacks and the error callback
+ * 	themselves, concurrently and in no particular order between slices,
+ * 	with their entry of worker_args as user_arg. Stopping a worker stops
+ * 	the others after their current slice.
+ *
+ * 	Ordered, the workers record the events, and the calling thread delivers
+ * 	them to the event callback in input order with user_arg, with values
+ * 	pointing into data. The other callbacks are not used. At most two
+ * 	slices per thread are recorded ahead of the delivery.
+ *
+ * @param data
+ * @param length
+ * @param config
+ * @return int 0, JSMN_STREAM_STOPPED when a callback stopped the parse,
+ * 	JSMN_STREAM_ERROR_INVAL for an invalid configuration, or
+ * 	JSMN_STREAM_ERROR_NOMEM when memory or a thread could not be had.
+ */
+int jsmn_stream_ndjson_parse_parallel(const char *data, size_t length, const jsmn_stream_ndjson_parallel_t *config)
+{
+	size_t slice_size = config->slice_size != 0 ? config->slice_size : JSMN_STREAM_NDJSON_SLICE_SIZE;
+	jsmn_stream_ndjson_pool_t pool;
+	int r = jsmn_stream_ndjson_pool_init(&pool, data, config, length / slice_size + 1);
+
+	if (r != 0)
+	{
+		return r;
+	}
+
+	// every slice but the last ends with a newline
+	for (size_t start = 0; start < length; pool.slice_count++)
+	{
+		size_t end = length - start > slice_size ? start + slice_size : length;
+		const char *newline = memchr(data + end - 1, '\n', length - end + 1);
+
+		end = newline != NULL ? (size_t)(newline - data) + 1 : length;
+		pool.slices[pool.slice_count].start = start;
+		pool.slices[pool.slice_count].end = end;
+		start = end;
+	}
+
+	r = jsmn_stream_ndjson_run(&pool);
+	free(pool.slices);
+	return r;
+}
+
+/**
+ * @brief Load the next 64 characters of a part, padded with spaces.
+ *
+ * @param data
+ * @param base
+ * @param end
+ * @param tail room for a padded copy.
+ * @return const char* the 64 characters.
+ */
+static const char *jsmn_stream_ndjson_block(const char *data, size_t base, size_t end, char *tail)
+{
+	if (end - base >= 64)
+	{
+		return data + base;
+	}
+	memset(tail, ' ', 64);
+	memcpy(tail, data + base, end - base);
+	return tail;
+}
+
+/**
+ * @brief Pre-pass over some parts of an array. Counts the brackets both
+ * 	ways, so the parts need not be scanned in order.
+ *
+ * @param arg the jsmn_stream_ndjson_summary_t.
+ * @return void* NULL.
+ */
+static void *jsmn_stream_ndjson_summarize(void *arg)
+{
+	jsmn_stream_ndjson_summary_t *summary = arg;
+
+	for (size_t c = summary->first; c < summary->last; c++)
+	{
+		jsmn_stream_ndjson_chunk_t *chunk = &summary->chunks[c];
+		// parts start after a character other than a backslash
+		uint64_t prev_escaped = 0;
+		uint64_t odd = 0;
+		long opened_outside = 0, closed_outside = 0, opened_inside = 0, closed_inside = 0;
+
+		for (size_t base = chunk->start; base < chunk->end; base += 64)
+		{
+			char tail[64];
+			jsmn_stream_skip_block_t block;
+			uint64_t quote, in_string, valid = ~(uint64_t)0;
+
+			jsmn_stream_classify_skipped(jsmn_stream_ndjson_block(summary->data, base, chunk->end, tail), &block);
+			quote = block.quote & ~jsmn_stream_find_escaped(block.backslash, &prev_escaped);
+			in_string = jsmn_stream_prefix_xor(quote) ^ odd;
+			odd = (uint64_t)0 - (in_string >> 63);
+			if (chunk->end - base < 64)
+			{
+				valid = ((uint64_t)1 << (chunk->end - base)) - 1;
+			}
+			opened_outside += jsmn_stream_popcount64(block.open & ~in_string & valid);
+			closed_outside += jsmn_stream_popcount64(block.close & ~in_string & valid);
+			opened_inside += jsmn_stream_popcount64(block.open & in_string);
+			closed_inside += jsmn_stream_popcount64(block.close & in_string);
+		}
+		chunk->odd_quotes = odd != 0;
+		chunk->depth_outside = opened_outside - closed_outside;
+		chunk->depth_inside = opened_inside - closed_inside;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Find the first comma between two elements of the array in a part.
+ *
+ * @param data
+ * @param start of the part.
+ * @param end of the part.
+ * @param in_string whether the part starts inside a string.
+ * @param depth number of objects and arrays open at the start, the array
+ * 	itself included.
+ * @return size_t offset of the comma, or JSMN_STREAM_NDJSON_NO_ELEMENT.
+ */
+static size_t jsmn_stream_ndjson_find_element(const char *data, size_t start, size_t end, bool in_string, long depth)
+{
+	uint64_t prev_escaped = 0;
+	uint64_t odd = in_string ? ~(uint64_t)0 : 0;
+
+	for (size_t base = start; base < end; base += 64)
+	{
+		char tail[64];
+		jsmn_stream_block_t block;
+		uint64_t quote, inside, structural;
+
+		jsmn_stream_classify_block(jsmn_stream_ndjson_block(data, base, end, tail), &block);
+		quote = block.quote & ~jsmn_stream_find_escaped(block.backslash, &prev_escaped);
+		inside = jsmn_stream_prefix_xor(quote) ^ odd;
+		odd = (uint64_t)0 - (inside >> 63);
+		structural = block.structural & ~inside;
+		if (end - base < 64)
+		{
+			structural &= ((uint64_t)1 << (end - base)) - 1;
+		}
+
+		while (structural != 0)
+		{
+			size_t i = base + (size_t)jsmn_stream_ctz64(structural);
+
+			structural &= structural - 1;
+			switch (data[i])
+			{
+				case '{': case '[':
+					depth++;
+					break;
+				case '}': case ']':
+					if (--depth <= 0)
+					{
+						return JSMN_STREAM_NDJSON_NO_ELEMENT;
+					}
+					break;
+				case ',':
+					if (depth == 1)
+					{
+						return i;
+					}
+					break;
+			}
+		}
+	}
+	return JSMN_STREAM_NDJSON_NO_ELEMENT;
+}
+
+/**
+ * @brief Parse the elements of one top level array in memory on a pool of
+ * 	threads, like the records of jsmn_stream_ndjson_parse_parallel().
+ * 	The input is cut into parts of about slice_size characters. A pre-pass
+ * 	on the workers finds the strings and brackets of each part, then the
+ * 	first comma between two elements in each part starts a new slice. Each
+ * 	slice of whole elements is parsed by a worker with a parser of its own.
+ *
+ * 	Every element is delivered as a document: its events are followed by
+ * 	the document end callback (or JSMN_STREAM_EVENT_DOCUMENT_END) with its
+ * 	byte range. The array itself has no events. Ordered, the elements are
+ * 	delivered in document order, as described for
+ * 	jsmn_stream_ndjson_parse_parallel().
+ *
+ * 	A malformed element fails the parse: it goes to the error callback and
+ * 	the elements before it are still delivered when ordered. For valid JSON
+ * 	the events are those of parsing the array with one parser. For invalid
+ * 	JSON the offending offset can differ, in particular brackets that do
+ * 	not balance are reported at the end of the array.
+ *
+ * @param data
+ * @param length
+ * @param config
+ * @return int 0, JSMN_STREAM_STOPPED when a callback stopped the parse,
+ * 	JSMN_STREAM_ERROR_INVAL for an invalid configuration or input that is
+ * 	not an array, JSMN_STREAM_ERROR_NOMEM when memory or a thread could not
+ * 	be had, or the error of a malformed element.
+ */
+int jsmn_stream_ndjson_parse_array_parallel(const char *data, size_t length, const jsmn_stream_ndjson_parallel_t *config)
+{
+	size_t slice_size = config->slice_size != 0 ? config->slice_size : JSMN_STREAM_NDJSON_SLICE_SIZE;
+	size_t chunk_count = 0;
+	size_t first = 0;
+	size_t last = length;
+	jsmn_stream_ndjson_chunk_t *chunks;
+	jsmn_stream_ndjson_summary_t *summaries;
+	jsmn_stream_ndjson_pool_t pool;
+	size_t started = 0;
+	bool in_string = false;
+	long depth = 0;
+	int r;
+
+	// the array brackets, whitespace around them aside
+	while (first < length && memchr(" \t\r\n", data[first], 4) != NULL)
+	{
+		first++;
+	}
+	while (last > first && memchr(" \t\r\n", data[last - 1], 4) != NULL)
+	{
+		last--;
+	}
+	if (last - first < 2 || data[first] != '[' || data[last - 1] != ']')
+	{
+		return JSMN_STREAM_ERROR_INVAL;
+	}
+	first++;
+	last--;
+
+	r = jsmn_stream_ndjson_pool_init(&pool, data, config, (last - first) / slice_size + 1);
+	if (r != 0)
+	{
+		return r;
+	}
+	chunks = calloc((last - first) / slice_size + 1, sizeof(*chunks));
+	summaries = calloc(config->threads, sizeof(*summaries));
+	if (chunks == NULL || summaries == NULL)
+	{
+		free(chunks);
+		free(summaries);
+		free(pool.slices);
+		return JSMN_STREAM_ERROR_NOMEM;
+	}
+
+	// parts start after a character other than a backslash, so that their
+	// first character is not escaped
+	for (size_t start = first; start < last; chunk_count++)
+	{
+		size_t end = last - start > slice_size ? start + slice_size : last;
+
+		while (end < last && data[end - 1] == '\\')
+		{
+			end++;
+		}
+		chunks[chunk_count].start = start;
+		chunks[chunk_count].end = end;
+		start = end;
+	}
+
+	for (; started < config->threads; started++)
+	{
+		summaries[started].data = data;
+		summaries[started].chunks = chunks;
+		summaries[started].first = chunk_count * started / config->threads;
+		summaries[started].last = chunk_count * (started + 1) / config->threads;
+		if (pthread_create(&summaries[started].thread, NULL, jsmn_stream_ndjson_summarize, &summaries[started]) != 0)
+		{
+			break;
+		}
+	}
+	if (started < config->threads)
+	{
+		// summarize the rest here
+		summaries[started].last = chunk_count;
+		jsmn_stream_ndjson_summarize(&summaries[started]);
+	}
+	for (size_t t = 0; t < started; t++)
+	{
+		pthread_join(summaries[t].thread, NULL);
+	}
+
+	// the slices start after the first comma of each part
+	pool.slices[0].start = first;
+	pool.slice_count = 1;
+	for (size_t c = 0; c < chunk_count; c++)
+	{
+		if (c > 0)
+		{
+			size_t comma = jsmn_stream_ndjson_find_element(data, chunks[c].start, chunks[c].end, in_string, depth + 1);
+
+			if (comma != JSMN_STREAM_NDJSON_NO_ELEMENT)
+			{
+				pool.slices[pool.slice_count - 1].end = comma;
+				pool.slices[pool.slice_count].start = comma + 1;
+				pool.slice_count++;
+			}
+		}
+		depth += in_string ? chunks[c].depth_inside : chunks[c].depth_outside;
+		in_string = in_string != chunks[c].odd_quotes;
+	}
+	pool.slices[pool.slice_count - 1].end = last;
+	pool.array = true;
+
+	r = jsmn_stream_ndjson_run(&pool);
+	free(chunks);
+	free(summaries);
+	free(pool.slices);
+	return r;
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef __JSMN_STREAM_NDJSON_H_
+#define __JSMN_STREAM_NDJSON_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "jsmn_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Set to 0 to leave out the parallel parse functions and pthreads */
+#ifndef JSMN_STREAM_NDJSON_THREADS
+#if defined(__unix__) || defined(__APPLE__)
+#define JSMN_STREAM_NDJSON_THREADS 1
+#else
+#define JSMN_STREAM_NDJSON_THREADS 0
+#endif
+#endif
+/* Default number of characters per slice of jsmn_stream_ndjson_parse_parallel() */
+#ifndef JSMN_STREAM_NDJSON_SLICE_SIZE
+#define JSMN_STREAM_NDJSON_SLICE_SIZE (1024 * 1024)
+#endif
+
+/**
+ * @brief Receives a malformed record.
+ * 	offset is the stream offset of the offending character, error the
+ * 	jsmn_streamerr. Parsing resumes after the next newline.
+ *
+ */
+typedef void (* jsmn_stream_ndjson_error_callback_t)(size_t offset, int error, void *user_arg);
+
+/**
+ * @brief Parser of JSON Lines, also called NDJSON: JSON documents separated
+ * 	by newlines. Every document ends with the document end callback. A
+ * 	malformed record goes to the error callback and only its line is
+ * 	dropped, instead of failing the whole stream.
+ *
+ */
+typedef struct {
+  jsmn_stream_parser stream_parser;
+#if !JSMN_STREAM_DEFAULT_STORAGE
+  char stream_buffer[JSMN_STREAM_BUFFER_SIZE];
+  jsmn_stream_stack_t stream_type_stack[JSMN_STREAM_STACK_WORDS(JSMN_STREAM_MAX_DEPTH)];
+#endif
+  const jsmn_stream_callbacks_t *callbacks;
+  void *user_arg;
+  jsmn_stream_ndjson_error_callback_t error_callback;
+  bool resyncing; // dropping the rest of a malformed record
+  size_t errors; // number of malformed records so far
+} jsmn_stream_ndjson_t;
+
+void jsmn_stream_ndjson_init(jsmn_stream_ndjson_t *ndjson, const jsmn_stream_callbacks_t *callbacks, void *user_arg, jsmn_stream_ndjson_error_callback_t error_callback);
+int jsmn_stream_ndjson_parse(jsmn_stream_ndjson_t *ndjson, const char *data, size_t length, size_t *consumed);
+int jsmn_stream_ndjson_finish(jsmn_stream_ndjson_t *ndjson);
+
+#if JSMN_STREAM_NDJSON_THREADS
+/**
+ * @brief Configuration of jsmn_stream_ndjson_parse_parallel() and
+ * 	jsmn_stream_ndjson_parse_array_parallel().
+ *
+ */
+typedef struct {
+  const jsmn_stream_callbacks_t *callbacks;
+  jsmn_stream_ndjson_error_callback_t error_callback; // may be NULL
+  void *user_arg;
+  void *const *worker_args; // user_arg of each worker when not ordered, or NULL
+  size_t threads; // number of worker threads
+  size_t slice_size; // characters per slice, 0 for JSMN_STREAM_NDJSON_SLICE_SIZE
+  bool ordered; // deliver in input order on the calling thread
+} jsmn_stream_ndjson_parallel_t;
+
+int jsmn_stream_ndjson_parse_parallel(const char *data, size_t length, const jsmn_stream_ndjson_parallel_t *config);
+int jsmn_stream_ndjson_parse_array_parallel(const char *data, size_t length, const jsmn_stream_ndjson_parallel_t *config);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSMN_STREAM_NDJSON_H_ */
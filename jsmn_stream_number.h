@@ -0,0 +1,168 @@
+/**
+ * Conversion of JSON numbers and literals for the typed primitive callbacks.
+ */
+#ifndef __JSMN_STREAM_NUMBER_H_
+#define __JSMN_STREAM_NUMBER_H_
+
+#include <float.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A JSON number as decimal mantissa and exponent */
+typedef struct {
+	uint64_t mantissa; /* Leading significant digits */
+	int64_t exponent; /* Power of ten the mantissa is multiplied by */
+	bool negative;
+	bool integer; /* No fraction or exponent part */
+	bool truncated; /* More digits than fit the mantissa */
+} jsmn_stream_number_t;
+
+static inline uint32_t jsmn_stream_load32(const char *chars) {
+	uint32_t word;
+	memcpy(&word, chars, sizeof(word));
+	return word;
+}
+
+/**
+ * Returns true if the length characters at chars are the literal, which is
+ * compared as a 32 bit word plus a tail character for false.
+ */
+static inline bool jsmn_stream_is_true(const char *chars, size_t length) {
+	return length == 4 && jsmn_stream_load32(chars) == jsmn_stream_load32("true");
+}
+
+static inline bool jsmn_stream_is_false(const char *chars, size_t length) {
+	return length == 5 && jsmn_stream_load32(chars) == jsmn_stream_load32("fals") &&
+		chars[4] == 'e';
+}
+
+static inline bool jsmn_stream_is_null(const char *chars, size_t length) {
+	return length == 4 && jsmn_stream_load32(chars) == jsmn_stream_load32("null");
+}
+
+/**
+ * Scans a JSON number in a single pass. Returns false if the characters are
+ * not a number by the JSON grammar, e.g. with leading zeros or a trailing
+ * dot.
+ */
+static inline bool jsmn_stream_number_scan(const char *chars, size_t length,
+	jsmn_stream_number_t *number) {
+	const char *end = chars + length;
+	int64_t exponent = 0;
+	bool exponent_negative = false;
+
+	number->mantissa = 0;
+	number->exponent = 0;
+	number->negative = false;
+	number->integer = true;
+	number->truncated = false;
+
+	if (chars < end && *chars == '-') {
+		number->negative = true;
+		chars++;
+	}
+	if (chars == end || *chars < '0' || *chars > '9') {
+		return false;
+	}
+	if (*chars == '0') {
+		chars++;
+	} else {
+		for (; chars < end && *chars >= '0' && *chars <= '9'; chars++) {
+			unsigned int digit = (unsigned int)(*chars - '0');
+			if (number->mantissa <= (UINT64_MAX - digit) / 10) {
+				number->mantissa = number->mantissa * 10 + digit;
+			} else {
+				/* Dropped integer digits still count in the exponent */
+				number->exponent++;
+				number->truncated |= digit != 0;
+			}
+		}
+	}
+
+	if (chars < end && *chars == '.') {
+		const char *fraction = ++chars;
+		number->integer = false;
+		for (; chars < end && *chars >= '0' && *chars <= '9'; chars++) {
+			unsigned int digit = (unsigned int)(*chars - '0');
+			if (number->mantissa <= (UINT64_MAX - digit) / 10) {
+				number->mantissa = number->mantissa * 10 + digit;
+				number->exponent--;
+			} else {
+				number->truncated |= digit != 0;
+			}
+		}
+		if (chars == fraction) {
+			return false;
+		}
+	}
+
+	if (chars < end && (*chars == 'e' || *chars == 'E')) {
+		const char *digits;
+		number->integer = false;
+		chars++;
+		if (chars < end && (*chars == '+' || *chars == '-')) {
+			exponent_negative = *chars == '-';
+			chars++;
+		}
+		digits = chars;
+		for (; chars < end && *chars >= '0' && *chars <= '9'; chars++) {
+			/* Far beyond the double range, the value is 0 or infinite anyway */
+			if (exponent < 100000) {
+				exponent = exponent * 10 + (*chars - '0');
+			}
+		}
+		if (chars == digits) {
+			return false;
+		}
+		number->exponent += exponent_negative ? -exponent : exponent;
+	}
+
+	return chars == end;
+}
+
+/**
+ * Converts a scanned number to a double exactly when the mantissa and the
+ * power of ten are both exact doubles (Clinger's fast path), which covers
+ * the usual numbers with up to 15 digits. Returns false otherwise.
+ */
+static inline bool jsmn_stream_number_fast_double(const jsmn_stream_number_t *number,
+	double *value) {
+	static const double powers_of_ten[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	double result;
+
+	if (number->mantissa == 0 && !number->truncated) {
+		*value = number->negative ? -0.0 : 0.0;
+		return true;
+	}
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+	/* Extended precision intermediates would round twice */
+	return false;
+#endif
+	if (number->truncated || number->mantissa > ((uint64_t)1 << 53) ||
+		number->exponent < -22 || number->exponent > 22) {
+		return false;
+	}
+	result = (double)number->mantissa;
+	if (number->exponent < 0) {
+		result /= powers_of_ten[-number->exponent];
+	} else {
+		result *= powers_of_ten[number->exponent];
+	}
+	*value = number->negative ? -result : result;
+	return true;
+}
+
+/**
+ * Returns true if the converted value is beyond the double range.
+ */
+static inline bool jsmn_stream_double_overflow(double value) {
+	return value > DBL_MAX || value < -DBL_MAX;
+}
+
+#endif /* __JSMN_STREAM_NUMBER_H_ */
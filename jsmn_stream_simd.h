@@ -0,0 +1,537 @@
+/**
+ * Vectorized scanning kernels used by the stream parser. Only SSE2 and AVX2
+ * (plus PCLMUL for the prefix xor) are implemented, other targets fall back
+ * to plain loops.
+ */
+#ifndef __JSMN_STREAM_SIMD_H_
+#define __JSMN_STREAM_SIMD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__PCLMUL__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Returns the number of plain string characters at the start of data, i.e.
+ * the offset of the first quote, backslash or control character, or len if
+ * there is none.
+ */
+static inline size_t jsmn_stream_scan_string(const char *data, size_t len) {
+	size_t i = 0;
+
+#if defined(__AVX2__)
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i control = _mm256_set1_epi8(0x1f);
+	for (; i + 32 <= len; i += 32) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i *)(data + i));
+		__m256i special = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+				_mm256_cmpeq_epi8(chunk, backslash)),
+			/* Unsigned chunk <= 0x1f */
+			_mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control), chunk));
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(special);
+		if (mask != 0) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+#if defined(__SSE2__)
+	const __m128i quote16 = _mm_set1_epi8('"');
+	const __m128i backslash16 = _mm_set1_epi8('\\');
+	const __m128i control16 = _mm_set1_epi8(0x1f);
+	for (; i + 16 <= len; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(data + i));
+		__m128i special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, quote16),
+				_mm_cmpeq_epi8(chunk, backslash16)),
+			/* Unsigned chunk <= 0x1f */
+			_mm_cmpeq_epi8(_mm_min_epu8(chunk, control16), chunk));
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(special);
+		if (mask != 0) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+	for (; i < len; i++) {
+		unsigned char c = (unsigned char)data[i];
+		if (c == '"' || c == '\\' || c < 0x20) {
+			break;
+		}
+	}
+	return i;
+}
+
+/**
+ * Returns the number of characters at the start of data that do not matter
+ * while skipping an object or array, i.e. the offset of the first quote,
+ * backslash or bracket, or len if there is none.
+ */
+static inline size_t jsmn_stream_scan_skipped(const char *data, size_t len) {
+	size_t i = 0;
+
+#if defined(__AVX2__)
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	/* With bit 0x20 set [ and ] compare equal to { and } */
+	const __m256i case_bit = _mm256_set1_epi8(0x20);
+	const __m256i open_bracket = _mm256_set1_epi8('{');
+	const __m256i close_bracket = _mm256_set1_epi8('}');
+	for (; i + 32 <= len; i += 32) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i *)(data + i));
+		__m256i folded = _mm256_or_si256(chunk, case_bit);
+		__m256i special = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+			_mm256_or_si256(_mm256_cmpeq_epi8(folded, open_bracket),
+				_mm256_cmpeq_epi8(folded, close_bracket)));
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(special);
+		if (mask != 0) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+#if defined(__SSE2__)
+	const __m128i quote16 = _mm_set1_epi8('"');
+	const __m128i backslash16 = _mm_set1_epi8('\\');
+	const __m128i case_bit16 = _mm_set1_epi8(0x20);
+	const __m128i open_bracket16 = _mm_set1_epi8('{');
+	const __m128i close_bracket16 = _mm_set1_epi8('}');
+	for (; i + 16 <= len; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(data + i));
+		__m128i folded = _mm_or_si128(chunk, case_bit16);
+		__m128i special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, quote16), _mm_cmpeq_epi8(chunk, backslash16)),
+			_mm_or_si128(_mm_cmpeq_epi8(folded, open_bracket16),
+				_mm_cmpeq_epi8(folded, close_bracket16)));
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(special);
+		if (mask != 0) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+	for (; i < len; i++) {
+		char c = data[i];
+		if (c == '"' || c == '\\' || c == '{' || c == '}' || c == '[' || c == ']') {
+			break;
+		}
+	}
+	return i;
+}
+
+/* Character classes of a 64 character block, one bit per character */
+typedef struct {
+	uint64_t quote;
+	uint64_t backslash;
+	uint64_t whitespace;
+	uint64_t structural; /* { } [ ] : , */
+	uint64_t control; /* Below 0x20, including whitespace other than space */
+	uint64_t high; /* 0x7f and above */
+} jsmn_stream_block_t;
+
+/**
+ * Classifies the 64 characters at data.
+ */
+static inline void jsmn_stream_classify_block(const char *data, jsmn_stream_block_t *block) {
+#if defined(__AVX2__)
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i newline = _mm256_set1_epi8('\n');
+	const __m256i carriage_return = _mm256_set1_epi8('\r');
+	/* With bit 0x20 set [ and ] compare equal to { and } */
+	const __m256i case_bit = _mm256_set1_epi8(0x20);
+	const __m256i open_bracket = _mm256_set1_epi8('{');
+	const __m256i close_bracket = _mm256_set1_epi8('}');
+	const __m256i colon = _mm256_set1_epi8(':');
+	const __m256i comma = _mm256_set1_epi8(',');
+	const __m256i control = _mm256_set1_epi8(0x1f);
+	const __m256i del = _mm256_set1_epi8(0x7f);
+	int half;
+
+	memset(block, 0, sizeof(*block));
+	for (half = 0; half < 2; half++) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i *)(data + half * 32));
+		__m256i folded = _mm256_or_si256(chunk, case_bit);
+		int shift = half * 32;
+#define JSMN_STREAM_MASK(v) ((uint64_t)(uint32_t)_mm256_movemask_epi8(v) << shift)
+		block->quote |= JSMN_STREAM_MASK(_mm256_cmpeq_epi8(chunk, quote));
+		block->backslash |= JSMN_STREAM_MASK(_mm256_cmpeq_epi8(chunk, backslash));
+		block->whitespace |= JSMN_STREAM_MASK(_mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, tab)),
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, newline),
+				_mm256_cmpeq_epi8(chunk, carriage_return))));
+		block->structural |= JSMN_STREAM_MASK(_mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(folded, open_bracket),
+				_mm256_cmpeq_epi8(folded, close_bracket)),
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, colon), _mm256_cmpeq_epi8(chunk, comma))));
+		/* Unsigned chunk <= 0x1f */
+		block->control |= JSMN_STREAM_MASK(
+			_mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control), chunk));
+		/* The sign bit is set for 0x80 and above */
+		block->high |= JSMN_STREAM_MASK(_mm256_cmpeq_epi8(chunk, del)) |
+			((uint64_t)(uint32_t)_mm256_movemask_epi8(chunk) << shift);
+#undef JSMN_STREAM_MASK
+	}
+#elif defined(__SSE2__)
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i carriage_return = _mm_set1_epi8('\r');
+	/* With bit 0x20 set [ and ] compare equal to { and } */
+	const __m128i case_bit = _mm_set1_epi8(0x20);
+	const __m128i open_bracket = _mm_set1_epi8('{');
+	const __m128i close_bracket = _mm_set1_epi8('}');
+	const __m128i colon = _mm_set1_epi8(':');
+	const __m128i comma = _mm_set1_epi8(',');
+	const __m128i control = _mm_set1_epi8(0x1f);
+	const __m128i del = _mm_set1_epi8(0x7f);
+	int quarter;
+
+	memset(block, 0, sizeof(*block));
+	for (quarter = 0; quarter < 4; quarter++) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(data + quarter * 16));
+		__m128i folded = _mm_or_si128(chunk, case_bit);
+		int shift = quarter * 16;
+#define JSMN_STREAM_MASK(v) ((uint64_t)_mm_movemask_epi8(v) << shift)
+		block->quote |= JSMN_STREAM_MASK(_mm_cmpeq_epi8(chunk, quote));
+		block->backslash |= JSMN_STREAM_MASK(_mm_cmpeq_epi8(chunk, backslash));
+		block->whitespace |= JSMN_STREAM_MASK(_mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, carriage_return))));
+		block->structural |= JSMN_STREAM_MASK(_mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(folded, open_bracket), _mm_cmpeq_epi8(folded, close_bracket)),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, colon), _mm_cmpeq_epi8(chunk, comma))));
+		/* Unsigned chunk <= 0x1f */
+		block->control |= JSMN_STREAM_MASK(_mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+		/* The sign bit is set for 0x80 and above */
+		block->high |= JSMN_STREAM_MASK(_mm_cmpeq_epi8(chunk, del)) | JSMN_STREAM_MASK(chunk);
+#undef JSMN_STREAM_MASK
+	}
+#else
+	int i;
+
+	memset(block, 0, sizeof(*block));
+	for (i = 0; i < 64; i++) {
+		unsigned char c = (unsigned char)data[i];
+		uint64_t bit = (uint64_t)1 << i;
+		switch (c) {
+			case '"': block->quote |= bit; break;
+			case '\\': block->backslash |= bit; break;
+			case ' ': case '\t': case '\n': case '\r': block->whitespace |= bit; break;
+			case '{': case '}': case '[': case ']': case ':': case ',':
+				block->structural |= bit; break;
+			default: break;
+		}
+		if (c < 0x20) {
+			block->control |= bit;
+		} else if (c >= 0x7f) {
+			block->high |= bit;
+		}
+	}
+#endif
+}
+
+/* Characters of a 64 character block that matter while skipping */
+typedef struct {
+	uint64_t quote;
+	uint64_t backslash;
+	uint64_t open; /* { [ */
+	uint64_t close; /* } ] */
+} jsmn_stream_skip_block_t;
+
+/**
+ * Classifies the 64 characters at data for skipping, which takes fewer
+ * comparisons than jsmn_stream_classify_block().
+ */
+static inline void jsmn_stream_classify_skipped(const char *data, jsmn_stream_skip_block_t *block) {
+#if defined(__AVX2__)
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i case_bit = _mm256_set1_epi8(0x20);
+	const __m256i open_bracket = _mm256_set1_epi8('{');
+	const __m256i close_bracket = _mm256_set1_epi8('}');
+	int half;
+
+	memset(block, 0, sizeof(*block));
+	for (half = 0; half < 2; half++) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i *)(data + half * 32));
+		__m256i folded = _mm256_or_si256(chunk, case_bit);
+		int shift = half * 32;
+#define JSMN_STREAM_MASK(v) ((uint64_t)(uint32_t)_mm256_movemask_epi8(v) << shift)
+		block->quote |= JSMN_STREAM_MASK(_mm256_cmpeq_epi8(chunk, quote));
+		block->backslash |= JSMN_STREAM_MASK(_mm256_cmpeq_epi8(chunk, backslash));
+		block->open |= JSMN_STREAM_MASK(_mm256_cmpeq_epi8(folded, open_bracket));
+		block->close |= JSMN_STREAM_MASK(_mm256_cmpeq_epi8(folded, close_bracket));
+#undef JSMN_STREAM_MASK
+	}
+#elif defined(__SSE2__)
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i case_bit = _mm_set1_epi8(0x20);
+	const __m128i open_bracket = _mm_set1_epi8('{');
+	const __m128i close_bracket = _mm_set1_epi8('}');
+	int quarter;
+
+	memset(block, 0, sizeof(*block));
+	for (quarter = 0; quarter < 4; quarter++) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(data + quarter * 16));
+		__m128i folded = _mm_or_si128(chunk, case_bit);
+		int shift = quarter * 16;
+#define JSMN_STREAM_MASK(v) ((uint64_t)_mm_movemask_epi8(v) << shift)
+		block->quote |= JSMN_STREAM_MASK(_mm_cmpeq_epi8(chunk, quote));
+		block->backslash |= JSMN_STREAM_MASK(_mm_cmpeq_epi8(chunk, backslash));
+		block->open |= JSMN_STREAM_MASK(_mm_cmpeq_epi8(folded, open_bracket));
+		block->close |= JSMN_STREAM_MASK(_mm_cmpeq_epi8(folded, close_bracket));
+#undef JSMN_STREAM_MASK
+	}
+#else
+	int i;
+
+	memset(block, 0, sizeof(*block));
+	for (i = 0; i < 64; i++) {
+		uint64_t bit = (uint64_t)1 << i;
+		switch (data[i]) {
+			case '"': block->quote |= bit; break;
+			case '\\': block->backslash |= bit; break;
+			case '{': case '[': block->open |= bit; break;
+			case '}': case ']': block->close |= bit; break;
+			default: break;
+		}
+	}
+#endif
+}
+
+/**
+ * Returns the bits of the characters escaped by a backslash. An escaping
+ * backslash at the end of the previous block is passed in prev_escaped (0
+ * or 1), which receives the same for this block.
+ */
+static inline uint64_t jsmn_stream_find_escaped(uint64_t backslash, uint64_t *prev_escaped) {
+	const uint64_t even_bits = 0x5555555555555555ULL;
+	uint64_t follows_escape, odd_sequence_starts, sequences_starting_on_even_bits;
+
+	/* A backslash escaped by the previous block does not escape */
+	backslash &= ~*prev_escaped;
+	follows_escape = backslash << 1 | *prev_escaped;
+	/* Adding a run to its start carries out of it, odd runs are cleared */
+	odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+	sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+	*prev_escaped = sequences_starting_on_even_bits < odd_sequence_starts;
+	return (even_bits ^ (sequences_starting_on_even_bits << 1)) & follows_escape;
+}
+
+/**
+ * Returns bits where bit i is the xor of bits 0 to i, which turns quote bits
+ * into the in-string bits between an opening and a closing quote.
+ */
+static inline uint64_t jsmn_stream_prefix_xor(uint64_t bits) {
+#if defined(__PCLMUL__)
+	return (uint64_t)_mm_cvtsi128_si64(_mm_clmulepi64_si128(
+		_mm_set_epi64x(0, (long long)bits), _mm_set1_epi8((char)0xff), 0));
+#else
+	bits ^= bits << 1;
+	bits ^= bits << 2;
+	bits ^= bits << 4;
+	bits ^= bits << 8;
+	bits ^= bits << 16;
+	bits ^= bits << 32;
+	return bits;
+#endif
+}
+
+/**
+ * Returns the index of the lowest set bit of a nonzero bits.
+ */
+static inline unsigned int jsmn_stream_ctz64(uint64_t bits) {
+#if defined(__GNUC__)
+	return (unsigned int)__builtin_ctzll(bits);
+#else
+	unsigned int n = 0;
+	while ((bits & 1) == 0) {
+		bits >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+/**
+ * Returns the number of set bits.
+ */
+static inline unsigned int jsmn_stream_popcount64(uint64_t bits) {
+#if defined(__GNUC__)
+	return (unsigned int)__builtin_popcountll(bits);
+#else
+	unsigned int n = 0;
+	while (bits != 0) {
+		bits &= bits - 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+/**
+ * Returns the offset where a UTF-8 sequence at data[end - 3 .. end - 1]
+ * would be cut by end, or end if none is.
+ */
+static inline size_t jsmn_stream_utf8_boundary(const char *data, size_t end) {
+	size_t back;
+
+	for (back = 1; back <= 3 && back <= end; back++) {
+		unsigned char c = (unsigned char)data[end - back];
+		if (c >= 0xc0) {
+			size_t length = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : 2;
+			return length > back ? end - back : end;
+		}
+		if (c < 0x80) {
+			break;
+		}
+	}
+	return end;
+}
+
+/**
+ * Returns the number of characters at the start of data that are valid
+ * UTF-8 and end on a sequence boundary, data starting on one. It stops at
+ * or a little before the first invalid or cut sequence, so the caller checks
+ * what follows one byte at a time to find it. With AVX2 multibyte sequences
+ * are validated too, with the lookup tables of Keiser and Lemire, "Validating
+ * UTF-8 In Less Than One Instruction Per Byte". Otherwise, and for the last
+ * few characters, it only skips ASCII.
+ */
+static inline size_t jsmn_stream_scan_utf8(const char *data, size_t len) {
+	size_t i = 0;
+
+#if defined(__AVX2__)
+	/* Error bits, set in all three lookups for an invalid pair of bytes */
+#define JSMN_STREAM_TOO_SHORT (1 << 0) /* Lead not followed by a continuation */
+#define JSMN_STREAM_TOO_LONG (1 << 1) /* Continuation after ASCII */
+#define JSMN_STREAM_OVERLONG_3 (1 << 2)
+#define JSMN_STREAM_TOO_LARGE (1 << 3) /* Above U+10FFFF */
+#define JSMN_STREAM_SURROGATE (1 << 4)
+#define JSMN_STREAM_OVERLONG_2 (1 << 5)
+#define JSMN_STREAM_TOO_LARGE_1000 (1 << 6)
+#define JSMN_STREAM_OVERLONG_4 (1 << 6)
+#define JSMN_STREAM_TWO_CONTS (1 << 7) /* Continuation after continuation */
+#define JSMN_STREAM_CARRY (JSMN_STREAM_TOO_SHORT | JSMN_STREAM_TOO_LONG | JSMN_STREAM_TWO_CONTS)
+#define JSMN_STREAM_TABLE(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p) \
+	_mm256_setr_epi8(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p, \
+		a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p)
+	/* By the high nibble of the first byte of the pair */
+	const __m256i byte_1_high = JSMN_STREAM_TABLE(
+		JSMN_STREAM_TOO_LONG, JSMN_STREAM_TOO_LONG, JSMN_STREAM_TOO_LONG, JSMN_STREAM_TOO_LONG,
+		JSMN_STREAM_TOO_LONG, JSMN_STREAM_TOO_LONG, JSMN_STREAM_TOO_LONG, JSMN_STREAM_TOO_LONG,
+		JSMN_STREAM_TWO_CONTS, JSMN_STREAM_TWO_CONTS, JSMN_STREAM_TWO_CONTS, JSMN_STREAM_TWO_CONTS,
+		JSMN_STREAM_TOO_SHORT | JSMN_STREAM_OVERLONG_2,
+		JSMN_STREAM_TOO_SHORT,
+		JSMN_STREAM_TOO_SHORT | JSMN_STREAM_OVERLONG_3 | JSMN_STREAM_SURROGATE,
+		JSMN_STREAM_TOO_SHORT | JSMN_STREAM_TOO_LARGE | JSMN_STREAM_TOO_LARGE_1000 | JSMN_STREAM_OVERLONG_4);
+	/* By the low nibble of the first byte of the pair */
+	const __m256i byte_1_low = JSMN_STREAM_TABLE(
+		JSMN_STREAM_CARRY | JSMN_STREAM_OVERLONG_3 | JSMN_STREAM_OVERLONG_2 | JSMN_STREAM_OVERLONG_4,
+		JSMN_STREAM_CARRY | JSMN_STREAM_OVERLONG_2,
+		JSMN_STREAM_CARRY,
+		JSMN_STREAM_CARRY,
+		JSMN_STREAM_CARRY | JSMN_STREAM_TOO_LARGE,
+		JSMN_STREAM_CARRY | JSMN_STREAM_TOO_LARGE | JSMN_STREAM_TOO_LARGE_1000,
+		JSMN_STREAM_CARRY | JSMN_STREAM_TOO_LARGE | JSMN_STREAM_TOO_LARGE_1000,
+		JSMN_STREAM_CARRY | JSMN_STREAM_TOO_LARGE | JSMN_STREAM_TOO_LARGE_1000,
+		JSMN_STREAM_CARRY | JSMN_STREAM_TOO_LARGE | JSMN_STREAM_TOO_LARGE_1000,
+		JSMN_STREAM_CARRY | JSMN_STREAM_TOO_LARGE | JSMN_STREAM_TOO_LARGE_1000,
+		JSMN_STREAM_CARRY | JSMN_STREAM_TOO_LARGE | JSMN_STREAM_TOO_LARGE_1000,
+		JSMN_STREAM_CARRY | JSMN_STREAM_TOO_LARGE | JSMN_STREAM_TOO_LARGE_1000,
+		JSMN_STREAM_CARRY | JSMN_STREAM_TOO_LARGE | JSMN_STREAM_TOO_LARGE_1000,
+		JSMN_STREAM_CARRY | JSMN_STREAM_TOO_LARGE | JSMN_STREAM_TOO_LARGE_1000 | JSMN_STREAM_SURROGATE,
+		JSMN_STREAM_CARRY | JSMN_STREAM_TOO_LARGE | JSMN_STREAM_TOO_LARGE_1000,
+		JSMN_STREAM_CARRY | JSMN_STREAM_TOO_LARGE | JSMN_STREAM_TOO_LARGE_1000);
+	/* By the high nibble of the second byte of the pair */
+	const __m256i byte_2_high = JSMN_STREAM_TABLE(
+		JSMN_STREAM_TOO_SHORT, JSMN_STREAM_TOO_SHORT, JSMN_STREAM_TOO_SHORT, JSMN_STREAM_TOO_SHORT,
+		JSMN_STREAM_TOO_SHORT, JSMN_STREAM_TOO_SHORT, JSMN_STREAM_TOO_SHORT, JSMN_STREAM_TOO_SHORT,
+		JSMN_STREAM_TOO_LONG | JSMN_STREAM_OVERLONG_2 | JSMN_STREAM_TWO_CONTS |
+			JSMN_STREAM_OVERLONG_3 | JSMN_STREAM_TOO_LARGE_1000 | JSMN_STREAM_OVERLONG_4,
+		JSMN_STREAM_TOO_LONG | JSMN_STREAM_OVERLONG_2 | JSMN_STREAM_TWO_CONTS |
+			JSMN_STREAM_OVERLONG_3 | JSMN_STREAM_TOO_LARGE,
+		JSMN_STREAM_TOO_LONG | JSMN_STREAM_OVERLONG_2 | JSMN_STREAM_TWO_CONTS |
+			JSMN_STREAM_SURROGATE | JSMN_STREAM_TOO_LARGE,
+		JSMN_STREAM_TOO_LONG | JSMN_STREAM_OVERLONG_2 | JSMN_STREAM_TWO_CONTS |
+			JSMN_STREAM_SURROGATE | JSMN_STREAM_TOO_LARGE,
+		JSMN_STREAM_TOO_SHORT, JSMN_STREAM_TOO_SHORT, JSMN_STREAM_TOO_SHORT, JSMN_STREAM_TOO_SHORT);
+	/* Subtracted with saturation, non-zero for a lead cut by the block end */
+	const __m256i incomplete_max = _mm256_setr_epi8(
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		(char)(0xf0 - 1), (char)(0xe0 - 1), (char)(0xc0 - 1));
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	__m256i prev_input = _mm256_setzero_si256();
+	__m256i prev_incomplete = _mm256_setzero_si256();
+
+	for (; i + 32 <= len; i += 32) {
+		__m256i input = _mm256_loadu_si256((const __m256i *)(data + i));
+		__m256i error;
+		if (_mm256_movemask_epi8(input) == 0) {
+			/* ASCII, only a sequence cut by the previous block end is wrong */
+			error = prev_incomplete;
+		} else {
+			/* The bytes 1, 2 and 3 before each byte, across blocks */
+			__m256i carried = _mm256_permute2x128_si256(prev_input, input, 0x21);
+			__m256i prev1 = _mm256_alignr_epi8(input, carried, 16 - 1);
+			__m256i prev2 = _mm256_alignr_epi8(input, carried, 16 - 2);
+			__m256i prev3 = _mm256_alignr_epi8(input, carried, 16 - 3);
+			__m256i special = _mm256_and_si256(_mm256_and_si256(
+				_mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+				_mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, nibble))),
+				_mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+			/* Third and fourth bytes must be continuations, and only they */
+			__m256i must_be_continuation = _mm256_and_si256(_mm256_or_si256(
+				_mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xe0 - 0x80))),
+				_mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xf0 - 0x80)))),
+				_mm256_set1_epi8((char)0x80));
+			error = _mm256_xor_si256(must_be_continuation, special);
+		}
+		if (!_mm256_testz_si256(error, error)) {
+			/* Leave the sequence cut by the block start to the caller */
+			return jsmn_stream_utf8_boundary(data, i);
+		}
+		prev_incomplete = _mm256_subs_epu8(input, incomplete_max);
+		prev_input = input;
+	}
+	i = jsmn_stream_utf8_boundary(data, i);
+#undef JSMN_STREAM_TOO_SHORT
+#undef JSMN_STREAM_TOO_LONG
+#undef JSMN_STREAM_OVERLONG_3
+#undef JSMN_STREAM_TOO_LARGE
+#undef JSMN_STREAM_SURROGATE
+#undef JSMN_STREAM_OVERLONG_2
+#undef JSMN_STREAM_TOO_LARGE_1000
+#undef JSMN_STREAM_OVERLONG_4
+#undef JSMN_STREAM_TWO_CONTS
+#undef JSMN_STREAM_CARRY
+#undef JSMN_STREAM_TABLE
+#elif defined(__SSE2__)
+	for (; i + 16 <= len; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(data + i));
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(chunk);
+		if (mask != 0) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+	for (; i < len; i++) {
+		if ((unsigned char)data[i] >= 0x80) {
+			break;
+		}
+	}
+	return i;
+}
+
+#endif /* __JSMN_STREAM_SIMD_H_ */
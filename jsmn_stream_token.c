@@ -1,25 +1,46 @@
 #include "jsmn_stream_token.h"
+#include <limits.h>
 #include <stdbool.h>
+#include <string.h>
 
-static jsmn_streamtok_t *jsmn_stream_allocate_token(jsmn_stream_token_parser_t *jsmn_stream_parser);
-static jsmn_streamtok_t *jsmn_stream_get_super_token(jsmn_stream_token_parser_t *jsmn_stream_parser);
-static jsmn_streamtok_t *jsmn_stream_get_super_collection_token(jsmn_stream_token_parser_t *jsmn_stream_parser, jsmn_streamtok_t *token);
+static void jsmn_stream_reset_tokens(jsmn_stream_token_parser_t *jsmn_stream_parser, int first, int last);
+static bool jsmn_stream_grow_tokens(jsmn_stream_token_parser_t *jsmn_stream_parser, int num_tokens);
+static void *jsmn_stream_grow_array(const jsmn_stream_token_allocator_t *allocator, void *array, size_t size);
+static size_t jsmn_stream_get_char_count(jsmn_stream_token_parser_t *jsmn_stream_parser);
+static bool jsmn_stream_offset_fits(jsmn_stream_token_parser_t *jsmn_stream_parser, size_t offset);
+static void jsmn_stream_set_token(jsmn_stream_token_parser_t *jsmn_stream_parser, int id, jsmn_streamtype_t type, size_t start);
+static void jsmn_stream_set_token_end(jsmn_stream_token_parser_t *jsmn_stream_parser, int id, size_t end);
+static void jsmn_stream_set_token_size(jsmn_stream_token_parser_t *jsmn_stream_parser, int id, int size);
+static void jsmn_stream_set_token_end_id(jsmn_stream_token_parser_t *jsmn_stream_parser, int id, int end_id);
+static void jsmn_stream_add_key_token(jsmn_stream_token_parser_t *jsmn_stream_parser, size_t offset, size_t length, uint32_t hash);
+static int jsmn_stream_allocate_token(jsmn_stream_token_parser_t *jsmn_stream_parser);
+static int jsmn_stream_get_super_token(jsmn_stream_token_parser_t *jsmn_stream_parser);
+static int jsmn_stream_close_token(jsmn_stream_token_parser_t *jsmn_stream_parser, int id);
 static void jsmn_stream_parse_tokens_start_array(void *user_arg);
 static void jsmn_stream_parse_tokens_end_array(void *user_arg);
 static void jsmn_stream_parse_tokens_start_object(void *user_arg);
 static void jsmn_stream_parse_tokens_end_object(void *user_arg);
-static void jsmn_stream_parse_tokens_object_key(const char *key, size_t key_length, void *user_arg);
-static void jsmn_stream_parse_tokens_string(const char *value, size_t length, void *user_arg);
-static void jsmn_stream_parse_tokens_primitive(const char *value, size_t length, void *user_arg);
+static void jsmn_stream_parse_tokens_object_key(const char *key, size_t key_length, size_t offset, void *user_arg);
+static void jsmn_stream_parse_tokens_string(const char *value, size_t length, size_t offset, void *user_arg);
+static void jsmn_stream_parse_tokens_primitive(const char *value, size_t length, size_t offset, void *user_arg);
+static void jsmn_stream_parse_tokens_key_fragment(const char *key, size_t key_length, size_t offset, bool final, void *user_arg);
+static void jsmn_stream_parse_tokens_string_fragment(const char *value, size_t length, size_t offset, bool final, void *user_arg);
+static size_t jsmn_stream_snapshot_put_byte(unsigned char *data, size_t size, size_t at, unsigned char value);
+static size_t jsmn_stream_snapshot_put_size(unsigned char *data, size_t size, size_t at, size_t value);
+static size_t jsmn_stream_snapshot_put_hash(unsigned char *data, size_t size, size_t at, uint32_t hash);
+static bool jsmn_stream_snapshot_get_size(const unsigned char *data, size_t size, size_t *at, size_t *value);
+static bool jsmn_stream_snapshot_get_hash(const unsigned char *data, size_t size, size_t *at, uint32_t *hash);
 	
-static jsmn_stream_callbacks_t jsmn_stream_token_callbacks = {
+static const jsmn_stream_callbacks_t jsmn_stream_token_callbacks = {
 	.start_array_callback = jsmn_stream_parse_tokens_start_array,
 	.end_array_callback = jsmn_stream_parse_tokens_end_array,
 	.start_object_callback = jsmn_stream_parse_tokens_start_object,
 	.end_object_callback = jsmn_stream_parse_tokens_end_object,
-	.object_key_callback = jsmn_stream_parse_tokens_object_key,
-	.string_callback = jsmn_stream_parse_tokens_string,
-	.primitive_callback = jsmn_stream_parse_tokens_primitive
+	.object_key_span_callback = jsmn_stream_parse_tokens_object_key,
+	.string_span_callback = jsmn_stream_parse_tokens_string,
+	.primitive_span_callback = jsmn_stream_parse_tokens_primitive,
+	.key_fragment_callback = jsmn_stream_parse_tokens_key_fragment,
+	.string_fragment_callback = jsmn_stream_parse_tokens_string_fragment
 };
 
 /**
@@ -33,23 +54,150 @@ static jsmn_stream_callbacks_t jsmn_stream_token_callbacks = {
 void jsmn_stream_parse_tokens_init(jsmn_stream_token_parser_t *jsmn_stream_token_parser, jsmn_streamtok_t *tokens, int num_tokens)
 {
 	jsmn_stream_token_parser->tokens = tokens;
+	jsmn_stream_token_parser->store = (jsmn_stream_token_store_t){ 0 };
+	jsmn_stream_token_parser->compact = false;
+	jsmn_stream_token_parser->allocator = NULL;
 	jsmn_stream_token_parser->num_tokens = num_tokens;
 	jsmn_stream_token_parser->next_token = 0;
 	jsmn_stream_token_parser->char_count = 0;
 	jsmn_stream_token_parser->super_token_id = JSMN_STREAM_TOKEN_UNDEFINED;
+	jsmn_stream_token_parser->key_hash = JSMN_STREAM_TOKEN_HASH_SEED;
 	jsmn_stream_token_parser->error = JSMN_STREAM_TOKEN_ERROR_NONE;
+	jsmn_stream_token_parser->text = NULL;
+#if JSMN_STREAM_DEFAULT_STORAGE
 	jsmn_stream_init(&jsmn_stream_token_parser->stream_parser, &jsmn_stream_token_callbacks, jsmn_stream_token_parser);
+#else
+	jsmn_stream_init_with_storage(&jsmn_stream_token_parser->stream_parser, &jsmn_stream_token_callbacks, jsmn_stream_token_parser,
+		jsmn_stream_token_parser->stream_buffer, JSMN_STREAM_BUFFER_SIZE,
+		jsmn_stream_token_parser->stream_type_stack, JSMN_STREAM_MAX_DEPTH);
+#endif
 
-	for (uint32_t i = 0; i < (uint32_t)num_tokens; i++)
+	jsmn_stream_reset_tokens(jsmn_stream_token_parser, 0, num_tokens);
+}
+
+/**
+ * @brief Initialize the jsmn_stream_token_parser_t object with a token pool
+ * 	that grows as needed. The pool doubles when it is full, so a document
+ * 	is parsed once however many tokens it has. Tokens are addressed by id,
+ * 	as tokens can move when the pool grows. Release the pool with
+ * 	jsmn_stream_parse_tokens_free().
+ * 
+ * @param jsmn_stream_token_parser 
+ * @param allocator memory hooks. Referenced, so it must outlive the parser.
+ * @param num_tokens initial number of tokens, 0 for JSMN_STREAM_TOKEN_INITIAL_TOKENS.
+ * @return int JSMN_STREAM_TOKEN_ERROR_NONE, or JSMN_STREAM_TOKEN_ERROR_NOMEM
+ * 	if the initial tokens could not be allocated.
+ */
+int jsmn_stream_parse_tokens_init_growable(jsmn_stream_token_parser_t *jsmn_stream_token_parser, const jsmn_stream_token_allocator_t *allocator, int num_tokens)
+{
+	jsmn_stream_parse_tokens_init(jsmn_stream_token_parser, NULL, 0);
+	jsmn_stream_token_parser->allocator = allocator;
+
+	if (!jsmn_stream_grow_tokens(jsmn_stream_token_parser, num_tokens > 0 ? num_tokens : JSMN_STREAM_TOKEN_INITIAL_TOKENS))
+	{
+		return JSMN_STREAM_TOKEN_ERROR_NOMEM;
+	}
+
+	return JSMN_STREAM_TOKEN_ERROR_NONE;
+}
+
+/**
+ * @brief Initialize the jsmn_stream_token_parser_t object with a compact
+ * 	token store. Read the tokens with jsmn_stream_token_type() and the
+ * 	other accessors.
+ * 
+ * @param jsmn_stream_token_parser 
+ * @param store arrays of num_tokens entries each. Copied.
+ * @param num_tokens 
+ */
+void jsmn_stream_parse_tokens_init_compact(jsmn_stream_token_parser_t *jsmn_stream_token_parser, const jsmn_stream_token_store_t *store, int num_tokens)
+{
+	jsmn_stream_parse_tokens_init(jsmn_stream_token_parser, NULL, 0);
+	jsmn_stream_token_parser->store = *store;
+	jsmn_stream_token_parser->compact = true;
+	jsmn_stream_token_parser->num_tokens = num_tokens;
+
+	jsmn_stream_reset_tokens(jsmn_stream_token_parser, 0, num_tokens);
+}
+
+/**
+ * @brief Initialize the jsmn_stream_token_parser_t object with a compact
+ * 	token store that grows as needed, see
+ * 	jsmn_stream_parse_tokens_init_growable().
+ * 
+ * @param jsmn_stream_token_parser 
+ * @param allocator memory hooks. Referenced, so it must outlive the parser.
+ * @param num_tokens initial number of tokens, 0 for JSMN_STREAM_TOKEN_INITIAL_TOKENS.
+ * @return int JSMN_STREAM_TOKEN_ERROR_NONE, or JSMN_STREAM_TOKEN_ERROR_NOMEM
+ * 	if the initial tokens could not be allocated.
+ */
+int jsmn_stream_parse_tokens_init_compact_growable(jsmn_stream_token_parser_t *jsmn_stream_token_parser, const jsmn_stream_token_allocator_t *allocator, int num_tokens)
+{
+	jsmn_stream_parse_tokens_init(jsmn_stream_token_parser, NULL, 0);
+	jsmn_stream_token_parser->compact = true;
+	jsmn_stream_token_parser->allocator = allocator;
+
+	if (!jsmn_stream_grow_tokens(jsmn_stream_token_parser, num_tokens > 0 ? num_tokens : JSMN_STREAM_TOKEN_INITIAL_TOKENS))
+	{
+		return JSMN_STREAM_TOKEN_ERROR_NOMEM;
+	}
+
+	return JSMN_STREAM_TOKEN_ERROR_NONE;
+}
+
+/**
+ * @brief Release the token pool of a growable parser. Does nothing for a
+ * 	fixed array of tokens.
+ * 
+ * @param jsmn_stream_token_parser 
+ */
+void jsmn_stream_parse_tokens_free(jsmn_stream_token_parser_t *jsmn_stream_token_parser)
+{
+	const jsmn_stream_token_allocator_t *allocator = jsmn_stream_token_parser->allocator;
+	jsmn_stream_token_store_t *store = &jsmn_stream_token_parser->store;
+
+	if (allocator == NULL)
+	{
+		return;
+	}
+
+	// free(NULL) is allowed, but the hooks may not expect it
+	if (jsmn_stream_token_parser->tokens != NULL)
+	{
+		allocator->free(jsmn_stream_token_parser->tokens, allocator->user_arg);
+	}
+	if (store->types != NULL)
+	{
+		allocator->free(store->types, allocator->user_arg);
+	}
+	if (store->starts != NULL)
+	{
+		allocator->free(store->starts, allocator->user_arg);
+	}
+	if (store->lengths != NULL)
+	{
+		allocator->free(store->lengths, allocator->user_arg);
+	}
+	if (store->sizes != NULL)
 	{
-		jsmn_streamtok_t *token = &tokens[i];
-		token->id = i;
-		token->type = JSMN_STREAM_UNDEFINED;
-		token->start = JSMN_STREAM_POSITION_UNDEFINED;
-		token->end = JSMN_STREAM_POSITION_UNDEFINED;
-		token->size = 0;
-		token->parent_id = JSMN_STREAM_TOKEN_UNDEFINED;
+		allocator->free(store->sizes, allocator->user_arg);
 	}
+	if (store->parent_ids != NULL)
+	{
+		allocator->free(store->parent_ids, allocator->user_arg);
+	}
+	if (store->end_ids != NULL)
+	{
+		allocator->free(store->end_ids, allocator->user_arg);
+	}
+	if (store->hashes != NULL)
+	{
+		allocator->free(store->hashes, allocator->user_arg);
+	}
+
+	jsmn_stream_token_parser->tokens = NULL;
+	*store = (jsmn_stream_token_store_t){ 0 };
+	jsmn_stream_token_parser->num_tokens = 0;
 }
 
 /**
@@ -61,87 +209,706 @@ void jsmn_stream_parse_tokens_init(jsmn_stream_token_parser_t *jsmn_stream_token
  */
 int jsmn_stream_parse_tokens(jsmn_stream_token_parser_t *jsmn_stream_token_parser, char c)
 {
-	jsmn_stream_token_parser->char_count++;
-	jsmn_stream_parse((jsmn_stream_parser *)&jsmn_stream_token_parser->stream_parser , c);	
+	return jsmn_stream_parse_tokens_buffer(jsmn_stream_token_parser, &c, 1, NULL);
+}
+
+/**
+ * @brief Parse a chunk of characters. Malformed JSON or nesting deeper than
+ * 	the stream parser allows sets JSMN_STREAM_TOKEN_ERROR_INVALID, which
+ * 	later calls keep returning.
+ * 
+ * @param jsmn_stream_token_parser 
+ * @param data 
+ * @param length 
+ * @param consumed receives the number of characters consumed, which on error
+ * 	is the offset of the offending character. May be NULL.
+ * @return int 
+ */
+int jsmn_stream_parse_tokens_buffer(jsmn_stream_token_parser_t *jsmn_stream_token_parser, const char *data, size_t length, size_t *consumed)
+{
+	if (jsmn_stream_parse_buffer(&jsmn_stream_token_parser->stream_parser, data, length, consumed) != 0
+		&& jsmn_stream_token_parser->error == JSMN_STREAM_TOKEN_ERROR_NONE)
+	{
+		jsmn_stream_token_parser->error = JSMN_STREAM_TOKEN_ERROR_INVALID;
+	}
+	jsmn_stream_token_parser->char_count = jsmn_stream_token_parser->stream_parser.position;
 
 	return jsmn_stream_token_parser->error;
 }
 
+/**
+ * @brief Type of a token, with either token store.
+ * 
+ * @param parser 
+ * @param id 
+ * @return jsmn_streamtype_t 
+ */
+jsmn_streamtype_t jsmn_stream_token_type(const jsmn_stream_token_parser_t *parser, int id)
+{
+	if (parser->compact)
+	{
+		return (jsmn_streamtype_t)parser->store.types[id];
+	}
+	return parser->tokens[id].type;
+}
+
+/**
+ * @brief Start position of a token in the JSON data string.
+ * 
+ * @param parser 
+ * @param id 
+ * @return size_t the position, or (size_t)JSMN_STREAM_POSITION_UNDEFINED.
+ */
+size_t jsmn_stream_token_start(const jsmn_stream_token_parser_t *parser, int id)
+{
+	if (parser->compact)
+	{
+		jsmn_stream_token_offset_t start = parser->store.starts[id];
+		return start == (jsmn_stream_token_offset_t)JSMN_STREAM_POSITION_UNDEFINED ? (size_t)JSMN_STREAM_POSITION_UNDEFINED : (size_t)start;
+	}
+	return (size_t)parser->tokens[id].start;
+}
+
+/**
+ * @brief End position of a token in the JSON data string.
+ * 
+ * @param parser 
+ * @param id 
+ * @return size_t the position, or (size_t)JSMN_STREAM_POSITION_UNDEFINED
+ * 	while the token is open.
+ */
+size_t jsmn_stream_token_end(const jsmn_stream_token_parser_t *parser, int id)
+{
+	if (parser->compact)
+	{
+		jsmn_stream_token_offset_t length = parser->store.lengths[id];
+		return length == (jsmn_stream_token_offset_t)JSMN_STREAM_POSITION_UNDEFINED ? (size_t)JSMN_STREAM_POSITION_UNDEFINED : (size_t)(parser->store.starts[id] + length);
+	}
+	return (size_t)parser->tokens[id].end;
+}
+
+/**
+ * @brief Number of child tokens of a token.
+ * 
+ * @param parser 
+ * @param id 
+ * @return int 
+ */
+int jsmn_stream_token_size(const jsmn_stream_token_parser_t *parser, int id)
+{
+	if (parser->compact)
+	{
+		return parser->store.sizes[id];
+	}
+	return parser->tokens[id].size;
+}
+
+/**
+ * @brief Parent token id of a token.
+ * 
+ * @param parser 
+ * @param id 
+ * @return int the id, or JSMN_STREAM_TOKEN_UNDEFINED for the root token.
+ */
+int jsmn_stream_token_parent(const jsmn_stream_token_parser_t *parser, int id)
+{
+	if (parser->compact)
+	{
+		return parser->store.parent_ids[id];
+	}
+	return parser->tokens[id].parent_id;
+}
+
+/**
+ * @brief Id past a token and its children: the next sibling, or the end of
+ * 	the parent.
+ * 
+ * @param parser 
+ * @param id 
+ * @return int the id, or JSMN_STREAM_TOKEN_UNDEFINED while the token is open.
+ */
+int jsmn_stream_token_end_id(const jsmn_stream_token_parser_t *parser, int id)
+{
+	if (parser->compact)
+	{
+		return parser->store.end_ids[id];
+	}
+	return parser->tokens[id].end_id;
+}
+
+/**
+ * @brief Hash of a key token, recorded as the key is parsed.
+ * 
+ * @param parser 
+ * @param id 
+ * @return uint32_t jsmn_stream_token_hash() of the key characters, 0 for
+ * 	other tokens.
+ */
+uint32_t jsmn_stream_token_key_hash(const jsmn_stream_token_parser_t *parser, int id)
+{
+	if (parser->compact)
+	{
+		return parser->store.hashes[id];
+	}
+	return parser->tokens[id].hash;
+}
+
+/**
+ * @brief 32 bit FNV-1a hash of the characters of a key, as they are in the
+ * 	JSON data string. Hash a key in pieces by passing the result of a
+ * 	piece to the next one.
+ * 
+ * @param hash JSMN_STREAM_TOKEN_HASH_SEED, or the hash of the pieces so far.
+ * @param data 
+ * @param length 
+ * @return uint32_t 
+ */
+uint32_t jsmn_stream_token_hash(uint32_t hash, const char *data, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= (uint8_t)data[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Step through the direct children of a token, skipping their own
+ * 	children.
+ * 
+ * @param parser 
+ * @param parent_id 
+ * @param child_id the previous child, JSMN_STREAM_TOKEN_UNDEFINED for the first.
+ * @return int the next child, or JSMN_STREAM_TOKEN_UNDEFINED past the last
+ * 	one parsed so far.
+ */
+int jsmn_stream_token_next_child(const jsmn_stream_token_parser_t *parser, int parent_id, int child_id)
+{
+	int end_id = jsmn_stream_token_end_id(parser, parent_id);
+	int next_id = (child_id == JSMN_STREAM_TOKEN_UNDEFINED) ? parent_id + 1 : jsmn_stream_token_end_id(parser, child_id);
+
+	// an open parent ends with the tokens parsed so far
+	if (end_id == JSMN_STREAM_TOKEN_UNDEFINED)
+	{
+		end_id = parser->next_token;
+	}
+	// past an open child, all tokens are its children
+	if (next_id == JSMN_STREAM_TOKEN_UNDEFINED || next_id >= end_id)
+	{
+		return JSMN_STREAM_TOKEN_UNDEFINED;
+	}
+
+	return next_id;
+}
+
+/**
+ * @brief Save the token parser between two parse calls: the tokens so far,
+ * 	the counters and the jsmn_stream_snapshot() of the stream parser. The
+ * 	format does not depend on the token store, so a snapshot restores into
+ * 	either store. The text the tokens point into is not part of it.
+ * 
+ * @param parser 
+ * @param data receives the snapshot.
+ * @param size size of data in bytes.
+ * @param written receives the size of the snapshot, also when it does not
+ * 	fit. May be NULL.
+ * @return int JSMN_STREAM_TOKEN_ERROR_NONE, or JSMN_STREAM_TOKEN_ERROR_NOMEM
+ * 	when the snapshot does not fit in size bytes.
+ */
+int jsmn_stream_token_snapshot(const jsmn_stream_token_parser_t *parser, void *data, size_t size, size_t *written)
+{
+	unsigned char *out = (unsigned char *)data;
+	size_t at = 0;
+	size_t stream_size;
+
+	for (size_t i = 0; i < sizeof(JSMN_STREAM_TOKEN_SNAPSHOT_MAGIC) - 1; i++)
+	{
+		at = jsmn_stream_snapshot_put_byte(out, size, at, (unsigned char)JSMN_STREAM_TOKEN_SNAPSHOT_MAGIC[i]);
+	}
+	at = jsmn_stream_snapshot_put_byte(out, size, at, JSMN_STREAM_TOKEN_SNAPSHOT_VERSION);
+	at = jsmn_stream_snapshot_put_size(out, size, at, (size_t)parser->next_token);
+	at = jsmn_stream_snapshot_put_size(out, size, at, parser->char_count);
+	// undefined ids and positions are all ones, written as 0
+	at = jsmn_stream_snapshot_put_size(out, size, at, (size_t)(parser->super_token_id + 1));
+	at = jsmn_stream_snapshot_put_size(out, size, at, (size_t)-parser->error);
+	at = jsmn_stream_snapshot_put_hash(out, size, at, parser->key_hash);
+
+	for (int id = 0; id < parser->next_token; id++)
+	{
+		jsmn_streamtype_t type = jsmn_stream_token_type(parser, id);
+
+		at = jsmn_stream_snapshot_put_byte(out, size, at, (unsigned char)type);
+		at = jsmn_stream_snapshot_put_size(out, size, at, jsmn_stream_token_start(parser, id) + 1);
+		at = jsmn_stream_snapshot_put_size(out, size, at, jsmn_stream_token_end(parser, id) + 1);
+		at = jsmn_stream_snapshot_put_size(out, size, at, (size_t)jsmn_stream_token_size(parser, id));
+		at = jsmn_stream_snapshot_put_size(out, size, at, (size_t)(jsmn_stream_token_parent(parser, id) + 1));
+		at = jsmn_stream_snapshot_put_size(out, size, at, (size_t)(jsmn_stream_token_end_id(parser, id) + 1));
+		if (type == JSMN_STREAM_KEY)
+		{
+			at = jsmn_stream_snapshot_put_hash(out, size, at, jsmn_stream_token_key_hash(parser, id));
+		}
+	}
+
+	// the stream parser takes the rest
+	jsmn_stream_snapshot(&parser->stream_parser, at < size ? out + at : NULL, at < size ? size - at : 0, &stream_size);
+	at += stream_size;
+
+	if (written != NULL)
+	{
+		*written = at;
+	}
+	return at <= size ? JSMN_STREAM_TOKEN_ERROR_NONE : JSMN_STREAM_TOKEN_ERROR_NOMEM;
+}
+
+/**
+ * @brief Restore a snapshot taken by jsmn_stream_token_snapshot() into a
+ * 	freshly initialized token parser, which then continues parsing from the
+ * 	saved position. A growable parser grows to hold the tokens. Initialize
+ * 	the parser again after an error.
+ * 
+ * @param parser 
+ * @param data 
+ * @param size size of the snapshot in bytes.
+ * @return int JSMN_STREAM_TOKEN_ERROR_NONE, JSMN_STREAM_TOKEN_ERROR_INVALID
+ * 	for a snapshot that is damaged or of another version, or
+ * 	JSMN_STREAM_TOKEN_ERROR_NOMEM when the tokens or the stream parser state
+ * 	do not fit in the parser.
+ */
+int jsmn_stream_token_restore(jsmn_stream_token_parser_t *parser, const void *data, size_t size)
+{
+	const unsigned char *in = (const unsigned char *)data;
+	size_t at = sizeof(JSMN_STREAM_TOKEN_SNAPSHOT_MAGIC);
+	size_t next_token, char_count, super_token_id, error;
+	uint32_t key_hash;
+	int result;
+
+	if (size < at
+		|| memcmp(in, JSMN_STREAM_TOKEN_SNAPSHOT_MAGIC, at - 1) != 0
+		|| in[at - 1] != JSMN_STREAM_TOKEN_SNAPSHOT_VERSION
+		|| !jsmn_stream_snapshot_get_size(in, size, &at, &next_token)
+		|| !jsmn_stream_snapshot_get_size(in, size, &at, &char_count)
+		|| !jsmn_stream_snapshot_get_size(in, size, &at, &super_token_id)
+		|| !jsmn_stream_snapshot_get_size(in, size, &at, &error)
+		|| !jsmn_stream_snapshot_get_hash(in, size, &at, &key_hash)
+		|| next_token > INT_MAX
+		|| super_token_id > next_token
+		|| error > (size_t)-JSMN_STREAM_TOKEN_ERROR_INVALID)
+	{
+		return JSMN_STREAM_TOKEN_ERROR_INVALID;
+	}
+
+	if ((int)next_token > parser->num_tokens && !jsmn_stream_grow_tokens(parser, (int)next_token))
+	{
+		return JSMN_STREAM_TOKEN_ERROR_NOMEM;
+	}
+	jsmn_stream_reset_tokens(parser, 0, (int)next_token);
+
+	for (int id = 0; id < (int)next_token; id++)
+	{
+		size_t type, start, end, token_size, parent_id, end_id;
+		uint32_t hash = 0;
+
+		if (!jsmn_stream_snapshot_get_size(in, size, &at, &type)
+			|| !jsmn_stream_snapshot_get_size(in, size, &at, &start)
+			|| !jsmn_stream_snapshot_get_size(in, size, &at, &end)
+			|| !jsmn_stream_snapshot_get_size(in, size, &at, &token_size)
+			|| !jsmn_stream_snapshot_get_size(in, size, &at, &parent_id)
+			|| !jsmn_stream_snapshot_get_size(in, size, &at, &end_id)
+			|| (type == JSMN_STREAM_KEY && !jsmn_stream_snapshot_get_hash(in, size, &at, &hash))
+			|| type > JSMN_STREAM_KEY
+			|| start == 0
+			|| token_size > next_token
+			|| parent_id > (size_t)id
+			|| end_id > next_token + 1)
+		{
+			return JSMN_STREAM_TOKEN_ERROR_INVALID;
+		}
+
+		jsmn_stream_set_token(parser, id, (jsmn_streamtype_t)type, start - 1);
+		if (end != 0)
+		{
+			jsmn_stream_set_token_end(parser, id, end - 1);
+		}
+		jsmn_stream_set_token_size(parser, id, (int)token_size);
+		jsmn_stream_set_token_end_id(parser, id, (int)end_id - 1);
+		if (parser->compact)
+		{
+			parser->store.parent_ids[id] = (int)parent_id - 1;
+			parser->store.hashes[id] = hash;
+		}
+		else
+		{
+			parser->tokens[id].parent_id = (int)parent_id - 1;
+			parser->tokens[id].hash = hash;
+		}
+		// a position past what the store can hold
+		if (parser->error != JSMN_STREAM_TOKEN_ERROR_NONE)
+		{
+			return parser->error;
+		}
+	}
+
+	result = jsmn_stream_restore(&parser->stream_parser, in + at, size - at);
+	if (result != 0)
+	{
+		return result == JSMN_STREAM_ERROR_INVAL ? JSMN_STREAM_TOKEN_ERROR_INVALID : JSMN_STREAM_TOKEN_ERROR_NOMEM;
+	}
+
+	parser->next_token = (int)next_token;
+	parser->char_count = char_count;
+	parser->super_token_id = (int)super_token_id - 1;
+	parser->key_hash = key_hash;
+	parser->error = -(int)error;
+	return JSMN_STREAM_TOKEN_ERROR_NONE;
+}
+
+/**
+ * @brief Mark tokens as not allocated yet.
+ * 
+ * @param jsmn_stream_parser 
+ * @param first index of the first token to reset.
+ * @param last index past the last token to reset.
+ */
+static void jsmn_stream_reset_tokens(jsmn_stream_token_parser_t *jsmn_stream_parser, int first, int last)
+{
+	jsmn_stream_token_store_t *store = &jsmn_stream_parser->store;
+
+	for (int i = first; i < last; i++)
+	{
+		if (jsmn_stream_parser->compact)
+		{
+			store->types[i] = JSMN_STREAM_UNDEFINED;
+			store->starts[i] = (jsmn_stream_token_offset_t)JSMN_STREAM_POSITION_UNDEFINED;
+			store->lengths[i] = (jsmn_stream_token_offset_t)JSMN_STREAM_POSITION_UNDEFINED;
+			store->sizes[i] = 0;
+			store->parent_ids[i] = JSMN_STREAM_TOKEN_UNDEFINED;
+			store->end_ids[i] = JSMN_STREAM_TOKEN_UNDEFINED;
+			store->hashes[i] = 0;
+		}
+		else
+		{
+			jsmn_streamtok_t *token = &jsmn_stream_parser->tokens[i];
+			token->id = i;
+			token->type = JSMN_STREAM_UNDEFINED;
+			token->start = JSMN_STREAM_POSITION_UNDEFINED;
+			token->end = JSMN_STREAM_POSITION_UNDEFINED;
+			token->size = 0;
+			token->parent_id = JSMN_STREAM_TOKEN_UNDEFINED;
+			token->end_id = JSMN_STREAM_TOKEN_UNDEFINED;
+			token->hash = 0;
+		}
+	}
+}
+
+/**
+ * @brief Grow the token pool through the allocator hooks.
+ * 
+ * @param jsmn_stream_parser 
+ * @param num_tokens new number of tokens.
+ * @return true if the pool has grown, false for a fixed array of tokens or
+ * 	when the memory could not be had.
+ */
+static bool jsmn_stream_grow_tokens(jsmn_stream_token_parser_t *jsmn_stream_parser, int num_tokens)
+{
+	const jsmn_stream_token_allocator_t *allocator = jsmn_stream_parser->allocator;
+	jsmn_stream_token_store_t *store = &jsmn_stream_parser->store;
+	size_t count = (size_t)num_tokens;
+
+	if (allocator == NULL || num_tokens <= jsmn_stream_parser->num_tokens)
+	{
+		return false;
+	}
+
+	if (jsmn_stream_parser->compact)
+	{
+		// arrays grown before a failure stay grown, num_tokens is what counts
+		void *array;
+
+		if ((array = jsmn_stream_grow_array(allocator, store->types, count * sizeof(*store->types))) == NULL)
+		{
+			return false;
+		}
+		store->types = array;
+		if ((array = jsmn_stream_grow_array(allocator, store->starts, count * sizeof(*store->starts))) == NULL)
+		{
+			return false;
+		}
+		store->starts = array;
+		if ((array = jsmn_stream_grow_array(allocator, store->lengths, count * sizeof(*store->lengths))) == NULL)
+		{
+			return false;
+		}
+		store->lengths = array;
+		if ((array = jsmn_stream_grow_array(allocator, store->sizes, count * sizeof(*store->sizes))) == NULL)
+		{
+			return false;
+		}
+		store->sizes = array;
+		if ((array = jsmn_stream_grow_array(allocator, store->parent_ids, count * sizeof(*store->parent_ids))) == NULL)
+		{
+			return false;
+		}
+		store->parent_ids = array;
+		if ((array = jsmn_stream_grow_array(allocator, store->end_ids, count * sizeof(*store->end_ids))) == NULL)
+		{
+			return false;
+		}
+		store->end_ids = array;
+		if ((array = jsmn_stream_grow_array(allocator, store->hashes, count * sizeof(*store->hashes))) == NULL)
+		{
+			return false;
+		}
+		store->hashes = array;
+	}
+	else
+	{
+		jsmn_streamtok_t *tokens = jsmn_stream_grow_array(allocator, jsmn_stream_parser->tokens, count * sizeof(jsmn_streamtok_t));
+
+		if (tokens == NULL)
+		{
+			return false;
+		}
+		jsmn_stream_parser->tokens = tokens;
+	}
+
+	jsmn_stream_reset_tokens(jsmn_stream_parser, jsmn_stream_parser->num_tokens, num_tokens);
+	jsmn_stream_parser->num_tokens = num_tokens;
+	return true;
+}
+
+/**
+ * @brief Allocate or reallocate an array through the allocator hooks.
+ * 
+ * @param allocator 
+ * @param array the array to grow, NULL for a new one.
+ * @param size new size in bytes.
+ * @return void* the array, or NULL when the memory could not be had.
+ */
+static void *jsmn_stream_grow_array(const jsmn_stream_token_allocator_t *allocator, void *array, size_t size)
+{
+	if (array == NULL)
+	{
+		return allocator->malloc(size, allocator->user_arg);
+	}
+	return allocator->realloc(array, size, allocator->user_arg);
+}
+
+/**
+ * @brief Number of characters consumed, including the one being parsed.
+ * 
+ * @param jsmn_stream_parser 
+ * @return size_t 
+ */
+static size_t jsmn_stream_get_char_count(jsmn_stream_token_parser_t *jsmn_stream_parser)
+{
+	return jsmn_stream_parser->stream_parser.position;
+}
+
+/**
+ * @brief Check that a position can be stored in a token.
+ * 
+ * @param jsmn_stream_parser 
+ * @param offset 
+ * @return true if it can, false past 2 GB with jsmn_streamtok_t or past the
+ * 	offset width of the compact store.
+ */
+static bool jsmn_stream_offset_fits(jsmn_stream_token_parser_t *jsmn_stream_parser, size_t offset)
+{
+	if (jsmn_stream_parser->compact)
+	{
+		// all ones marks an undefined position
+		return (uint64_t)offset < (uint64_t)(jsmn_stream_token_offset_t)JSMN_STREAM_POSITION_UNDEFINED;
+	}
+	return offset <= INT_MAX;
+}
+
+/**
+ * @brief Set the type and start position of a token. A position that does
+ * 	not fit sets JSMN_STREAM_TOKEN_ERROR_NOMEM.
+ * 
+ * @param jsmn_stream_parser 
+ * @param id 
+ * @param type 
+ * @param start 
+ */
+static void jsmn_stream_set_token(jsmn_stream_token_parser_t *jsmn_stream_parser, int id, jsmn_streamtype_t type, size_t start)
+{
+	if (!jsmn_stream_offset_fits(jsmn_stream_parser, start))
+	{
+		jsmn_stream_parser->error = JSMN_STREAM_TOKEN_ERROR_NOMEM;
+		return;
+	}
+
+	if (jsmn_stream_parser->compact)
+	{
+		jsmn_stream_parser->store.types[id] = (uint8_t)type;
+		jsmn_stream_parser->store.starts[id] = (jsmn_stream_token_offset_t)start;
+	}
+	else
+	{
+		jsmn_stream_parser->tokens[id].type = type;
+		jsmn_stream_parser->tokens[id].start = (int)start;
+	}
+}
+
+/**
+ * @brief Set the end position of a token. A position that does not fit sets
+ * 	JSMN_STREAM_TOKEN_ERROR_NOMEM.
+ * 
+ * @param jsmn_stream_parser 
+ * @param id 
+ * @param end 
+ */
+static void jsmn_stream_set_token_end(jsmn_stream_token_parser_t *jsmn_stream_parser, int id, size_t end)
+{
+	if (!jsmn_stream_offset_fits(jsmn_stream_parser, end))
+	{
+		jsmn_stream_parser->error = JSMN_STREAM_TOKEN_ERROR_NOMEM;
+		return;
+	}
+
+	if (jsmn_stream_parser->compact)
+	{
+		jsmn_stream_parser->store.lengths[id] = (jsmn_stream_token_offset_t)(end - jsmn_stream_parser->store.starts[id]);
+	}
+	else
+	{
+		jsmn_stream_parser->tokens[id].end = (int)end;
+	}
+}
+
+/**
+ * @brief Set the size of a token.
+ * 
+ * @param jsmn_stream_parser 
+ * @param id 
+ * @param size 
+ */
+static void jsmn_stream_set_token_size(jsmn_stream_token_parser_t *jsmn_stream_parser, int id, int size)
+{
+	if (jsmn_stream_parser->compact)
+	{
+		jsmn_stream_parser->store.sizes[id] = size;
+	}
+	else
+	{
+		jsmn_stream_parser->tokens[id].size = size;
+	}
+}
+
+/**
+ * @brief Set the id past a token and its children.
+ * 
+ * @param jsmn_stream_parser 
+ * @param id 
+ * @param end_id 
+ */
+static void jsmn_stream_set_token_end_id(jsmn_stream_token_parser_t *jsmn_stream_parser, int id, int end_id)
+{
+	if (jsmn_stream_parser->compact)
+	{
+		jsmn_stream_parser->store.end_ids[id] = end_id;
+	}
+	else
+	{
+		jsmn_stream_parser->tokens[id].end_id = end_id;
+	}
+}
+
 /**
  * @brief Allocate a new token from the token pool.
  * 
  * @param jsmn_stream_parser 
- * @return jsmn_streamtok_t* 
+ * @return int the token id, or JSMN_STREAM_TOKEN_UNDEFINED.
  */
-static jsmn_streamtok_t *jsmn_stream_allocate_token(jsmn_stream_token_parser_t *jsmn_stream_parser)
+static int jsmn_stream_allocate_token(jsmn_stream_token_parser_t *jsmn_stream_parser)
 {
-	jsmn_streamtok_t *token;
+	int id;
+	int parent_id = jsmn_stream_parser->super_token_id;
 
-	// if we are out of tokens, set the error and return NULL
+	// if we are out of tokens and cannot grow, set the error and return nothing
 	if (jsmn_stream_parser->next_token >= jsmn_stream_parser->num_tokens)
 	{
-		jsmn_stream_parser->error = JSMN_STREAM_ERROR_NOMEM;
-		return NULL;
+		int num_tokens = jsmn_stream_parser->num_tokens > 0 ? jsmn_stream_parser->num_tokens : JSMN_STREAM_TOKEN_INITIAL_TOKENS;
+
+		if (num_tokens > INT_MAX / 2 || !jsmn_stream_grow_tokens(jsmn_stream_parser, num_tokens * 2))
+		{
+			jsmn_stream_parser->error = JSMN_STREAM_ERROR_NOMEM;
+			return JSMN_STREAM_TOKEN_UNDEFINED;
+		}
 	}
 
-	token = &jsmn_stream_parser->tokens[jsmn_stream_parser->next_token];
-	token->id = jsmn_stream_parser->next_token;
+	id = jsmn_stream_parser->next_token;
 	jsmn_stream_parser->next_token++;
-	token->type = JSMN_STREAM_UNDEFINED;
-	token->start = JSMN_STREAM_POSITION_UNDEFINED;
-	token->end = JSMN_STREAM_POSITION_UNDEFINED;
-	token->size = 0;
-	token->parent_id = jsmn_stream_parser->super_token_id;
+	jsmn_stream_reset_tokens(jsmn_stream_parser, id, id + 1);
+
+	if (jsmn_stream_parser->compact)
+	{
+		jsmn_stream_parser->store.parent_ids[id] = parent_id;
+	}
+	else
+	{
+		jsmn_stream_parser->tokens[id].parent_id = parent_id;
+	}
 
 	// increment the size of the super token, unless it is the root token
-	if (token->parent_id != JSMN_STREAM_TOKEN_UNDEFINED)
+	if (parent_id != JSMN_STREAM_TOKEN_UNDEFINED)
 	{
-		jsmn_streamtok_t *parent = jsmn_stream_get_super_token(jsmn_stream_parser);
-		if (parent != NULL)
-		{
-			parent->size++;
-		}
+		jsmn_stream_set_token_size(jsmn_stream_parser, parent_id, jsmn_stream_token_size(jsmn_stream_parser, parent_id) + 1);
 	}
 
-	return token;
+	return id;
 }
 
 /**
  * @brief Get the super token object or array.
  * 
  * @param jsmn_stream_parser 
- * @return jsmn_streamtok_t* 
+ * @return int the token id, or JSMN_STREAM_TOKEN_UNDEFINED.
  */
-static jsmn_streamtok_t *jsmn_stream_get_super_token(jsmn_stream_token_parser_t *jsmn_stream_parser)
+static int jsmn_stream_get_super_token(jsmn_stream_token_parser_t *jsmn_stream_parser)
 {
 	if (jsmn_stream_parser->super_token_id == JSMN_STREAM_TOKEN_UNDEFINED)
 	{
 		jsmn_stream_parser->error = JSMN_STREAM_TOKEN_ERROR_INVALID;
-		return NULL;
 	}
 
-	return &jsmn_stream_parser->tokens[jsmn_stream_parser->super_token_id];
+	return jsmn_stream_parser->super_token_id;
 }
 
 /**
- * @brief Get the object or array that is superior to the current token.
+ * @brief Close a token that is complete with its children, along with the
+ * 	keys it is the value of, and get the object or array that is superior
+ * 	to it.
  * 
  * @param jsmn_stream_parser 
- * @param token 
- * @return jsmn_streamtok_t* 
+ * @param id 
+ * @return int 
  */
-static jsmn_streamtok_t *jsmn_stream_get_super_collection_token(jsmn_stream_token_parser_t *jsmn_stream_parser, jsmn_streamtok_t *token)
+static int jsmn_stream_close_token(jsmn_stream_token_parser_t *jsmn_stream_parser, int id)
 {
-	while (token->parent_id	> JSMN_STREAM_TOKEN_UNDEFINED)
+	int parent_id;
+
+	jsmn_stream_set_token_end_id(jsmn_stream_parser, id, jsmn_stream_parser->next_token);
+
+	while ((parent_id = jsmn_stream_token_parent(jsmn_stream_parser, id)) > JSMN_STREAM_TOKEN_UNDEFINED)
 	{
-		token = &jsmn_stream_parser->tokens[token->parent_id];
-		if ((token->type == JSMN_STREAM_ARRAY) || (token->type == JSMN_STREAM_OBJECT))
+		jsmn_streamtype_t type;
+
+		id = parent_id;
+		type = jsmn_stream_token_type(jsmn_stream_parser, id);
+		if ((type == JSMN_STREAM_ARRAY) || (type == JSMN_STREAM_OBJECT))
 		{
 			break;
 		}
+
+		// a key ends with its value
+		jsmn_stream_set_token_end_id(jsmn_stream_parser, id, jsmn_stream_parser->next_token);
 	}
 
-	return token;
+	return id;
 }
 
 /**
@@ -152,14 +919,13 @@ static jsmn_streamtok_t *jsmn_stream_get_super_collection_token(jsmn_stream_toke
 static void jsmn_stream_parse_tokens_start_array(void *user_arg)
 {
 	jsmn_stream_token_parser_t *jsmn_stream_parser = (jsmn_stream_token_parser_t *)user_arg;
-	jsmn_streamtok_t *token = jsmn_stream_allocate_token(jsmn_stream_parser);
+	int id = jsmn_stream_allocate_token(jsmn_stream_parser);
 
-	if (token != NULL)
+	if (id != JSMN_STREAM_TOKEN_UNDEFINED)
 	{
-		token->type = JSMN_STREAM_ARRAY;
-		token->start = jsmn_stream_parser->char_count - 1;
+		jsmn_stream_set_token(jsmn_stream_parser, id, JSMN_STREAM_ARRAY, jsmn_stream_get_char_count(jsmn_stream_parser) - 1);
 
-		jsmn_stream_parser->super_token_id = token->id;
+		jsmn_stream_parser->super_token_id = id;
 	}
 }
 
@@ -171,13 +937,12 @@ static void jsmn_stream_parse_tokens_start_array(void *user_arg)
 static void jsmn_stream_parse_tokens_end_array(void *user_arg)
 {
 	jsmn_stream_token_parser_t *jsmn_stream_parser = (jsmn_stream_token_parser_t *)user_arg;
-	jsmn_streamtok_t *token = jsmn_stream_get_super_token(jsmn_stream_parser);
+	int id = jsmn_stream_get_super_token(jsmn_stream_parser);
 
-	if (token != NULL)
+	if (id != JSMN_STREAM_TOKEN_UNDEFINED)
 	{
-		token->end = jsmn_stream_parser->char_count;
-		token = jsmn_stream_get_super_collection_token(jsmn_stream_parser, token);
-		jsmn_stream_parser->super_token_id = token->id;
+		jsmn_stream_set_token_end(jsmn_stream_parser, id, jsmn_stream_get_char_count(jsmn_stream_parser));
+		jsmn_stream_parser->super_token_id = jsmn_stream_close_token(jsmn_stream_parser, id);
 	}
 }
 
@@ -189,14 +954,13 @@ static void jsmn_stream_parse_tokens_end_array(void *user_arg)
 static void jsmn_stream_parse_tokens_start_object(void *user_arg)
 {
 	jsmn_stream_token_parser_t *jsmn_stream_parser = (jsmn_stream_token_parser_t *)user_arg;
-	jsmn_streamtok_t *token = jsmn_stream_allocate_token(jsmn_stream_parser);
+	int id = jsmn_stream_allocate_token(jsmn_stream_parser);
 
-	if (token != NULL)
+	if (id != JSMN_STREAM_TOKEN_UNDEFINED)
 	{
-		token->type = JSMN_STREAM_OBJECT;
-		token->start = jsmn_stream_parser->char_count - 1; 
+		jsmn_stream_set_token(jsmn_stream_parser, id, JSMN_STREAM_OBJECT, jsmn_stream_get_char_count(jsmn_stream_parser) - 1);
 
-		jsmn_stream_parser->super_token_id = token->id;
+		jsmn_stream_parser->super_token_id = id;
 	}
 }
 
@@ -208,13 +972,12 @@ static void jsmn_stream_parse_tokens_start_object(void *user_arg)
 static void jsmn_stream_parse_tokens_end_object(void *user_arg)
 {
 	jsmn_stream_token_parser_t *jsmn_stream_parser = (jsmn_stream_token_parser_t *)user_arg;
-	jsmn_streamtok_t *token = jsmn_stream_get_super_token(jsmn_stream_parser);
+	int id = jsmn_stream_get_super_token(jsmn_stream_parser);
 
-	if (token != NULL)
+	if (id != JSMN_STREAM_TOKEN_UNDEFINED)
 	{
-		token->end = jsmn_stream_parser->char_count;
-		token = jsmn_stream_get_super_collection_token(jsmn_stream_parser, token);
-		jsmn_stream_parser->super_token_id = token->id;
+		jsmn_stream_set_token_end(jsmn_stream_parser, id, jsmn_stream_get_char_count(jsmn_stream_parser));
+		jsmn_stream_parser->super_token_id = jsmn_stream_close_token(jsmn_stream_parser, id);
 	}
 }
 
@@ -223,21 +986,42 @@ static void jsmn_stream_parse_tokens_end_object(void *user_arg)
  * 
  * @param key is a pointer to the key string.
  * @param key_length is the length of the key string.
+ * @param offset is the position of the key string in the JSON data string.
  * @param user_arg is a pointer to the jsmn_stream_token_parser_t object.
  */
-static void jsmn_stream_parse_tokens_object_key(const char *key, size_t key_length, void *user_arg)
+static void jsmn_stream_parse_tokens_object_key(const char *key, size_t key_length, size_t offset, void *user_arg)
 {
 	jsmn_stream_token_parser_t *jsmn_stream_parser = (jsmn_stream_token_parser_t *)user_arg;
-	jsmn_streamtok_t *token = jsmn_stream_allocate_token(jsmn_stream_parser);
 
-	if (token != NULL)
+	jsmn_stream_add_key_token(jsmn_stream_parser, offset, key_length, jsmn_stream_token_hash(JSMN_STREAM_TOKEN_HASH_SEED, key, key_length));
+}
+
+/**
+ * @brief Add a key token.
+ * 
+ * @param jsmn_stream_parser 
+ * @param offset is the position of the key string in the JSON data string.
+ * @param length is the length of the key string.
+ * @param hash is the jsmn_stream_token_hash() of the key string.
+ */
+static void jsmn_stream_add_key_token(jsmn_stream_token_parser_t *jsmn_stream_parser, size_t offset, size_t length, uint32_t hash)
+{
+	int id = jsmn_stream_allocate_token(jsmn_stream_parser);
+
+	if (id != JSMN_STREAM_TOKEN_UNDEFINED)
 	{
-		token->type = JSMN_STREAM_KEY;
-		token->start = jsmn_stream_parser->char_count - key_length - 1;
-		token->end = jsmn_stream_parser->char_count - 1;
-		token->size = 0;
+		jsmn_stream_set_token(jsmn_stream_parser, id, JSMN_STREAM_KEY, offset);
+		jsmn_stream_set_token_end(jsmn_stream_parser, id, offset + length);
+		if (jsmn_stream_parser->compact)
+		{
+			jsmn_stream_parser->store.hashes[id] = hash;
+		}
+		else
+		{
+			jsmn_stream_parser->tokens[id].hash = hash;
+		}
 
-		jsmn_stream_parser->super_token_id = token->id;
+		jsmn_stream_parser->super_token_id = id;
 	}
 }
 
@@ -246,22 +1030,20 @@ static void jsmn_stream_parse_tokens_object_key(const char *key, size_t key_leng
  * 
  * @param value is a pointer to the string.
  * @param length is the length of the string.
+ * @param offset is the position of the string in the JSON data string.
  * @param user_arg is a pointer to the jsmn_stream_token_parser_t object.
  */
-static void jsmn_stream_parse_tokens_string(const char *value, size_t length, void *user_arg)
+static void jsmn_stream_parse_tokens_string(const char *value, size_t length, size_t offset, void *user_arg)
 {
 	jsmn_stream_token_parser_t *jsmn_stream_parser = (jsmn_stream_token_parser_t *)user_arg;
-	jsmn_streamtok_t *token = jsmn_stream_allocate_token(jsmn_stream_parser);
+	int id = jsmn_stream_allocate_token(jsmn_stream_parser);
 
-	if (token != NULL)
+	if (id != JSMN_STREAM_TOKEN_UNDEFINED)
 	{
-		token->type = JSMN_STREAM_STRING;
-		token->start = jsmn_stream_parser->char_count - length - 1;
-		token->end = jsmn_stream_parser->char_count - 1;
-		token->size = 0;
+		jsmn_stream_set_token(jsmn_stream_parser, id, JSMN_STREAM_STRING, offset);
+		jsmn_stream_set_token_end(jsmn_stream_parser, id, offset + length);
 
-		token = jsmn_stream_get_super_collection_token(jsmn_stream_parser, token);
-		jsmn_stream_parser->super_token_id = token->id;
+		jsmn_stream_parser->super_token_id = jsmn_stream_close_token(jsmn_stream_parser, id);
 	}
 }
 
@@ -270,21 +1052,144 @@ static void jsmn_stream_parse_tokens_string(const char *value, size_t length, vo
  * 
  * @param value is a pointer to the primitive.
  * @param length is the length of the primitive.
+ * @param offset is the position of the primitive in the JSON data string.
+ * @param user_arg is a pointer to the jsmn_stream_token_parser_t object.
+ */
+static void jsmn_stream_parse_tokens_primitive(const char *value, size_t length, size_t offset, void *user_arg)
+{
+	jsmn_stream_token_parser_t *jsmn_stream_parser = (jsmn_stream_token_parser_t *)user_arg;
+	int id = jsmn_stream_allocate_token(jsmn_stream_parser);
+
+	if (id != JSMN_STREAM_TOKEN_UNDEFINED)
+	{
+		jsmn_stream_set_token(jsmn_stream_parser, id, JSMN_STREAM_PRIMITIVE, offset);
+		jsmn_stream_set_token_end(jsmn_stream_parser, id, offset + length);
+		jsmn_stream_set_token_size(jsmn_stream_parser, id, (int)length);
+
+		jsmn_stream_parser->super_token_id = jsmn_stream_close_token(jsmn_stream_parser, id);
+	}
+}
+
+/**
+ * @brief Callback used for pieces of an object key that does not fit in the
+ * 	stream parser buffer. The token is added once the whole key is parsed.
+ * 
+ * @param key is a pointer to the key string piece.
+ * @param key_length is the length of the key string piece.
+ * @param offset is the position of the key string in the JSON data string.
+ * @param final is set on the last piece.
  * @param user_arg is a pointer to the jsmn_stream_token_parser_t object.
  */
-static void jsmn_stream_parse_tokens_primitive(const char *value, size_t length, void *user_arg)
+static void jsmn_stream_parse_tokens_key_fragment(const char *key, size_t key_length, size_t offset, bool final, void *user_arg)
 {
 	jsmn_stream_token_parser_t *jsmn_stream_parser = (jsmn_stream_token_parser_t *)user_arg;
-	jsmn_streamtok_t *token = jsmn_stream_allocate_token(jsmn_stream_parser);
 
-	if (token != NULL)
+	jsmn_stream_parser->key_hash = jsmn_stream_token_hash(jsmn_stream_parser->key_hash, key, key_length);
+	if (final)
 	{
-		token->type = JSMN_STREAM_PRIMITIVE;
-		token->start = jsmn_stream_parser->char_count - length - 1;
-		token->end = jsmn_stream_parser->char_count - 1;
-		token->size = length;
+		// the closing quote is the current character
+		jsmn_stream_add_key_token(jsmn_stream_parser, offset, jsmn_stream_get_char_count(jsmn_stream_parser) - 1 - offset, jsmn_stream_parser->key_hash);
+		jsmn_stream_parser->key_hash = JSMN_STREAM_TOKEN_HASH_SEED;
+	}
+}
+
+/**
+ * @brief Callback used for pieces of a string that does not fit in the
+ * 	stream parser buffer. The token is added once the whole string is parsed.
+ * 
+ * @param value is a pointer to the string piece.
+ * @param length is the length of the string piece.
+ * @param offset is the position of the string in the JSON data string.
+ * @param final is set on the last piece.
+ * @param user_arg is a pointer to the jsmn_stream_token_parser_t object.
+ */
+static void jsmn_stream_parse_tokens_string_fragment(const char *value, size_t length, size_t offset, bool final, void *user_arg)
+{
+	jsmn_stream_token_parser_t *jsmn_stream_parser = (jsmn_stream_token_parser_t *)user_arg;
+
+	if (final)
+	{
+		// the closing quote is the current character
+		jsmn_stream_parse_tokens_string(value, jsmn_stream_get_char_count(jsmn_stream_parser) - 1 - offset, offset, user_arg);
+	}
+}
 
-		token = jsmn_stream_get_super_collection_token(jsmn_stream_parser, token);
-		jsmn_stream_parser->super_token_id = token->id;
+/**
+ * @brief Write a byte at offset at of a snapshot of size bytes. Bytes past
+ * 	the end are counted but not written.
+ * 
+ * @return size_t the offset past the byte.
+ */
+static size_t jsmn_stream_snapshot_put_byte(unsigned char *data, size_t size, size_t at, unsigned char value)
+{
+	if (at < size)
+	{
+		data[at] = value;
+	}
+	return at + 1;
+}
+
+/**
+ * @brief Write a value in 7 bit groups, least significant first, as
+ * 	jsmn_stream_snapshot() does.
+ * 
+ * @return size_t the offset past the value.
+ */
+static size_t jsmn_stream_snapshot_put_size(unsigned char *data, size_t size, size_t at, size_t value)
+{
+	while (value >= 0x80)
+	{
+		at = jsmn_stream_snapshot_put_byte(data, size, at, (unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	return jsmn_stream_snapshot_put_byte(data, size, at, (unsigned char)value);
+}
+
+static size_t jsmn_stream_snapshot_put_hash(unsigned char *data, size_t size, size_t at, uint32_t hash)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		at = jsmn_stream_snapshot_put_byte(data, size, at, (unsigned char)(hash >> (8 * i)));
+	}
+	return at;
+}
+
+/**
+ * @brief Read a value written by jsmn_stream_snapshot_put_size().
+ * 
+ * @return true, or false when the snapshot ends or the value does not fit
+ * 	a size_t.
+ */
+static bool jsmn_stream_snapshot_get_size(const unsigned char *data, size_t size, size_t *at, size_t *value)
+{
+	*value = 0;
+	for (unsigned shift = 0; *at < size && shift < sizeof(size_t) * 8; shift += 7)
+	{
+		size_t bits = data[*at] & 0x7F;
+
+		if (bits > (SIZE_MAX >> shift))
+		{
+			return false;
+		}
+		*value |= bits << shift;
+		if ((data[(*at)++] & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool jsmn_stream_snapshot_get_hash(const unsigned char *data, size_t size, size_t *at, uint32_t *hash)
+{
+	if (size - *at < 4)
+	{
+		return false;
+	}
+	*hash = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		*hash |= (uint32_t)data[(*at)++] << (8 * i);
 	}
+	return true;
 }
@@ -29,24 +29,107 @@ typedef struct jsmn_streamtok {
   int end; // end position in the JSON data string
   int size; // number of child (nested) tokens
   int parent_id; // parent token id in the JSON data string
+  int end_id; // id past the token and its children, so the next sibling if any
+  uint32_t hash; // hash of a key, see jsmn_stream_token_hash()
 } jsmn_streamtok_t;
 
+/* Width of the offsets of the compact token store: 32 for documents up to
+ * 4 GB, 64 beyond that. jsmn_stream_token_get_char_cb_t takes a 32 bit index,
+ * so past 4 GB the token utils read tokens from parser->text only, and return
+ * JSMN_STREAM_TOKEN_UTILS_ERROR_INVALID through the callback */
+#ifndef JSMN_STREAM_TOKEN_OFFSET_BITS
+#define JSMN_STREAM_TOKEN_OFFSET_BITS 32
+#endif
+
+#if JSMN_STREAM_TOKEN_OFFSET_BITS == 64
+typedef uint64_t jsmn_stream_token_offset_t;
+#else
+typedef uint32_t jsmn_stream_token_offset_t;
+#endif
+
+/**
+ * @brief Compact token store: one array per field, indexed by token id.
+ * 	A token takes 25 bytes with 32 bit offsets and 33 bytes with 64 bit
+ * 	offsets, against 32 bytes for jsmn_streamtok_t whose int offsets stop
+ * 	at 2 GB. The end of a token is stored as its length from the start.
+ *
+ */
+typedef struct {
+  uint8_t *types; // jsmn_streamtype_t
+  jsmn_stream_token_offset_t *starts;
+  jsmn_stream_token_offset_t *lengths; // end - start
+  int32_t *sizes;
+  int32_t *parent_ids;
+  int32_t *end_ids;
+  uint32_t *hashes;
+} jsmn_stream_token_store_t;
+
+/* First bytes of a jsmn_stream_token_snapshot(), then the version */
+#define JSMN_STREAM_TOKEN_SNAPSHOT_MAGIC "jst"
+#define JSMN_STREAM_TOKEN_SNAPSHOT_VERSION 1
+
+/* Start value of jsmn_stream_token_hash(), the 32 bit FNV-1a offset basis */
+#define JSMN_STREAM_TOKEN_HASH_SEED 2166136261u
+
 typedef int32_t (*jsmn_stream_token_get_char_cb_t)(uint32_t index, size_t length, void *user_arg, char *ch);
 
+/* Number of tokens a growable pool starts with when asked for none */
+#ifndef JSMN_STREAM_TOKEN_INITIAL_TOKENS
+#define JSMN_STREAM_TOKEN_INITIAL_TOKENS 16
+#endif
+
+/**
+ * @brief Memory hooks of a growable token pool, with the semantics of
+ * 	malloc, realloc and free. user_arg is passed to each of them.
+ *
+ */
+typedef struct {
+  void *(*malloc)(size_t size, void *user_arg);
+  void *(*realloc)(void *ptr, size_t size, void *user_arg);
+  void (*free)(void *ptr, void *user_arg);
+  void *user_arg;
+} jsmn_stream_token_allocator_t;
+
 typedef struct {
   jsmn_stream_parser stream_parser;
-  jsmn_streamtok_t *tokens;
+#if !JSMN_STREAM_DEFAULT_STORAGE
+  char stream_buffer[JSMN_STREAM_BUFFER_SIZE];
+  jsmn_stream_stack_t stream_type_stack[JSMN_STREAM_STACK_WORDS(JSMN_STREAM_MAX_DEPTH)];
+#endif
+  jsmn_streamtok_t *tokens; // NULL with the compact store
+  jsmn_stream_token_store_t store;
+  bool compact; // tokens are kept in store instead of tokens
+  const jsmn_stream_token_allocator_t *allocator; // NULL for a fixed array of tokens
   int next_token;
   int num_tokens;
-  int char_count;
+  size_t char_count;
   int super_token_id;
+  uint32_t key_hash; // hash of the pieces of a long key so far
   int error;
   jsmn_stream_token_get_char_cb_t cb;
   void *user_arg;
+  const char *text; // whole JSON text in memory, e.g. a mapped file, read by the utils instead of cb. May be NULL
 } jsmn_stream_token_parser_t;
 
 void jsmn_stream_parse_tokens_init(jsmn_stream_token_parser_t *jsmn_stream_token_parser, jsmn_streamtok_t *tokens, int num_tokens);
+int jsmn_stream_parse_tokens_init_growable(jsmn_stream_token_parser_t *jsmn_stream_token_parser, const jsmn_stream_token_allocator_t *allocator, int num_tokens);
+void jsmn_stream_parse_tokens_init_compact(jsmn_stream_token_parser_t *jsmn_stream_token_parser, const jsmn_stream_token_store_t *store, int num_tokens);
+int jsmn_stream_parse_tokens_init_compact_growable(jsmn_stream_token_parser_t *jsmn_stream_token_parser, const jsmn_stream_token_allocator_t *allocator, int num_tokens);
+void jsmn_stream_parse_tokens_free(jsmn_stream_token_parser_t *jsmn_stream_token_parser);
 int jsmn_stream_parse_tokens(jsmn_stream_token_parser_t *parser, char c);
+int jsmn_stream_parse_tokens_buffer(jsmn_stream_token_parser_t *parser, const char *data, size_t length, size_t *consumed);
+
+jsmn_streamtype_t jsmn_stream_token_type(const jsmn_stream_token_parser_t *parser, int id);
+size_t jsmn_stream_token_start(const jsmn_stream_token_parser_t *parser, int id);
+size_t jsmn_stream_token_end(const jsmn_stream_token_parser_t *parser, int id);
+int jsmn_stream_token_size(const jsmn_stream_token_parser_t *parser, int id);
+int jsmn_stream_token_parent(const jsmn_stream_token_parser_t *parser, int id);
+int jsmn_stream_token_end_id(const jsmn_stream_token_parser_t *parser, int id);
+int jsmn_stream_token_next_child(const jsmn_stream_token_parser_t *parser, int parent_id, int child_id);
+uint32_t jsmn_stream_token_key_hash(const jsmn_stream_token_parser_t *parser, int id);
+uint32_t jsmn_stream_token_hash(uint32_t hash, const char *data, size_t length);
+int jsmn_stream_token_snapshot(const jsmn_stream_token_parser_t *parser, void *data, size_t size, size_t *written);
+int jsmn_stream_token_restore(jsmn_stream_token_parser_t *parser, const void *data, size_t size);
 
 #ifdef __cplusplus
 }
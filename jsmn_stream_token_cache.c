@@ -0,0 +1,150 @@
+#include "jsmn_stream_token_cache.h"
+#include "jsmn_stream_token_utils.h"
+#include <string.h>
+
+/**
+ * @brief Initialize the jsmn_stream_token_cache_t object with caller
+ * 	provided RAM. A small number of pages is expected, a page is looked
+ * 	up by going through all of them.
+ *
+ * @param cache
+ * @param cb get char callback of the backing store.
+ * @param user_arg passed to cb.
+ * @param length characters in the source.
+ * @param pages array of num_pages pages.
+ * @param data array of num_pages * page_size characters.
+ * @param page_size characters read from the backing store at a time.
+ * @param num_pages
+ * @return int32_t JSMN_STREAM_TOKEN_ERROR_NONE, or
+ * 	JSMN_STREAM_TOKEN_ERROR_INVALID when the source is longer than the
+ * 	32 bit index of the get char callback reaches. The cache is left
+ * 	uninitialized then.
+ */
+int32_t jsmn_stream_token_cache_init(jsmn_stream_token_cache_t *cache, jsmn_stream_token_get_char_cb_t cb, void *user_arg, size_t length,
+	jsmn_stream_token_cache_page_t *pages, char *data, size_t page_size, size_t num_pages)
+{
+	if ((uint64_t)length > UINT32_MAX)
+	{
+		return JSMN_STREAM_TOKEN_ERROR_INVALID;
+	}
+
+	cache->cb = cb;
+	cache->user_arg = user_arg;
+	cache->length = length;
+	cache->pages = pages;
+	cache->data = data;
+	cache->page_size = page_size;
+	cache->num_pages = num_pages;
+	cache->hits = 0;
+	cache->misses = 0;
+
+	jsmn_stream_token_cache_invalidate(cache);
+	return JSMN_STREAM_TOKEN_ERROR_NONE;
+}
+
+/**
+ * @brief Forget the cached pages, for when the source has changed.
+ * 	The counters are kept.
+ *
+ * @param cache
+ */
+void jsmn_stream_token_cache_invalidate(jsmn_stream_token_cache_t *cache)
+{
+	cache->uses = 0;
+	for (size_t i = 0; i < cache->num_pages; i++)
+	{
+		cache->pages[i].page = JSMN_STREAM_TOKEN_CACHE_PAGE_EMPTY;
+		cache->pages[i].last_use = 0;
+	}
+}
+
+/**
+ * @brief Find a page in the cache, or read it in place of the least
+ * 	recently used one.
+ *
+ * @param cache
+ * @param page page number in the source.
+ * @return char* the characters of the page, or NULL when the backing store
+ * 	failed.
+ */
+static char *jsmn_stream_token_cache_get_page(jsmn_stream_token_cache_t *cache, uint32_t page)
+{
+	size_t victim = 0;
+	uint32_t victim_age = 0;
+	size_t start = (size_t)page * cache->page_size;
+	size_t page_length = cache->length - start < cache->page_size ? cache->length - start : cache->page_size;
+
+	cache->uses++;
+	for (size_t i = 0; i < cache->num_pages; i++)
+	{
+		jsmn_stream_token_cache_page_t *slot = &cache->pages[i];
+		// the age survives the use count wrapping around
+		uint32_t age = cache->uses - slot->last_use;
+
+		if (slot->page == page)
+		{
+			slot->last_use = cache->uses;
+			cache->hits++;
+			return cache->data + i * cache->page_size;
+		}
+		if (slot->page == JSMN_STREAM_TOKEN_CACHE_PAGE_EMPTY)
+		{
+			age = UINT32_MAX;
+		}
+		if (age > victim_age)
+		{
+			victim = i;
+			victim_age = age;
+		}
+	}
+
+	cache->misses++;
+	if (cache->cb((uint32_t)start, page_length, cache->user_arg, cache->data + victim * cache->page_size) != JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE)
+	{
+		cache->pages[victim].page = JSMN_STREAM_TOKEN_CACHE_PAGE_EMPTY;
+		return NULL;
+	}
+	cache->pages[victim].page = page;
+	cache->pages[victim].last_use = cache->uses;
+	return cache->data + victim * cache->page_size;
+}
+
+/**
+ * @brief Get char callback that reads through the cache.
+ * 	Reads bigger than the whole cache, or past the length of the source,
+ * 	go straight to the backing store.
+ *
+ * @param index position of the first character in the source.
+ * @param length
+ * @param user_arg is a pointer to the jsmn_stream_token_cache_t object.
+ * @param ch receives the characters.
+ * @return int32_t a jsmn_stream_token_get_char_cb_error.
+ */
+int32_t jsmn_stream_token_cache_get_char(uint32_t index, size_t length, void *user_arg, char *ch)
+{
+	jsmn_stream_token_cache_t *cache = (jsmn_stream_token_cache_t *)user_arg;
+	size_t position = index;
+	size_t end = position + length;
+
+	if (length > cache->page_size * cache->num_pages || end > cache->length)
+	{
+		return cache->cb(index, length, cache->user_arg, ch);
+	}
+
+	while (position < end)
+	{
+		size_t offset = position % cache->page_size;
+		size_t count = cache->page_size - offset < end - position ? cache->page_size - offset : end - position;
+		const char *data = jsmn_stream_token_cache_get_page(cache, (uint32_t)(position / cache->page_size));
+
+		if (data == NULL)
+		{
+			return JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_FAIL;
+		}
+		memcpy(ch, data + offset, count);
+		ch += count;
+		position += count;
+	}
+
+	return JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE;
+}
@@ -0,0 +1,52 @@
+#ifndef __JSMN_STREAM_TOKEN_CACHE_H_
+#define __JSMN_STREAM_TOKEN_CACHE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "jsmn_stream_token.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSMN_STREAM_TOKEN_CACHE_PAGE_EMPTY UINT32_MAX
+
+/**
+ * @brief Page of the cache.
+ *
+ */
+typedef struct {
+  uint32_t page; // page number in the source, JSMN_STREAM_TOKEN_CACHE_PAGE_EMPTY when unused
+  uint32_t last_use; // use count of the cache at the last hit, for LRU
+} jsmn_stream_token_cache_page_t;
+
+/**
+ * @brief Read-through LRU page cache in front of a get char callback.
+ * 	jsmn_stream_token_cache_get_char() is a get char callback itself, so
+ * 	it goes in parser->cb with the cache as parser->user_arg, and the
+ * 	utils read neighbouring tokens from RAM.
+ *
+ */
+typedef struct {
+  jsmn_stream_token_get_char_cb_t cb; // backing store
+  void *user_arg; // of the backing store
+  size_t length; // characters in the source, pages do not read past it
+  jsmn_stream_token_cache_page_t *pages;
+  char *data; // num_pages * page_size characters
+  size_t page_size;
+  size_t num_pages;
+  uint32_t uses;
+  uint32_t hits; // pages found in the cache
+  uint32_t misses; // pages read from the backing store
+} jsmn_stream_token_cache_t;
+
+int32_t jsmn_stream_token_cache_init(jsmn_stream_token_cache_t *cache, jsmn_stream_token_get_char_cb_t cb, void *user_arg, size_t length,
+	jsmn_stream_token_cache_page_t *pages, char *data, size_t page_size, size_t num_pages);
+void jsmn_stream_token_cache_invalidate(jsmn_stream_token_cache_t *cache);
+int32_t jsmn_stream_token_cache_get_char(uint32_t index, size_t length, void *user_arg, char *ch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSMN_STREAM_TOKEN_CACHE_H_ */
@@ -0,0 +1,133 @@
+// posix_madvise() and the rest of the mapping calls are POSIX, not ISO C
+#define _POSIX_C_SOURCE 200112L
+
+#include "jsmn_stream_token_mmap.h"
+
+#if JSMN_STREAM_TOKEN_MMAP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Map a file read-only. The file descriptor is closed right away,
+ * 	the mapping holds on to the file.
+ *
+ * @param map
+ * @param path
+ * @return int JSMN_STREAM_TOKEN_MMAP_ERROR_NONE, or a
+ * 	jsmn_stream_token_mmap_error with errno set.
+ */
+int jsmn_stream_token_mmap_open(jsmn_stream_token_mmap_t *map, const char *path)
+{
+	struct stat st;
+	void *data;
+	int fd;
+
+	map->data = NULL;
+	map->length = 0;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return JSMN_STREAM_TOKEN_MMAP_ERROR_OPEN;
+	}
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return JSMN_STREAM_TOKEN_MMAP_ERROR_OPEN;
+	}
+
+	// an empty file cannot be mapped, there is nothing to parse either
+	if (st.st_size == 0)
+	{
+		close(fd);
+		map->data = "";
+		return JSMN_STREAM_TOKEN_MMAP_ERROR_NONE;
+	}
+
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		return JSMN_STREAM_TOKEN_MMAP_ERROR_MAP;
+	}
+
+	map->data = (const char *)data;
+	map->length = (size_t)st.st_size;
+	return JSMN_STREAM_TOKEN_MMAP_ERROR_NONE;
+}
+
+/**
+ * @brief Unmap the file. Token parsers that use it as their text must not
+ * 	be queried afterwards.
+ *
+ * @param map
+ */
+void jsmn_stream_token_mmap_close(jsmn_stream_token_mmap_t *map)
+{
+	if (map->length > 0)
+	{
+		munmap((void *)map->data, map->length);
+	}
+	map->data = NULL;
+	map->length = 0;
+}
+
+/**
+ * @brief Tokenize the whole mapped file in one pass and make it the text of
+ * 	the parser, for the zero-copy utils accessors.
+ * 	The kernel is told to read ahead while tokenizing, and to go back to
+ * 	its default paging for the lookups that follow.
+ *
+ * @param parser initialized token parser.
+ * @param map open mapping. Referenced, so it must outlive the queries.
+ * @return int JSMN_STREAM_TOKEN_ERROR_NONE, or a jsmn_stream_token_error.
+ * 	JSMN_STREAM_TOKEN_ERROR_INVALID for malformed JSON, for a file
+ * 	that ends inside the document, or for one without a document.
+ */
+int jsmn_stream_token_mmap_parse(jsmn_stream_token_parser_t *parser, const jsmn_stream_token_mmap_t *map)
+{
+	const jsmn_stream_parser *stream_parser = &parser->stream_parser;
+	size_t consumed = 0;
+	int error;
+
+	parser->text = map->data;
+	if (map->length > 0)
+	{
+		// only advice, the parse goes on when it is not taken
+		posix_madvise((void *)map->data, map->length, POSIX_MADV_SEQUENTIAL);
+		error = jsmn_stream_parse_tokens_buffer(parser, map->data, map->length, &consumed);
+		posix_madvise((void *)map->data, map->length, POSIX_MADV_NORMAL);
+	}
+	else
+	{
+		error = parser->error;
+	}
+
+	// a number or literal as the whole document ends with the file
+	if ((error == JSMN_STREAM_TOKEN_ERROR_NONE)
+		&& (stream_parser->state == JSMN_STREAM_PARSING_PRIMITIVE)
+		&& (stream_parser->stack_height == 0))
+	{
+		error = jsmn_stream_parse_tokens(parser, ' ');
+		parser->char_count = map->length;
+	}
+	if (error != JSMN_STREAM_TOKEN_ERROR_NONE)
+	{
+		return error;
+	}
+
+	// an empty or blank file has no document
+	if ((consumed != map->length)
+		|| (stream_parser->state != JSMN_STREAM_PARSING)
+		|| (stream_parser->stack_height != 0)
+		|| (parser->next_token == 0))
+	{
+		parser->error = JSMN_STREAM_TOKEN_ERROR_INVALID;
+	}
+	return parser->error;
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef __JSMN_STREAM_TOKEN_MMAP_H_
+#define __JSMN_STREAM_TOKEN_MMAP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "jsmn_stream_token.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Memory-mapped files need POSIX mmap(), off by default elsewhere */
+#ifndef JSMN_STREAM_TOKEN_MMAP
+#if defined(__unix__) || defined(__APPLE__)
+#define JSMN_STREAM_TOKEN_MMAP 1
+#else
+#define JSMN_STREAM_TOKEN_MMAP 0
+#endif
+#endif
+
+enum jsmn_stream_token_mmap_error {
+  JSMN_STREAM_TOKEN_MMAP_ERROR_NONE = 0,
+  JSMN_STREAM_TOKEN_MMAP_ERROR_OPEN = -10, // apart from the jsmn_stream_token_error values
+  JSMN_STREAM_TOKEN_MMAP_ERROR_MAP = -11,
+};
+
+/**
+ * @brief JSON file mapped read-only in memory. The mapping is the text of
+ * 	the token parser, so the utils read tokens from it directly.
+ *
+ */
+typedef struct {
+  const char *data; // the file, not NUL-terminated
+  size_t length;
+} jsmn_stream_token_mmap_t;
+
+#if JSMN_STREAM_TOKEN_MMAP
+int jsmn_stream_token_mmap_open(jsmn_stream_token_mmap_t *map, const char *path);
+void jsmn_stream_token_mmap_close(jsmn_stream_token_mmap_t *map);
+int jsmn_stream_token_mmap_parse(jsmn_stream_token_parser_t *parser, const jsmn_stream_token_mmap_t *map);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSMN_STREAM_TOKEN_MMAP_H_ */
@@ -1,25 +1,48 @@
 #include "jsmn_stream_token_utils.h"
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 static bool string_compare(const char *str1, const char *str2, size_t length);
+static int32_t read_token(jsmn_stream_token_parser_t *parser, size_t start, size_t length, char *buffer);
+static bool token_readable(jsmn_stream_token_parser_t *parser, size_t start, size_t length);
 
 int32_t jsmn_stream_token_utils_parse_with_cb(jsmn_stream_token_parser_t *parser, size_t length, void *user_arg)
 {
-    if (parser == NULL)
+    char block[JSMN_STREAM_TOKEN_UTILS_BLOCK_SIZE];
+
+    return jsmn_stream_token_utils_parse_with_cb_blocks(parser, length, user_arg, block, sizeof(block));
+}
+
+/**
+ * @brief Read length characters through the callback, block_size at a time,
+ * 	and parse each block in one go. The callback takes a 32 bit index, so
+ * 	length is at most 4 GB.
+ * 
+ * @return JSMN_STREAM_TOKEN_ERROR_NONE, a jsmn_stream_token_error, or
+ * 	JSMN_STREAM_TOKEN_UTILS_ERROR_READ when the callback fails.
+ */
+int32_t jsmn_stream_token_utils_parse_with_cb_blocks(jsmn_stream_token_parser_t *parser, size_t length, void *user_arg, char *block, size_t block_size)
+{
+    if ((parser == NULL)
+        || (block == NULL)
+        || (block_size == 0)
+        || ((uint64_t)length > UINT32_MAX))
     {
         return JSMN_STREAM_TOKEN_ERROR_INVALID;
     }
 
-    for (uint32_t i = 0U; i < (uint32_t)length; i++)
+    for (size_t i = 0U; i < length; i += block_size)
     {
-        char ch;
-        if (parser->cb(i, 1, user_arg, &ch) == JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE)
+        size_t block_length = (length - i < block_size) ? length - i : block_size;
+
+        if (parser->cb((uint32_t)i, block_length, user_arg, block) != JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE)
         {
-            if (jsmn_stream_parse_tokens(parser, ch) != JSMN_STREAM_TOKEN_ERROR_NONE)
-            {
-                return parser->error;
-            }
+            return JSMN_STREAM_TOKEN_UTILS_ERROR_READ;
+        }
+        if (jsmn_stream_parse_tokens_buffer(parser, block, block_length, NULL) != JSMN_STREAM_TOKEN_ERROR_NONE)
+        {
+            return parser->error;
         }
     }
     return JSMN_STREAM_TOKEN_ERROR_NONE;
@@ -27,26 +50,44 @@ int32_t jsmn_stream_token_utils_parse_with_cb(jsmn_stream_token_parser_t *parser
 
 int32_t jsmn_stream_token_utils_array_get_next_object_token(jsmn_stream_token_parser_t *parser, jsmn_streamtok_t *array_token, jsmn_streamtok_t **iterator_token)
 {
-    jsmn_streamtok_t *token;
-    if (array_token == NULL)
+    int iterator_id = JSMN_STREAM_TOKEN_UNDEFINED;
+    int32_t result;
+    if ((parser == NULL)
+        || (array_token == NULL)
+        || (iterator_token == NULL))
     {
         return JSMN_STREAM_TOKEN_ERROR_INVALID;
     }
 
-    if (*iterator_token == NULL)
+    if (*iterator_token != NULL)
+    {
+        iterator_id = (int)(*iterator_token - parser->tokens);
+    }
+
+    result = jsmn_stream_token_utils_array_get_next_object_id(parser, (int)(array_token - parser->tokens), &iterator_id);
+    if (result == JSMN_STREAM_TOKEN_ERROR_NONE)
+    {
+        *iterator_token = parser->tokens + iterator_id;
+    }
+    return result;
+}
+
+int32_t jsmn_stream_token_utils_array_get_next_object_id(jsmn_stream_token_parser_t *parser, int array_id, int *iterator_id)
+{
+    if ((parser == NULL)
+        || (array_id < 0)
+        || (iterator_id == NULL))
     {
-        *iterator_token = array_token;
+        return JSMN_STREAM_TOKEN_ERROR_INVALID;
     }
 
-    token = *iterator_token;
+    int id = *iterator_id;
 
-    while (token->id < parser->num_tokens)
+    while ((id = jsmn_stream_token_next_child(parser, array_id, id)) != JSMN_STREAM_TOKEN_UNDEFINED)
     {
-        token++;
-        if ((token->type == JSMN_STREAM_OBJECT)
-            && (token->parent_id == array_token->id))
+        if (jsmn_stream_token_type(parser, id) == JSMN_STREAM_OBJECT)
         {
-            *iterator_token = token;
+            *iterator_id = id;
             return JSMN_STREAM_TOKEN_ERROR_NONE;
         }
     }
@@ -56,6 +97,8 @@ int32_t jsmn_stream_token_utils_array_get_next_object_token(jsmn_stream_token_pa
 
 int32_t jsmn_stream_token_utils_get_value_token_by_key(jsmn_stream_token_parser_t *parser, jsmn_streamtok_t *parent, const char *key, jsmn_streamtok_t **value_token)
 {
+    int value_id;
+    int32_t result;
     if ((parser == NULL) 
         || (parent == NULL) 
         || (key == NULL)
@@ -64,21 +107,57 @@ int32_t jsmn_stream_token_utils_get_value_token_by_key(jsmn_stream_token_parser_
         return JSMN_STREAM_TOKEN_ERROR_INVALID;
     }
 
-    for (uint32_t i = parent->id; i < parser->num_tokens; i++)
+    result = jsmn_stream_token_utils_get_value_id_by_key(parser, (int)(parent - parser->tokens), key, &value_id);
+    if (result == JSMN_STREAM_TOKEN_ERROR_NONE)
+    {
+        *value_token = parser->tokens + value_id;
+    }
+    return result;
+}
+
+int32_t jsmn_stream_token_utils_get_value_id_by_key(jsmn_stream_token_parser_t *parser, int parent_id, const char *key, int *value_id)
+{
+    if ((parser == NULL) 
+        || (parent_id < 0) 
+        || (key == NULL)
+        || (value_id == NULL))
     {
-        jsmn_streamtok_t *token = parser->tokens + i;
+        return JSMN_STREAM_TOKEN_ERROR_INVALID;
+    }
 
-        if (token->type == JSMN_STREAM_KEY)
-		{
-            size_t string_length = (size_t)(token->end - token->start);
-            char buffer[string_length];
+    size_t key_length = strlen(key);
+    uint32_t key_hash = jsmn_stream_token_hash(JSMN_STREAM_TOKEN_HASH_SEED, key, key_length);
 
-            if (parser->cb(token->start, string_length, parser->user_arg, buffer) == JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE)
+    for (int i = jsmn_stream_token_next_child(parser, parent_id, JSMN_STREAM_TOKEN_UNDEFINED);
+        i != JSMN_STREAM_TOKEN_UNDEFINED;
+        i = jsmn_stream_token_next_child(parser, parent_id, i))
+    {
+        if (jsmn_stream_token_type(parser, i) == JSMN_STREAM_KEY)
+        {
+            size_t start = jsmn_stream_token_start(parser, i);
+            size_t string_length = jsmn_stream_token_end(parser, i) - start;
+
+            // the characters are only read to confirm a matching hash
+            if ((string_length == key_length)
+                && (jsmn_stream_token_key_hash(parser, i) == key_hash))
             {
-                if (string_compare(buffer, key, string_length) == true)
+                if (token_readable(parser, start, string_length) == false)
+                {
+                    return JSMN_STREAM_TOKEN_UTILS_ERROR_INVALID;
+                }
+
+                char buffer[string_length + 1];
+                // a text in memory is compared in place
+                const char *string = (parser->text != NULL) ? parser->text + start : buffer;
+
+                if ((parser->text != NULL)
+                    || (parser->cb((uint32_t)start, string_length, parser->user_arg, buffer) == JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE))
                 {
-                    *value_token = token + 1;
-                    return JSMN_STREAM_TOKEN_ERROR_NONE;
+                    if (string_compare(string, key, string_length) == true)
+                    {
+                        *value_id = i + 1;
+                        return JSMN_STREAM_TOKEN_ERROR_NONE;
+                    }
                 }
             }
         }
@@ -100,6 +179,32 @@ static bool string_compare(const char *str1, const char *str2, size_t length)
     return true;
 }
 
+/**
+ * @brief Copy the characters of a token, from the text in memory when the
+ * 	parser has one, through the get char callback otherwise.
+ */
+static int32_t read_token(jsmn_stream_token_parser_t *parser, size_t start, size_t length, char *buffer)
+{
+    if (parser->text != NULL)
+    {
+        memcpy(buffer, parser->text + start, length);
+        return JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE;
+    }
+
+    return parser->cb((uint32_t)start, length, parser->user_arg, buffer);
+}
+
+/**
+ * @brief Whether the characters of a token can be read. The get char
+ * 	callback takes a 32 bit index, so through it a token must end by 4 GB.
+ * 	A text in memory has no such limit.
+ */
+static bool token_readable(jsmn_stream_token_parser_t *parser, size_t start, size_t length)
+{
+    return (parser->text != NULL)
+        || (((uint64_t)start <= UINT32_MAX) && ((uint64_t)length <= UINT32_MAX - (uint64_t)start));
+}
+
 int32_t jsmn_stream_token_utils_get_string_from_token(jsmn_stream_token_parser_t *parser, jsmn_streamtok_t *token, char *buffer)
 {
     if ((parser == NULL) 
@@ -109,8 +214,25 @@ int32_t jsmn_stream_token_utils_get_string_from_token(jsmn_stream_token_parser_t
         return JSMN_STREAM_TOKEN_ERROR_INVALID;
     }
 
-    size_t string_length = (size_t)(token->end - token->start);
-    return parser->cb(token->start, string_length, parser->user_arg, buffer);
+    return jsmn_stream_token_utils_get_string_from_id(parser, (int)(token - parser->tokens), buffer);
+}
+
+int32_t jsmn_stream_token_utils_get_string_from_id(jsmn_stream_token_parser_t *parser, int id, char *buffer)
+{
+    if ((parser == NULL) 
+        || (id < 0) 
+        || (buffer == NULL))
+    {
+        return JSMN_STREAM_TOKEN_ERROR_INVALID;
+    }
+
+    size_t start = jsmn_stream_token_start(parser, id);
+    size_t string_length = jsmn_stream_token_end(parser, id) - start;
+    if (token_readable(parser, start, string_length) == false)
+    {
+        return JSMN_STREAM_TOKEN_UTILS_ERROR_INVALID;
+    }
+    return read_token(parser, start, string_length, buffer);
 }
 
 int32_t jsmn_stream_token_utils_get_string_by_key(jsmn_stream_token_parser_t *parser, jsmn_streamtok_t *parent, const char *key, char *buffer)
@@ -140,10 +262,27 @@ int32_t jsmn_stream_token_utils_get_int_from_token(jsmn_stream_token_parser_t *p
         return JSMN_STREAM_TOKEN_ERROR_INVALID;
     }
 
-    size_t string_length = (size_t)(token->end - token->start);
-    char buffer[string_length];
-    if (parser->cb(token->start, string_length, parser->user_arg, buffer) == JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE)
+    return jsmn_stream_token_utils_get_int_from_id(parser, (int)(token - parser->tokens), value);
+}
+
+int32_t jsmn_stream_token_utils_get_int_from_id(jsmn_stream_token_parser_t *parser, int id, int32_t *value)
+{
+    if ((parser == NULL) 
+        || (id < 0))
+    {
+        return JSMN_STREAM_TOKEN_ERROR_INVALID;
+    }
+
+    size_t start = jsmn_stream_token_start(parser, id);
+    size_t string_length = jsmn_stream_token_end(parser, id) - start;
+    if (token_readable(parser, start, string_length) == false)
     {
+        return JSMN_STREAM_TOKEN_UTILS_ERROR_INVALID;
+    }
+    char buffer[string_length + 1];
+    if (read_token(parser, start, string_length, buffer) == JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE)
+    {
+        buffer[string_length] = '\0';
         *value = strtol(buffer, NULL, 10);
         return JSMN_STREAM_TOKEN_ERROR_NONE;
     }
@@ -178,15 +317,32 @@ int32_t jsmn_stream_token_utils_get_double_from_token(jsmn_stream_token_parser_t
             return JSMN_STREAM_TOKEN_ERROR_INVALID;
         }
     
-        size_t string_length = (size_t)(token->end - token->start);
-        char buffer[string_length];
-        if (parser->cb(token->start, string_length, parser->user_arg, buffer) == JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE)
-        {
-            *value = strtod(buffer, NULL);
-            return JSMN_STREAM_TOKEN_ERROR_NONE;
-        }
-    
-        return JSMN_STREAM_TOKEN_UTILS_ERROR_FAIL;
+        return jsmn_stream_token_utils_get_double_from_id(parser, (int)(token - parser->tokens), value);
+}
+
+int32_t jsmn_stream_token_utils_get_double_from_id(jsmn_stream_token_parser_t *parser, int id, double *value)
+{
+    if ((parser == NULL) 
+        || (id < 0))
+    {
+        return JSMN_STREAM_TOKEN_ERROR_INVALID;
+    }
+
+    size_t start = jsmn_stream_token_start(parser, id);
+    size_t string_length = jsmn_stream_token_end(parser, id) - start;
+    if (token_readable(parser, start, string_length) == false)
+    {
+        return JSMN_STREAM_TOKEN_UTILS_ERROR_INVALID;
+    }
+    char buffer[string_length + 1];
+    if (read_token(parser, start, string_length, buffer) == JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE)
+    {
+        buffer[string_length] = '\0';
+        *value = strtod(buffer, NULL);
+        return JSMN_STREAM_TOKEN_ERROR_NONE;
+    }
+
+    return JSMN_STREAM_TOKEN_UTILS_ERROR_FAIL;
 }
 
 int32_t jsmn_stream_token_utils_get_double_by_key(jsmn_stream_token_parser_t *parser, jsmn_streamtok_t *parent, const char *key, double *value)
@@ -216,16 +372,33 @@ int32_t jsmn_stream_token_utils_get_bool_from_token(jsmn_stream_token_parser_t *
         return JSMN_STREAM_TOKEN_ERROR_INVALID;
     }
 
-    size_t string_length = (size_t)(token->end - token->start);
-    char buffer[string_length];
-    if (parser->cb(token->start, string_length, parser->user_arg, buffer) == JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE)
+    return jsmn_stream_token_utils_get_bool_from_id(parser, (int)(token - parser->tokens), value);
+}
+
+int32_t jsmn_stream_token_utils_get_bool_from_id(jsmn_stream_token_parser_t *parser, int id, bool *value)
+{
+    if ((parser == NULL) 
+        || (id < 0))
+    {
+        return JSMN_STREAM_TOKEN_ERROR_INVALID;
+    }
+
+    size_t start = jsmn_stream_token_start(parser, id);
+    size_t string_length = jsmn_stream_token_end(parser, id) - start;
+    if (token_readable(parser, start, string_length) == false)
+    {
+        return JSMN_STREAM_TOKEN_UTILS_ERROR_INVALID;
+    }
+    char buffer[string_length + 1];
+    if (read_token(parser, start, string_length, buffer) == JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE)
     {
-        if (string_compare(buffer, "true", string_length) == true)
+        buffer[string_length] = '\0';
+        if (strcmp(buffer, "true") == 0)
         {
             *value = true;
             return JSMN_STREAM_TOKEN_ERROR_NONE;
         }
-        else if (string_compare(buffer, "false", string_length) == true)
+        else if (strcmp(buffer, "false") == 0)
         {
             *value = false;
             return JSMN_STREAM_TOKEN_ERROR_NONE;
@@ -253,3 +426,48 @@ int32_t jsmn_stream_token_utils_get_bool_by_key(jsmn_stream_token_parser_t *pars
 
     return JSMN_STREAM_TOKEN_UTILS_ERROR_KEY_NOT_FOUND;
 }
+
+/**
+ * @brief Point at the characters of a token in the text of the parser,
+ * 	without copying them. The characters are not NUL-terminated.
+ * 
+ * @return JSMN_STREAM_TOKEN_ERROR_NONE, or JSMN_STREAM_TOKEN_ERROR_INVALID
+ * 	when the parser has no text in memory.
+ */
+int32_t jsmn_stream_token_utils_get_span_from_id(jsmn_stream_token_parser_t *parser, int id, const char **value, size_t *length)
+{
+    if ((parser == NULL)
+        || (parser->text == NULL)
+        || (id < 0)
+        || (value == NULL)
+        || (length == NULL))
+    {
+        return JSMN_STREAM_TOKEN_ERROR_INVALID;
+    }
+
+    size_t start = jsmn_stream_token_start(parser, id);
+    *value = parser->text + start;
+    *length = jsmn_stream_token_end(parser, id) - start;
+    return JSMN_STREAM_TOKEN_ERROR_NONE;
+}
+
+int32_t jsmn_stream_token_utils_get_span_by_key(jsmn_stream_token_parser_t *parser, int parent_id, const char *key, const char **value, size_t *length)
+{
+    int value_id;
+    int32_t result;
+    if ((parser == NULL)
+        || (parser->text == NULL)
+        || (key == NULL)
+        || (value == NULL)
+        || (length == NULL))
+    {
+        return JSMN_STREAM_TOKEN_ERROR_INVALID;
+    }
+
+    result = jsmn_stream_token_utils_get_value_id_by_key(parser, parent_id, key, &value_id);
+    if (result == JSMN_STREAM_TOKEN_ERROR_NONE)
+    {
+        return jsmn_stream_token_utils_get_span_from_id(parser, value_id, value, length);
+    }
+    return result;
+}
@@ -10,6 +10,11 @@ extern "C"
 {
 #endif
 
+/* Characters read at a time by jsmn_stream_token_utils_parse_with_cb(), in a stack buffer */
+#ifndef JSMN_STREAM_TOKEN_UTILS_BLOCK_SIZE
+#define JSMN_STREAM_TOKEN_UTILS_BLOCK_SIZE 64
+#endif
+
 enum jsmn_stream_token_get_char_cb_error
 {
     JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE = 0,
@@ -23,10 +28,12 @@ enum jsmn_stream_token_utils_error
     JSMN_STREAM_TOKEN_UTILS_ERROR_INVALID = -2,
     JSMN_STREAM_TOKEN_UTILS_ERROR_KEY_NOT_FOUND = -3,
     JSMN_STREAM_TOKEN_UTILS_ERROR_OBJECT_NOT_FOUND = -4,
+    JSMN_STREAM_TOKEN_UTILS_ERROR_READ = -5,
 };
 
 
 int32_t jsmn_stream_token_utils_parse_with_cb(jsmn_stream_token_parser_t *parser, size_t length, void *user_arg);
+int32_t jsmn_stream_token_utils_parse_with_cb_blocks(jsmn_stream_token_parser_t *parser, size_t length, void *user_arg, char *block, size_t block_size);
 int32_t jsmn_stream_token_utils_get_value_token_by_key(jsmn_stream_token_parser_t *parser, jsmn_streamtok_t *parent, const char *key, jsmn_streamtok_t **value_token);
 int32_t jsmn_stream_token_utils_array_get_next_object_token(jsmn_stream_token_parser_t *parser, jsmn_streamtok_t *parent, jsmn_streamtok_t **iterator_token);
 int32_t jsmn_stream_token_utils_get_string_from_token(jsmn_stream_token_parser_t *parser, jsmn_streamtok_t *token, char *buffer);
@@ -38,6 +45,18 @@ int32_t jsmn_stream_token_utils_get_double_by_key(jsmn_stream_token_parser_t *pa
 int32_t jsmn_stream_token_utils_get_bool_from_token(jsmn_stream_token_parser_t *parser, jsmn_streamtok_t *token, bool *value);
 int32_t jsmn_stream_token_utils_get_bool_by_key(jsmn_stream_token_parser_t *parser, jsmn_streamtok_t *parent, const char *key, bool *value);
 
+/* Same as above with token ids, for either token store */
+int32_t jsmn_stream_token_utils_get_value_id_by_key(jsmn_stream_token_parser_t *parser, int parent_id, const char *key, int *value_id);
+int32_t jsmn_stream_token_utils_array_get_next_object_id(jsmn_stream_token_parser_t *parser, int array_id, int *iterator_id);
+int32_t jsmn_stream_token_utils_get_string_from_id(jsmn_stream_token_parser_t *parser, int id, char *buffer);
+int32_t jsmn_stream_token_utils_get_int_from_id(jsmn_stream_token_parser_t *parser, int id, int32_t *value);
+int32_t jsmn_stream_token_utils_get_double_from_id(jsmn_stream_token_parser_t *parser, int id, double *value);
+int32_t jsmn_stream_token_utils_get_bool_from_id(jsmn_stream_token_parser_t *parser, int id, bool *value);
+
+/* Zero-copy access for a parser whose text is in memory, see parser->text */
+int32_t jsmn_stream_token_utils_get_span_from_id(jsmn_stream_token_parser_t *parser, int id, const char **value, size_t *length);
+int32_t jsmn_stream_token_utils_get_span_by_key(jsmn_stream_token_parser_t *parser, int parent_id, const char *key, const char **value, size_t *length);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -0,0 +1,563 @@
+#include "jsmn_stream_validate.h"
+#include "jsmn_stream_simd.h"
+
+enum jsmn_stream_validate_state
+{
+	JSMN_STREAM_VALIDATE_VALUE = 0,
+	JSMN_STREAM_VALIDATE_ARRAY_START, // a value or ]
+	JSMN_STREAM_VALIDATE_OBJECT_START, // a key or }
+	JSMN_STREAM_VALIDATE_KEY, // a key after a comma
+	JSMN_STREAM_VALIDATE_COLON,
+	JSMN_STREAM_VALIDATE_AFTER_VALUE, // a comma or a closing bracket
+	JSMN_STREAM_VALIDATE_DONE, // whitespace after the document
+	JSMN_STREAM_VALIDATE_STRING,
+	JSMN_STREAM_VALIDATE_ESCAPE, // after a backslash
+	JSMN_STREAM_VALIDATE_UNICODE, // in the hex digits of \u
+	JSMN_STREAM_VALIDATE_LITERAL,
+	JSMN_STREAM_VALIDATE_MINUS,
+	JSMN_STREAM_VALIDATE_ZERO, // a leading zero
+	JSMN_STREAM_VALIDATE_INTEGER,
+	JSMN_STREAM_VALIDATE_POINT,
+	JSMN_STREAM_VALIDATE_FRACTION,
+	JSMN_STREAM_VALIDATE_EXPONENT, // after e or E
+	JSMN_STREAM_VALIDATE_EXPONENT_SIGN,
+	JSMN_STREAM_VALIDATE_EXPONENT_DIGITS,
+};
+
+/* Characters scanned one at a time before going back to jsmn_stream_scan_utf8() */
+#define JSMN_STREAM_VALIDATE_SCALAR_RUN 16
+
+static bool jsmn_stream_validate_is_whitespace(unsigned char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool jsmn_stream_validate_is_digit(unsigned char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static bool jsmn_stream_validate_is_hex_digit(unsigned char c)
+{
+	return jsmn_stream_validate_is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static bool jsmn_stream_validate_in_object(const jsmn_stream_validator_t *validator)
+{
+	size_t level = validator->depth - 1;
+
+	return (validator->objects[level / 8] >> (level % 8)) & 1;
+}
+
+static int jsmn_stream_validate_fail(jsmn_stream_validator_t *validator, size_t position, int error)
+{
+	validator->error = error;
+	validator->position = position;
+	return error;
+}
+
+static void jsmn_stream_validate_end_value(jsmn_stream_validator_t *validator)
+{
+	validator->state = validator->depth == 0 ? JSMN_STREAM_VALIDATE_DONE : JSMN_STREAM_VALIDATE_AFTER_VALUE;
+}
+
+/**
+ * @brief Start a UTF-8 sequence at its lead byte.
+ *
+ * @param validator
+ * @param c lead byte, 0x80 or above.
+ * @return bool false if c cannot start a sequence.
+ */
+static bool jsmn_stream_validate_utf8_lead(jsmn_stream_validator_t *validator, unsigned char c)
+{
+	validator->utf8_low = 0x80;
+	validator->utf8_high = 0xbf;
+	if (c >= 0xc2 && c <= 0xdf)
+	{
+		validator->utf8_continuations = 1;
+	}
+	else if (c >= 0xe0 && c <= 0xef)
+	{
+		validator->utf8_continuations = 2;
+		// no overlong forms, no surrogates
+		if (c == 0xe0)
+		{
+			validator->utf8_low = 0xa0;
+		}
+		else if (c == 0xed)
+		{
+			validator->utf8_high = 0x9f;
+		}
+	}
+	else if (c >= 0xf0 && c <= 0xf4)
+	{
+		validator->utf8_continuations = 3;
+		// no overlong forms, nothing above U+10FFFF
+		if (c == 0xf0)
+		{
+			validator->utf8_low = 0x90;
+		}
+		else if (c == 0xf4)
+		{
+			validator->utf8_high = 0x8f;
+		}
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Check the UTF-8 of plain string characters, with a sequence
+ * 	possibly cut by the end of the previous chunk or of this one.
+ *
+ * @param validator
+ * @param data
+ * @param length
+ * @return size_t length, or the offset of the first invalid byte.
+ */
+static size_t jsmn_stream_validate_utf8(jsmn_stream_validator_t *validator, const char *data, size_t length)
+{
+	size_t i = 0;
+
+	while (i < length)
+	{
+		size_t run_end;
+
+		if (validator->utf8_continuations == 0)
+		{
+			i += jsmn_stream_scan_utf8(data + i, length - i);
+			if (i == length)
+			{
+				break;
+			}
+		}
+
+		// what the vector scan left, up to a sequence boundary some characters on
+		run_end = length - i > JSMN_STREAM_VALIDATE_SCALAR_RUN ? i + JSMN_STREAM_VALIDATE_SCALAR_RUN : length;
+		while (i < length && (i < run_end || validator->utf8_continuations > 0))
+		{
+			unsigned char c = (unsigned char)data[i];
+			if (validator->utf8_continuations > 0)
+			{
+				if (c < validator->utf8_low || c > validator->utf8_high)
+				{
+					return i;
+				}
+				validator->utf8_continuations--;
+				validator->utf8_low = 0x80;
+				validator->utf8_high = 0xbf;
+			}
+			else if (c >= 0x80 && !jsmn_stream_validate_utf8_lead(validator, c))
+			{
+				return i;
+			}
+			i++;
+		}
+	}
+	return length;
+}
+
+/**
+ * @brief Start the value that begins with c.
+ *
+ * @param validator
+ * @param c
+ * @return int 0, JSMN_STREAM_ERROR_INVAL or JSMN_STREAM_ERROR_MAX_DEPTH.
+ */
+static int jsmn_stream_validate_value(jsmn_stream_validator_t *validator, unsigned char c)
+{
+	switch (c)
+	{
+		case '{':
+		case '[':
+			if (validator->depth == JSMN_STREAM_VALIDATE_MAX_DEPTH)
+			{
+				return JSMN_STREAM_ERROR_MAX_DEPTH;
+			}
+			if (c == '{')
+			{
+				validator->objects[validator->depth / 8] |= (uint8_t)(1 << (validator->depth % 8));
+				validator->state = JSMN_STREAM_VALIDATE_OBJECT_START;
+			}
+			else
+			{
+				validator->objects[validator->depth / 8] &= (uint8_t)~(1 << (validator->depth % 8));
+				validator->state = JSMN_STREAM_VALIDATE_ARRAY_START;
+			}
+			validator->depth++;
+			break;
+		case '"':
+			validator->in_key = false;
+			validator->state = JSMN_STREAM_VALIDATE_STRING;
+			break;
+		case '-':
+			validator->state = JSMN_STREAM_VALIDATE_MINUS;
+			break;
+		case '0':
+			validator->state = JSMN_STREAM_VALIDATE_ZERO;
+			break;
+		case 't':
+			validator->literal = "rue";
+			validator->state = JSMN_STREAM_VALIDATE_LITERAL;
+			break;
+		case 'f':
+			validator->literal = "alse";
+			validator->state = JSMN_STREAM_VALIDATE_LITERAL;
+			break;
+		case 'n':
+			validator->literal = "ull";
+			validator->state = JSMN_STREAM_VALIDATE_LITERAL;
+			break;
+		default:
+			if (c < '1' || c > '9')
+			{
+				return JSMN_STREAM_ERROR_INVAL;
+			}
+			validator->state = JSMN_STREAM_VALIDATE_INTEGER;
+			break;
+	}
+	return 0;
+}
+
+/**
+ * @brief End the innermost object or array with c.
+ *
+ * @param validator
+ * @param c } or ].
+ * @return int 0, or JSMN_STREAM_ERROR_INVAL when c does not match it.
+ */
+static int jsmn_stream_validate_close(jsmn_stream_validator_t *validator, unsigned char c)
+{
+	if (validator->depth == 0 || jsmn_stream_validate_in_object(validator) != (c == '}'))
+	{
+		return JSMN_STREAM_ERROR_INVAL;
+	}
+	validator->depth--;
+	jsmn_stream_validate_end_value(validator);
+	return 0;
+}
+
+/**
+ * @brief Initialize a validator for a new document.
+ *
+ * @param validator
+ */
+void jsmn_stream_validate_init(jsmn_stream_validator_t *validator)
+{
+	validator->state = JSMN_STREAM_VALIDATE_VALUE;
+	validator->literal = NULL;
+	validator->hex_digits = 0;
+	validator->utf8_continuations = 0;
+	validator->utf8_low = 0x80;
+	validator->utf8_high = 0xbf;
+	validator->in_key = false;
+	validator->error = 0;
+	validator->position = 0;
+	validator->depth = 0;
+}
+
+/**
+ * @brief Validate a chunk of characters. Chunks may be split at any point,
+ * 	including inside a UTF-8 sequence. Nothing is copied, string contents
+ * 	are scanned with SIMD. After an error the position of the validator is
+ * 	the stream offset of the offending character, and the later calls
+ * 	return the same error.
+ *
+ * @param validator
+ * @param data
+ * @param length
+ * @return int 0, JSMN_STREAM_ERROR_INVAL or JSMN_STREAM_ERROR_MAX_DEPTH.
+ */
+int jsmn_stream_validate(jsmn_stream_validator_t *validator, const char *data, size_t length)
+{
+	size_t start = validator->position;
+	size_t i = 0;
+	int error;
+
+	if (validator->error != 0)
+	{
+		return validator->error;
+	}
+
+	while (i < length)
+	{
+		unsigned char c = (unsigned char)data[i];
+
+		switch (validator->state)
+		{
+			case JSMN_STREAM_VALIDATE_STRING:
+			{
+				size_t end = i + jsmn_stream_scan_string(data + i, length - i);
+				size_t valid = i + jsmn_stream_validate_utf8(validator, data + i, end - i);
+				if (valid < end)
+				{
+					return jsmn_stream_validate_fail(validator, start + valid, JSMN_STREAM_ERROR_INVAL);
+				}
+				i = end;
+				if (i == length)
+				{
+					continue;
+				}
+				c = (unsigned char)data[i];
+				// a quote or backslash cannot end a UTF-8 sequence either
+				if (c < 0x20 || validator->utf8_continuations > 0)
+				{
+					return jsmn_stream_validate_fail(validator, start + i, JSMN_STREAM_ERROR_INVAL);
+				}
+				if (c == '\\')
+				{
+					validator->state = JSMN_STREAM_VALIDATE_ESCAPE;
+				}
+				else if (validator->in_key)
+				{
+					validator->state = JSMN_STREAM_VALIDATE_COLON;
+				}
+				else
+				{
+					jsmn_stream_validate_end_value(validator);
+				}
+				break;
+			}
+			case JSMN_STREAM_VALIDATE_ESCAPE:
+				switch (c)
+				{
+					case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+						validator->state = JSMN_STREAM_VALIDATE_STRING;
+						break;
+					case 'u':
+						validator->hex_digits = 4;
+						validator->state = JSMN_STREAM_VALIDATE_UNICODE;
+						break;
+					default:
+						return jsmn_stream_validate_fail(validator, start + i, JSMN_STREAM_ERROR_INVAL);
+				}
+				break;
+			case JSMN_STREAM_VALIDATE_UNICODE:
+				if (!jsmn_stream_validate_is_hex_digit(c))
+				{
+					return jsmn_stream_validate_fail(validator, start + i, JSMN_STREAM_ERROR_INVAL);
+				}
+				if (--validator->hex_digits == 0)
+				{
+					validator->state = JSMN_STREAM_VALIDATE_STRING;
+				}
+				break;
+			case JSMN_STREAM_VALIDATE_LITERAL:
+				if (c != (unsigned char)*validator->literal)
+				{
+					return jsmn_stream_validate_fail(validator, start + i, JSMN_STREAM_ERROR_INVAL);
+				}
+				if (*++validator->literal == '\0')
+				{
+					jsmn_stream_validate_end_value(validator);
+				}
+				break;
+
+			// numbers end at the first character that is not theirs, checked in the next state
+			case JSMN_STREAM_VALIDATE_MINUS:
+				if (!jsmn_stream_validate_is_digit(c))
+				{
+					return jsmn_stream_validate_fail(validator, start + i, JSMN_STREAM_ERROR_INVAL);
+				}
+				validator->state = c == '0' ? JSMN_STREAM_VALIDATE_ZERO : JSMN_STREAM_VALIDATE_INTEGER;
+				break;
+			case JSMN_STREAM_VALIDATE_INTEGER:
+				while (jsmn_stream_validate_is_digit(c) && ++i < length)
+				{
+					c = (unsigned char)data[i];
+				}
+				if (i == length)
+				{
+					continue;
+				}
+				// fall through
+			case JSMN_STREAM_VALIDATE_ZERO:
+				if (c == '.')
+				{
+					validator->state = JSMN_STREAM_VALIDATE_POINT;
+				}
+				else if (c == 'e' || c == 'E')
+				{
+					validator->state = JSMN_STREAM_VALIDATE_EXPONENT;
+				}
+				else
+				{
+					jsmn_stream_validate_end_value(validator);
+					continue;
+				}
+				break;
+			case JSMN_STREAM_VALIDATE_POINT:
+				if (!jsmn_stream_validate_is_digit(c))
+				{
+					return jsmn_stream_validate_fail(validator, start + i, JSMN_STREAM_ERROR_INVAL);
+				}
+				validator->state = JSMN_STREAM_VALIDATE_FRACTION;
+				break;
+			case JSMN_STREAM_VALIDATE_FRACTION:
+				if (c == 'e' || c == 'E')
+				{
+					validator->state = JSMN_STREAM_VALIDATE_EXPONENT;
+				}
+				else if (!jsmn_stream_validate_is_digit(c))
+				{
+					jsmn_stream_validate_end_value(validator);
+					continue;
+				}
+				break;
+			case JSMN_STREAM_VALIDATE_EXPONENT:
+				if (c == '+' || c == '-')
+				{
+					validator->state = JSMN_STREAM_VALIDATE_EXPONENT_SIGN;
+					break;
+				}
+				// fall through
+			case JSMN_STREAM_VALIDATE_EXPONENT_SIGN:
+				if (!jsmn_stream_validate_is_digit(c))
+				{
+					return jsmn_stream_validate_fail(validator, start + i, JSMN_STREAM_ERROR_INVAL);
+				}
+				validator->state = JSMN_STREAM_VALIDATE_EXPONENT_DIGITS;
+				break;
+			case JSMN_STREAM_VALIDATE_EXPONENT_DIGITS:
+				if (!jsmn_stream_validate_is_digit(c))
+				{
+					jsmn_stream_validate_end_value(validator);
+					continue;
+				}
+				break;
+
+			default:
+				if (jsmn_stream_validate_is_whitespace(c))
+				{
+					break;
+				}
+				error = JSMN_STREAM_ERROR_INVAL;
+				switch (validator->state)
+				{
+					case JSMN_STREAM_VALIDATE_ARRAY_START:
+						if (c == ']')
+						{
+							error = jsmn_stream_validate_close(validator, c);
+							break;
+						}
+						// fall through
+					case JSMN_STREAM_VALIDATE_VALUE:
+						error = jsmn_stream_validate_value(validator, c);
+						break;
+					case JSMN_STREAM_VALIDATE_OBJECT_START:
+						if (c == '}')
+						{
+							error = jsmn_stream_validate_close(validator, c);
+							break;
+						}
+						// fall through
+					case JSMN_STREAM_VALIDATE_KEY:
+						if (c == '"')
+						{
+							validator->in_key = true;
+							validator->state = JSMN_STREAM_VALIDATE_STRING;
+							error = 0;
+						}
+						break;
+					case JSMN_STREAM_VALIDATE_COLON:
+						if (c == ':')
+						{
+							validator->state = JSMN_STREAM_VALIDATE_VALUE;
+							error = 0;
+						}
+						break;
+					case JSMN_STREAM_VALIDATE_AFTER_VALUE:
+						if (c == ',')
+						{
+							validator->state = jsmn_stream_validate_in_object(validator) ?
+								JSMN_STREAM_VALIDATE_KEY : JSMN_STREAM_VALIDATE_VALUE;
+							error = 0;
+						}
+						else if (c == '}' || c == ']')
+						{
+							error = jsmn_stream_validate_close(validator, c);
+						}
+						break;
+					default:
+						// JSMN_STREAM_VALIDATE_DONE, anything but whitespace
+						break;
+				}
+				if (error != 0)
+				{
+					return jsmn_stream_validate_fail(validator, start + i, error);
+				}
+				break;
+		}
+		i++;
+	}
+
+	validator->position = start + length;
+	return 0;
+}
+
+/**
+ * @brief Check that the document is complete at the end of the stream. A
+ * 	number at the top level ends here.
+ *
+ * @param validator
+ * @return int 0, the error of an earlier call, or JSMN_STREAM_ERROR_PART
+ * 	for an empty stream or a document cut short, with the position at the
+ * 	end of the stream.
+ */
+int jsmn_stream_validate_finish(jsmn_stream_validator_t *validator)
+{
+	if (validator->error != 0)
+	{
+		return validator->error;
+	}
+
+	switch (validator->state)
+	{
+		case JSMN_STREAM_VALIDATE_DONE:
+			return 0;
+		case JSMN_STREAM_VALIDATE_ZERO:
+		case JSMN_STREAM_VALIDATE_INTEGER:
+		case JSMN_STREAM_VALIDATE_FRACTION:
+		case JSMN_STREAM_VALIDATE_EXPONENT_DIGITS:
+			if (validator->depth == 0)
+			{
+				validator->state = JSMN_STREAM_VALIDATE_DONE;
+				return 0;
+			}
+			break;
+		default:
+			break;
+	}
+	return jsmn_stream_validate_fail(validator, validator->position, JSMN_STREAM_ERROR_PART);
+}
+
+/**
+ * @brief Validate a whole document in memory.
+ *
+ * @param data
+ * @param length
+ * @param error_offset receives the offset of the offending character on
+ * 	error, length for JSMN_STREAM_ERROR_PART. May be NULL.
+ * @return int 0, JSMN_STREAM_ERROR_INVAL, JSMN_STREAM_ERROR_MAX_DEPTH or
+ * 	JSMN_STREAM_ERROR_PART.
+ */
+int jsmn_stream_validate_buffer(const char *data, size_t length, size_t *error_offset)
+{
+	jsmn_stream_validator_t validator;
+	int error;
+
+	jsmn_stream_validate_init(&validator);
+	error = jsmn_stream_validate(&validator, data, length);
+	if (error == 0)
+	{
+		error = jsmn_stream_validate_finish(&validator);
+	}
+	if (error != 0 && error_offset != NULL)
+	{
+		*error_offset = validator.position;
+	}
+	return error;
+}
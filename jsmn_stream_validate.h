@@ -0,0 +1,49 @@
+#ifndef __JSMN_STREAM_VALIDATE_H_
+#define __JSMN_STREAM_VALIDATE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "jsmn_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Deepest nesting accepted by the validator, at one bit per level */
+#ifndef JSMN_STREAM_VALIDATE_MAX_DEPTH
+#define JSMN_STREAM_VALIDATE_MAX_DEPTH JSMN_STREAM_MAX_DEPTH
+#endif
+
+/**
+ * @brief Checks that a stream holds one well-formed JSON document, without
+ * 	callbacks and without buffering anything. Stricter than the stream
+ * 	parser: commas, colons, brackets, numbers and literals follow the JSON
+ * 	grammar, and strings must be valid UTF-8 (no overlong forms, surrogates
+ * 	or code points above U+10FFFF). Whitespace may follow the document.
+ *
+ */
+typedef struct {
+  uint8_t state;
+  const char *literal; // rest of the true, false or null being checked
+  uint8_t hex_digits; // still expected in a \u escape
+  uint8_t utf8_continuations; // still expected in a UTF-8 sequence
+  uint8_t utf8_low; // range of the next continuation byte
+  uint8_t utf8_high;
+  bool in_key; // the string being checked is a key
+  int error; // first error, kept by the later calls
+  size_t position; // stream offset of the next character, or of the offending one after an error
+  size_t depth;
+  uint8_t objects[(JSMN_STREAM_VALIDATE_MAX_DEPTH + 7) / 8]; // one bit per level, set for an object
+} jsmn_stream_validator_t;
+
+void jsmn_stream_validate_init(jsmn_stream_validator_t *validator);
+int jsmn_stream_validate(jsmn_stream_validator_t *validator, const char *data, size_t length);
+int jsmn_stream_validate_finish(jsmn_stream_validator_t *validator);
+int jsmn_stream_validate_buffer(const char *data, size_t length, size_t *error_offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSMN_STREAM_VALIDATE_H_ */
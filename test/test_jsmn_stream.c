@@ -0,0 +1,962 @@
+#include "unity.h"
+
+/* The module to test */
+#include "jsmn_stream.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Every event is appended to this log so that parse runs can be compared */
+static char event_log[2048];
+
+static void log_event(const char *format, const char *value)
+{
+    size_t used = strlen(event_log);
+    snprintf(event_log + used, sizeof(event_log) - used, format, value);
+}
+
+static void start_array(void *user_arg) { log_event("[%s", ""); }
+static void end_array(void *user_arg) { log_event("]%s", ""); }
+static void start_object(void *user_arg) { log_event("{%s", ""); }
+static void end_object(void *user_arg) { log_event("}%s", ""); }
+static void object_key(const char *key, size_t key_length, void *user_arg) { log_event("k(%s)", key); }
+static void string(const char *value, size_t length, void *user_arg) { log_event("s(%s)", value); }
+static void primitive(const char *value, size_t length, void *user_arg) { log_event("p(%s)", value); }
+
+static jsmn_stream_callbacks_t callbacks = {
+    .start_array_callback = start_array,
+    .end_array_callback = end_array,
+    .start_object_callback = start_object,
+    .end_object_callback = end_object,
+    .object_key_callback = object_key,
+    .string_callback = string,
+    .primitive_callback = primitive
+};
+
+static const char *json = "{\"a\": [1, \"x\\\"y\", true, {\"b\": null}], \"c\": -2.5e3}";
+static const char *expected_events = "{k(a)[p(1)s(x\\\"y)p(true){k(b)p(null)}]k(c)p(-2.5e3)}";
+
+void setUp(void)
+{
+    event_log[0] = '\0';
+}
+
+void tearDown(void)
+{
+
+}
+
+void test_jsmn_stream_parse_char_by_char(void)
+{
+    jsmn_stream_parser parser;
+    jsmn_stream_init(&parser, &callbacks, NULL);
+
+    for (size_t i = 0; i < strlen(json); i++)
+    {
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse(&parser, json[i]));
+    }
+
+    TEST_ASSERT_EQUAL_STRING(expected_events, event_log);
+    TEST_ASSERT_EQUAL(strlen(json), parser.position);
+}
+
+void test_jsmn_stream_parse_buffer_whole(void)
+{
+    jsmn_stream_parser parser;
+    size_t consumed = 0;
+    jsmn_stream_init(&parser, &callbacks, NULL);
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, json, strlen(json), &consumed));
+    TEST_ASSERT_EQUAL(strlen(json), consumed);
+    TEST_ASSERT_EQUAL_STRING(expected_events, event_log);
+}
+
+void test_jsmn_stream_parse_buffer_any_split(void)
+{
+    size_t length = strlen(json);
+
+    for (size_t split = 0; split <= length; split++)
+    {
+        jsmn_stream_parser parser;
+        event_log[0] = '\0';
+        jsmn_stream_init(&parser, &callbacks, NULL);
+
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, json, split, NULL));
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, json + split, length - split, NULL));
+        TEST_ASSERT_EQUAL_STRING(expected_events, event_log);
+    }
+}
+
+void test_jsmn_stream_parse_buffer_error_offset(void)
+{
+    const char *invalid = "{\"a\": [1, 2, x]}";
+    jsmn_stream_parser parser;
+    size_t consumed = 0;
+    jsmn_stream_init(&parser, &callbacks, NULL);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_parse_buffer(&parser, invalid, strlen(invalid), &consumed));
+    TEST_ASSERT_EQUAL(13, consumed);
+}
+
+void test_jsmn_stream_parse_top_level_string(void)
+{
+    jsmn_stream_parser parser;
+    jsmn_stream_init(&parser, &callbacks, NULL);
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, "\"abc\"", 5, NULL));
+    TEST_ASSERT_EQUAL_STRING("s(abc)", event_log);
+}
+
+void test_jsmn_stream_parse_unicode_escape_split(void)
+{
+    const char *escaped = "[\"a\\u00e9b\", \"\\\\\"]";
+    size_t length = strlen(escaped);
+
+    for (size_t split = 0; split <= length; split++)
+    {
+        jsmn_stream_parser parser;
+        event_log[0] = '\0';
+        jsmn_stream_init(&parser, &callbacks, NULL);
+
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, escaped, split, NULL));
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, escaped + split, length - split, NULL));
+        TEST_ASSERT_EQUAL_STRING("[s(a\\u00e9b)s(\\\\)]", event_log);
+    }
+}
+
+void test_jsmn_stream_parse_invalid_escapes(void)
+{
+    const char *invalid[] = { "\"\\x\"", "\"\\u12g4\"", "\"\\u123\"" };
+    const size_t offsets[] = { 2, 5, 6 };
+
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        jsmn_stream_parser parser;
+        size_t consumed = 0;
+        jsmn_stream_init(&parser, &callbacks, NULL);
+
+        TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_parse_buffer(&parser, invalid[i], strlen(invalid[i]), &consumed));
+        TEST_ASSERT_EQUAL(offsets[i], consumed);
+    }
+}
+
+void test_jsmn_stream_parse_string_too_long(void)
+{
+    /* The longest string that fits leaves room for the terminating null */
+    char long_string[JSMN_STREAM_BUFFER_SIZE + 2];
+    jsmn_stream_parser parser;
+    size_t consumed = 0;
+
+    memset(long_string, 'a', sizeof(long_string));
+    long_string[0] = '"';
+    long_string[sizeof(long_string) - 2] = '"';
+
+    jsmn_stream_init(&parser, &callbacks, NULL);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, long_string, sizeof(long_string) - 1, NULL));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_PARSING, parser.state);
+
+    long_string[sizeof(long_string) - 2] = 'a';
+    long_string[sizeof(long_string) - 1] = '"';
+    jsmn_stream_init(&parser, &callbacks, NULL);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_NOMEM, jsmn_stream_parse_buffer(&parser, long_string, sizeof(long_string), &consumed));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_BUFFER_SIZE, consumed);
+}
+
+void test_jsmn_stream_parse_control_character_in_string(void)
+{
+    const char *invalid = "[\"abc\ndef\"]";
+    jsmn_stream_parser parser;
+    size_t consumed = 0;
+    jsmn_stream_init(&parser, &callbacks, NULL);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_parse_buffer(&parser, invalid, strlen(invalid), &consumed));
+    TEST_ASSERT_EQUAL(5, consumed);
+}
+
+void test_jsmn_stream_parse_long_strings_with_escapes(void)
+{
+    char json_string[128];
+    char expected[160];
+
+    /* Move an escape through every position of the vectorized scan */
+    for (size_t escape_at = 0; escape_at < 80; escape_at++)
+    {
+        jsmn_stream_parser parser;
+        size_t length;
+
+        memset(json_string, 'x', 100);
+        json_string[0] = '"';
+        memcpy(json_string + 1 + escape_at, "\\\"", 2);
+        memcpy(json_string + 100, "\"", 2);
+        length = strlen(json_string);
+
+        snprintf(expected, sizeof(expected), "s(%.*s)", (int)(length - 2), json_string + 1);
+
+        event_log[0] = '\0';
+        jsmn_stream_init(&parser, &callbacks, NULL);
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, json_string, length, NULL));
+        TEST_ASSERT_EQUAL_STRING(expected, event_log);
+        TEST_ASSERT_EQUAL(length, parser.position);
+    }
+}
+
+/* Records the last span delivered to the span callbacks */
+static const char *span_value;
+static size_t span_length;
+static size_t span_offset;
+static size_t span_count;
+
+static void record_span(const char *value, size_t length, size_t offset, void *user_arg)
+{
+    span_value = value;
+    span_length = length;
+    span_offset = offset;
+    span_count++;
+}
+
+static jsmn_stream_callbacks_t span_callbacks = {
+    .object_key_span_callback = record_span,
+    .string_span_callback = record_span,
+    .primitive_span_callback = record_span
+};
+
+void test_jsmn_stream_parse_span_points_into_chunk(void)
+{
+    const char *chunk = "{\"key\": 12345}";
+    jsmn_stream_parser parser;
+    jsmn_stream_init(&parser, &span_callbacks, NULL);
+    span_count = 0;
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, chunk, 9, NULL));
+    TEST_ASSERT_EQUAL(1, span_count);
+    TEST_ASSERT_EQUAL_PTR(chunk + 2, span_value);
+    TEST_ASSERT_EQUAL(3, span_length);
+    TEST_ASSERT_EQUAL(2, span_offset);
+
+    /* The primitive straddles the chunks, so it comes from the parser buffer */
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, chunk + 9, strlen(chunk) - 9, NULL));
+    TEST_ASSERT_EQUAL(2, span_count);
+    TEST_ASSERT_EQUAL_PTR(parser.buffer, span_value);
+    TEST_ASSERT_EQUAL_MEMORY("12345", span_value, 5);
+    TEST_ASSERT_EQUAL(5, span_length);
+    TEST_ASSERT_EQUAL(8, span_offset);
+}
+
+void test_jsmn_stream_parse_span_longer_than_buffer(void)
+{
+    char long_string[JSMN_STREAM_BUFFER_SIZE * 2];
+    jsmn_stream_parser parser;
+    jsmn_stream_init(&parser, &span_callbacks, NULL);
+    span_count = 0;
+
+    memset(long_string, 'a', sizeof(long_string));
+    long_string[0] = '"';
+    long_string[sizeof(long_string) - 1] = '"';
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, long_string, sizeof(long_string), NULL));
+    TEST_ASSERT_EQUAL(1, span_count);
+    TEST_ASSERT_EQUAL_PTR(long_string + 1, span_value);
+    TEST_ASSERT_EQUAL(sizeof(long_string) - 2, span_length);
+}
+
+/* Reassembles the fragments of long values */
+static char fragment_value[JSMN_STREAM_BUFFER_SIZE * 4];
+static size_t fragment_length;
+static size_t fragment_count;
+static bool fragment_final;
+
+static void record_fragment(const char *value, size_t length, size_t offset, bool final, void *user_arg)
+{
+    TEST_ASSERT_FALSE(fragment_final);
+    TEST_ASSERT_EQUAL(strlen(value), length);
+    memcpy(fragment_value + fragment_length, value, length);
+    fragment_length += length;
+    fragment_count++;
+    fragment_final = final;
+}
+
+static jsmn_stream_callbacks_t fragment_callbacks = {
+    .object_key_callback = object_key,
+    .string_callback = string,
+    .key_fragment_callback = record_fragment,
+    .string_fragment_callback = record_fragment
+};
+
+void test_jsmn_stream_parse_long_string_in_fragments(void)
+{
+    char json_string[sizeof(fragment_value) + 16];
+    size_t value_length = sizeof(fragment_value) - 10;
+    size_t length;
+
+    strcpy(json_string, "{\"k\": \"");
+    memset(json_string + strlen(json_string), 'v', value_length);
+    strcpy(json_string + 7 + value_length, "\"}");
+    length = strlen(json_string);
+
+    /* Char by char every value straddles a chunk boundary */
+    for (size_t chunk_size = 1; chunk_size <= length; chunk_size += length - 1)
+    {
+        jsmn_stream_parser parser;
+        event_log[0] = '\0';
+        fragment_length = 0;
+        fragment_count = 0;
+        fragment_final = false;
+        jsmn_stream_init(&parser, &fragment_callbacks, NULL);
+
+        for (size_t i = 0; i < length; i += chunk_size)
+        {
+            size_t size = length - i < chunk_size ? length - i : chunk_size;
+            TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, json_string + i, size, NULL));
+        }
+
+        TEST_ASSERT_EQUAL_STRING("k(k)", event_log);
+        TEST_ASSERT_TRUE(fragment_final);
+        TEST_ASSERT_EQUAL(value_length, fragment_length);
+        TEST_ASSERT_EQUAL_MEMORY(json_string + 7, fragment_value, value_length);
+        TEST_ASSERT_EQUAL(value_length / (JSMN_STREAM_BUFFER_SIZE - 1) + 1, fragment_count);
+    }
+}
+
+void test_jsmn_stream_init_with_storage_capacities(void)
+{
+    char buffer[8];
+    jsmn_stream_stack_t type_stack[JSMN_STREAM_STACK_WORDS(4)];
+    jsmn_stream_parser parser;
+    size_t consumed = 0;
+
+    /* Two nested objects take all four levels with their keys */
+    const char *nested = "{\"a\":{\"b\":\"1234567\"}}";
+    jsmn_stream_init_with_storage(&parser, &callbacks, NULL, buffer, sizeof(buffer), type_stack, 4);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, nested, strlen(nested), NULL));
+    TEST_ASSERT_EQUAL_STRING("{k(a){k(b)s(1234567)}}", event_log);
+
+    jsmn_stream_init_with_storage(&parser, &callbacks, NULL, buffer, sizeof(buffer), type_stack, 4);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_MAX_DEPTH, jsmn_stream_parse_buffer(&parser, "[[[[[", 5, &consumed));
+    TEST_ASSERT_EQUAL(4, consumed);
+
+    jsmn_stream_init_with_storage(&parser, &callbacks, NULL, buffer, sizeof(buffer), type_stack, 4);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_NOMEM, jsmn_stream_parse_buffer(&parser, "\"12345678\"", 10, &consumed));
+    TEST_ASSERT_EQUAL(8, consumed);
+}
+
+void test_jsmn_stream_init_shares_callbacks(void)
+{
+    jsmn_stream_parser first;
+    jsmn_stream_parser second;
+
+    jsmn_stream_init(&first, &callbacks, NULL);
+    jsmn_stream_init(&second, &callbacks, NULL);
+
+    TEST_ASSERT_EQUAL_PTR(&callbacks, first.callbacks);
+    TEST_ASSERT_EQUAL_PTR(&callbacks, second.callbacks);
+}
+
+/* Spans several 64 character blocks, with escapes and whitespace at the block edges */
+static const char *indexed_json =
+    "{\"list\": [1, 22,\n    333, true, false, null],\n"
+    "    \"text\": \"a string long enough to cross a block \\\\\\\"edge\\\\\",\n"
+    "    \"nested\": {\"e\\u00e9\": [\"\", \"\\\\\\\\\", {}], \"n\": -0.5e-3}}   ";
+
+void test_jsmn_stream_parse_indexed_any_split(void)
+{
+    char expected[sizeof(event_log)];
+    size_t length = strlen(indexed_json);
+    jsmn_stream_parser parser;
+
+    jsmn_stream_init(&parser, &callbacks, NULL);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, indexed_json, length, NULL));
+    strcpy(expected, event_log);
+
+    for (size_t split = 0; split <= length; split++)
+    {
+        event_log[0] = '\0';
+        jsmn_stream_init(&parser, &callbacks, NULL);
+
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_indexed(&parser, indexed_json, split, NULL));
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_indexed(&parser, indexed_json + split, length - split, NULL));
+        TEST_ASSERT_EQUAL_STRING(expected, event_log);
+        TEST_ASSERT_EQUAL(length, parser.position);
+    }
+}
+
+void test_jsmn_stream_parse_indexed_error_offset(void)
+{
+    const char *invalid[] = {
+        "{\"a\": [1, 2, x]}",
+        "[\"abc\ndef\"]",
+        "[\"0123456789012345678901234567890123456789012345678901234567890\\x\"]",
+        "[\"a\" b]"
+    };
+    const size_t offsets[] = { 13, 5, 64, 5 };
+
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        jsmn_stream_parser parser;
+        size_t consumed = 0;
+        jsmn_stream_init(&parser, &callbacks, NULL);
+
+        TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_parse_indexed(&parser, invalid[i], strlen(invalid[i]), &consumed));
+        TEST_ASSERT_EQUAL(offsets[i], consumed);
+    }
+}
+
+void test_jsmn_stream_parse_indexed_quote_in_primitive(void)
+{
+    /* Stage 1 takes the quote for a string, the parser keeps it in the primitive */
+    const char *odd = "[1\"a\" 2, \"b\"]";
+    jsmn_stream_parser parser;
+    jsmn_stream_init(&parser, &callbacks, NULL);
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_indexed(&parser, odd, strlen(odd), NULL));
+    TEST_ASSERT_EQUAL_STRING("[p(1\"a\")p(2)s(b)]", event_log);
+}
+
+static void typed_int64(int64_t value, void *user_arg)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%lld", (long long)value);
+    log_event("i(%s)", text);
+}
+
+static void typed_uint64(uint64_t value, void *user_arg)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%llu", (unsigned long long)value);
+    log_event("u(%s)", text);
+}
+
+static void typed_double(double value, bool overflow, void *user_arg)
+{
+    char text[40];
+    snprintf(text, sizeof(text), "%.17g%s", value, overflow ? "!" : "");
+    log_event("d(%s)", text);
+}
+
+static void typed_bool(bool value, void *user_arg) { log_event("b(%s)", value ? "1" : "0"); }
+static void typed_null(void *user_arg) { log_event("n%s", ""); }
+
+static jsmn_stream_callbacks_t typed_callbacks = {
+    .start_array_callback = start_array,
+    .end_array_callback = end_array,
+    .primitive_callback = primitive,
+    .int64_callback = typed_int64,
+    .uint64_callback = typed_uint64,
+    .double_callback = typed_double,
+    .bool_callback = typed_bool,
+    .null_callback = typed_null
+};
+
+void test_jsmn_stream_parse_typed_primitives(void)
+{
+    const char *typed_json =
+        "[0, -9223372036854775808, 9223372036854775808, 18446744073709551616, "
+        "1.5, -2.5e-3, 0.1, 1e400, 3.14159265358979323846, true, false, null, 01, nul]";
+    const char *expected =
+        "[i(0)i(-9223372036854775808)u(9223372036854775808)d(1.8446744073709552e+19!)"
+        "d(1.5)d(-0.0025000000000000001)d(0.10000000000000001)d(inf!)d(3.1415926535897931)"
+        "b(1)b(0)np(01)p(nul)]";
+    size_t length = strlen(typed_json);
+
+    for (size_t split = 0; split <= length; split++)
+    {
+        jsmn_stream_parser parser;
+        event_log[0] = '\0';
+        jsmn_stream_init(&parser, &typed_callbacks, NULL);
+
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, typed_json, split, NULL));
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, typed_json + split, length - split, NULL));
+        TEST_ASSERT_EQUAL_STRING(expected, event_log);
+    }
+}
+
+void test_jsmn_stream_parse_typed_falls_back_to_primitive(void)
+{
+    /* Without the integer callbacks integers are doubles, the rest stays text */
+    jsmn_stream_callbacks_t doubles_only = {
+        .start_array_callback = start_array,
+        .end_array_callback = end_array,
+        .primitive_callback = primitive,
+        .double_callback = typed_double
+    };
+    const char *mixed = "[42, -7, true, null]";
+    jsmn_stream_parser parser;
+    jsmn_stream_init(&parser, &doubles_only, NULL);
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, mixed, strlen(mixed), NULL));
+    TEST_ASSERT_EQUAL_STRING("[d(42)d(-7)p(true)p(null)]", event_log);
+}
+
+/* Containers under a key starting with "skip" are skipped from their start callback */
+static bool skip_next;
+
+static void skip_key(const char *key, size_t key_length, void *user_arg)
+{
+    log_event("k(%s)", key);
+    skip_next = strncmp(key, "skip", 4) == 0;
+}
+
+static void skip_start_array(void *user_arg)
+{
+    log_event("[%s", "");
+    if (skip_next) jsmn_stream_skip((jsmn_stream_parser *)user_arg);
+    skip_next = false;
+}
+
+static void skip_start_object(void *user_arg)
+{
+    log_event("{%s", "");
+    if (skip_next) jsmn_stream_skip((jsmn_stream_parser *)user_arg);
+    skip_next = false;
+}
+
+/* A primitive of 0 skips the rest of its container */
+static void skip_primitive(const char *value, size_t length, void *user_arg)
+{
+    log_event("p(%s)", value);
+    if (strcmp(value, "0") == 0) jsmn_stream_skip((jsmn_stream_parser *)user_arg);
+    skip_next = false;
+}
+
+static jsmn_stream_callbacks_t skip_callbacks = {
+    .start_array_callback = skip_start_array,
+    .end_array_callback = end_array,
+    .start_object_callback = skip_start_object,
+    .end_object_callback = end_object,
+    .object_key_callback = skip_key,
+    .string_callback = string,
+    .primitive_callback = skip_primitive
+};
+
+void test_jsmn_stream_skip_any_split(void)
+{
+    const char *skipped_json =
+        "{\"skip\": {\"x\": [1, \"}]\\\"{\", {\"y\": [[]]}], \"z\": 3},"
+        " \"a\": [1, 0, 2, {\"b\": 3}], \"skip2\": [\"[\"], \"c\": [0], \"d\": true}";
+    const char *expected = "{k(skip){}k(a)[p(1)p(0)]k(skip2)[]k(c)[p(0)]k(d)p(true)}";
+    size_t length = strlen(skipped_json);
+
+    for (size_t split = 0; split <= length; split++)
+    {
+        jsmn_stream_parser parser;
+        event_log[0] = '\0';
+        jsmn_stream_init(&parser, &skip_callbacks, &parser);
+
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, skipped_json, split, NULL));
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, skipped_json + split, length - split, NULL));
+        TEST_ASSERT_EQUAL_STRING(expected, event_log);
+
+        event_log[0] = '\0';
+        jsmn_stream_init(&parser, &skip_callbacks, &parser);
+
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_indexed(&parser, skipped_json, split, NULL));
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_indexed(&parser, skipped_json + split, length - split, NULL));
+        TEST_ASSERT_EQUAL_STRING(expected, event_log);
+        TEST_ASSERT_EQUAL(0, parser.stack_height);
+    }
+}
+
+void test_jsmn_stream_skip_char_by_char(void)
+{
+    const char *skipped_json = "[{\"skip\": {\"a\": \"\\\\\"}}, 0, {\"b\": 1}]";
+    jsmn_stream_parser parser;
+    jsmn_stream_init(&parser, &skip_callbacks, &parser);
+
+    for (size_t i = 0; i < strlen(skipped_json); i++)
+    {
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse(&parser, skipped_json[i]));
+    }
+
+    TEST_ASSERT_EQUAL_STRING("[{k(skip){}}p(0)]", event_log);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_PARSING, parser.state);
+}
+
+static const char *event_names[] = { "{", "}", "[", "]", "k", "s", "p", "d" };
+
+/* Skips the object or array after a "skip" key, stops after a "stop" key */
+static jsmn_stream_action_t steering_event(jsmn_stream_event_t event, const char *value,
+    size_t length, size_t offset, void *user_arg)
+{
+    static bool skip_value;
+    char text[32];
+
+    snprintf(text, sizeof(text), "%s%.*s@%zu", event_names[event], value ? (int)length : 0, value ? value : "", offset);
+    log_event("%s ", text);
+    if (event == JSMN_STREAM_EVENT_KEY)
+    {
+        skip_value = length == 4 && memcmp(value, "skip", 4) == 0;
+        if (length == 4 && memcmp(value, "stop", 4) == 0)
+        {
+            return JSMN_STREAM_STOP;
+        }
+        return JSMN_STREAM_CONTINUE;
+    }
+    if (skip_value && (event == JSMN_STREAM_EVENT_START_OBJECT || event == JSMN_STREAM_EVENT_START_ARRAY))
+    {
+        skip_value = false;
+        return JSMN_STREAM_SKIP_VALUE;
+    }
+    return JSMN_STREAM_CONTINUE;
+}
+
+static jsmn_stream_callbacks_t steering_callbacks = {
+    .primitive_callback = primitive,
+    .event_callback = steering_event
+};
+
+void test_jsmn_stream_event_callback_actions(void)
+{
+    const char *steered = "{\"skip\": [1, {\"a\": 2}], \"b\": \"c\", \"stop\": 3, \"d\": 4}";
+    jsmn_stream_parser parser;
+    size_t consumed = 0;
+    jsmn_stream_init(&parser, &steering_callbacks, NULL);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_STOPPED, jsmn_stream_parse_buffer(&parser, steered, strlen(steered), &consumed));
+    TEST_ASSERT_EQUAL(40, consumed);
+    TEST_ASSERT_EQUAL(40, parser.position);
+    TEST_ASSERT_EQUAL_STRING("{@0 kskip@2 [@9 ]@21 kb@25 sc@30 kstop@35 ", event_log);
+
+    /* The rest parses as if the parser had not stopped */
+    event_log[0] = '\0';
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, steered + consumed, strlen(steered) - consumed, &consumed));
+    TEST_ASSERT_EQUAL_STRING("p3@42 kd@46 p4@50 }@51 d@0 ", event_log);
+}
+
+static void stop_at_primitive(const char *value, size_t length, void *user_arg)
+{
+    log_event("p(%s)", value);
+    jsmn_stream_stop((jsmn_stream_parser *)user_arg);
+}
+
+void test_jsmn_stream_stop_any_split(void)
+{
+    static jsmn_stream_callbacks_t stopping_callbacks = {
+        .start_array_callback = start_array,
+        .end_array_callback = end_array,
+        .string_callback = string,
+        .primitive_callback = stop_at_primitive
+    };
+    const char *stopped = "[\"a\", 12, [true], \"b\", null]";
+    size_t length = strlen(stopped);
+
+    for (size_t split = 0; split <= length; split++)
+    {
+        jsmn_stream_parser parser;
+        size_t offset = 0;
+        int stops = 0;
+        event_log[0] = '\0';
+        jsmn_stream_init(&parser, &stopping_callbacks, &parser);
+
+        /* Feed the two chunks again from where each stop left off */
+        while (offset < length)
+        {
+            size_t end = offset < split ? split : length;
+            size_t consumed = 0;
+            int r = jsmn_stream_parse_buffer(&parser, stopped + offset, end - offset, &consumed);
+
+            if (r == JSMN_STREAM_STOPPED)
+            {
+                stops++;
+            }
+            else
+            {
+                TEST_ASSERT_EQUAL(0, r);
+            }
+            offset += consumed;
+            TEST_ASSERT_EQUAL(offset, parser.position);
+        }
+
+        TEST_ASSERT_EQUAL(3, stops);
+        TEST_ASSERT_EQUAL_STRING("[s(a)p(12)[p(true)]s(b)p(null)]", event_log);
+    }
+}
+
+static void document_end(size_t start, size_t end, void *user_arg)
+{
+    char text[32];
+
+    snprintf(text, sizeof(text), "d(%zu,%zu)", start, end);
+    log_event("%s", text);
+}
+
+void test_jsmn_stream_document_end_any_split(void)
+{
+    static jsmn_stream_callbacks_t document_callbacks = {
+        .start_array_callback = start_array,
+        .end_array_callback = end_array,
+        .start_object_callback = start_object,
+        .end_object_callback = end_object,
+        .object_key_callback = object_key,
+        .string_callback = string,
+        .primitive_callback = primitive,
+        .document_end_callback = document_end
+    };
+    const char *documents = "{\"a\": [1]}[2] \"s\"\n-3\n{}";
+    const char *expected = "{k(a)[p(1)]}d(0,10)[p(2)]d(10,13)s(s)d(14,17)p(-3)d(18,20){}d(21,23)";
+    size_t length = strlen(documents);
+
+    for (size_t split = 0; split <= length; split++)
+    {
+        jsmn_stream_parser parser;
+        event_log[0] = '\0';
+        jsmn_stream_init(&parser, &document_callbacks, NULL);
+
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, documents, split, NULL));
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_indexed(&parser, documents + split, length - split, NULL));
+        TEST_ASSERT_EQUAL_STRING(expected, event_log);
+    }
+}
+
+void test_jsmn_stream_lines_newline_in_document(void)
+{
+    const char *split_record = "[1]\n{\"a\":\n 2}";
+    jsmn_stream_parser parser;
+    size_t consumed = 0;
+
+    jsmn_stream_init(&parser, &callbacks, NULL);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, split_record, strlen(split_record), NULL));
+
+    jsmn_stream_init(&parser, &callbacks, NULL);
+    parser.lines = true;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_parse_buffer(&parser, split_record, strlen(split_record), &consumed));
+    TEST_ASSERT_EQUAL(9, consumed);
+
+    jsmn_stream_init(&parser, &callbacks, NULL);
+    parser.lines = true;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_parse_indexed(&parser, split_record, strlen(split_record), &consumed));
+    TEST_ASSERT_EQUAL(9, consumed);
+}
+
+void test_jsmn_stream_snapshot_restore_any_split(void)
+{
+    const char *documents[] = {
+        json,
+        "{\"skip\": {\"x\": [1, \"}]\\\"{\", {\"y\": [[]]}], \"z\": 3},"
+        " \"a\": [1, 0, 2, {\"b\": 3}], \"skip2\": [\"[\"], \"c\": [0], \"d\": \"\\u00e9\"}"
+    };
+    unsigned char snapshot[JSMN_STREAM_SNAPSHOT_MAX_SIZE(JSMN_STREAM_MAX_DEPTH, JSMN_STREAM_BUFFER_SIZE)];
+    char expected[sizeof(event_log)];
+
+    for (size_t i = 0; i < sizeof(documents) / sizeof(documents[0]); i++)
+    {
+        size_t length = strlen(documents[i]);
+        jsmn_stream_parser parser;
+
+        event_log[0] = '\0';
+        jsmn_stream_init(&parser, &skip_callbacks, &parser);
+        TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, documents[i], length, NULL));
+        strcpy(expected, event_log);
+
+        for (size_t split = 0; split <= length; split++)
+        {
+            jsmn_stream_parser resumed;
+            size_t written = 0;
+
+            event_log[0] = '\0';
+            jsmn_stream_init(&parser, &skip_callbacks, &parser);
+            TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, documents[i], split, NULL));
+            TEST_ASSERT_EQUAL(0, jsmn_stream_snapshot(&parser, snapshot, sizeof(snapshot), &written));
+
+            // the parser that took the snapshot is gone, a new one carries on
+            memset(&parser, 0xA5, sizeof(parser));
+            jsmn_stream_init(&resumed, &skip_callbacks, &resumed);
+            TEST_ASSERT_EQUAL(0, jsmn_stream_restore(&resumed, snapshot, written));
+            TEST_ASSERT_EQUAL(split, resumed.position);
+            TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&resumed, documents[i] + split, length - split, NULL));
+            TEST_ASSERT_EQUAL_STRING(expected, event_log);
+        }
+    }
+}
+
+void test_jsmn_stream_snapshot_format(void)
+{
+    // the same bytes are expected from the packed stack, see test_jsmn_stream_packed_stack.c
+    const unsigned char expected[] = { 'j', 's', 's', JSMN_STREAM_SNAPSHOT_VERSION, JSMN_STREAM_PARSING_STRING, 0, 0,
+        200, 1, 197, 1, 185, 1, 0, 0, 3, 3, 0x3B, 'a', 'b', 'c' };
+    unsigned char snapshot[64];
+    char document[300];
+    size_t written = 0;
+    jsmn_stream_parser parser;
+
+    // 200 characters in, inside the string of the key of the innermost object
+    memset(document, ' ', sizeof(document));
+    memcpy(document + 188, "{\"k\":[{\"k\":\"abc", 15);
+    jsmn_stream_init(&parser, &callbacks, NULL);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, document + 3, 200, NULL));
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_NOMEM, jsmn_stream_snapshot(&parser, NULL, 0, &written));
+    TEST_ASSERT_EQUAL(sizeof(expected), written);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_snapshot(&parser, snapshot, sizeof(snapshot), &written));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, snapshot, sizeof(expected));
+}
+
+void test_jsmn_stream_restore_errors(void)
+{
+    const char *partial = "[{\"a\": [[\"abcdef";
+    unsigned char snapshot[64];
+    size_t written = 0;
+    jsmn_stream_parser parser;
+    jsmn_stream_parser resumed;
+    char buffer[7];
+    jsmn_stream_stack_t type_stack[JSMN_STREAM_STACK_WORDS(5)];
+
+    jsmn_stream_init(&parser, &callbacks, NULL);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, partial, strlen(partial), NULL));
+    TEST_ASSERT_EQUAL(0, jsmn_stream_snapshot(&parser, snapshot, sizeof(snapshot), &written));
+
+    // five levels with the key, a buffer of 6 characters and the null character
+    jsmn_stream_init_with_storage(&resumed, &callbacks, NULL, buffer, sizeof(buffer), type_stack, 4);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_MAX_DEPTH, jsmn_stream_restore(&resumed, snapshot, written));
+    jsmn_stream_init_with_storage(&resumed, &callbacks, NULL, buffer, 6, type_stack, 5);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_NOMEM, jsmn_stream_restore(&resumed, snapshot, written));
+    TEST_ASSERT_EQUAL(0, resumed.stack_height);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_restore(&resumed, snapshot, written - 1));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_restore(&resumed, snapshot, 3));
+    snapshot[3]++;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_restore(&resumed, snapshot, written));
+    snapshot[3]--;
+
+    jsmn_stream_init_with_storage(&resumed, &callbacks, NULL, buffer, sizeof(buffer), type_stack, 5);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_restore(&resumed, snapshot, written));
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&resumed, "\"]]}]", 5, NULL));
+    TEST_ASSERT_EQUAL_STRING("[{k(a)[[s(abcdef)]]}]", event_log);
+}
+
+/* Records decoded keys and strings with their escaped flag and offset */
+static const char *decoded_value;
+static size_t decoded_offset;
+
+static void log_decoded(char kind, const char *value, size_t length, size_t offset, bool escaped)
+{
+    size_t used = strlen(event_log);
+    snprintf(event_log + used, sizeof(event_log) - used, "%c%d(%.*s)", kind, escaped, (int)length, value);
+    decoded_value = value;
+    decoded_offset = offset;
+}
+
+static void decoded_key(const char *key, size_t key_length, size_t offset, bool escaped, void *user_arg)
+{
+    log_decoded('k', key, key_length, offset, escaped);
+}
+
+static void decoded_string(const char *value, size_t length, size_t offset, bool escaped, void *user_arg)
+{
+    log_decoded('s', value, length, offset, escaped);
+}
+
+static jsmn_stream_callbacks_t decoded_callbacks = {
+    .start_array_callback = start_array,
+    .end_array_callback = end_array,
+    .start_object_callback = start_object,
+    .end_object_callback = end_object,
+    .primitive_callback = primitive,
+    .object_key_decoded_callback = decoded_key,
+    .string_decoded_callback = decoded_string
+};
+
+static const char *escaped_json =
+    "{\"plain\": \"caf\\u00e9 \\ud83d\\ude00 \\\"q\\\"\\n\", \"k\\\\ey\": "
+    "[\"\\ud800x\", \"\\uD800\\t\", \"\\ud800\\ud83d\\ude00\", \"\\udc00\", \"a\\ud800\", \"\xc3\xa9\\/\", 1]}";
+static const char *expected_decoded =
+    "{k0(plain)s1(caf\xc3\xa9 \xf0\x9f\x98\x80 \"q\"\n)k1(k\\ey)"
+    "[s1(\xef\xbf\xbd" "x)s1(\xef\xbf\xbd\t)s1(\xef\xbf\xbd\xf0\x9f\x98\x80)s1(\xef\xbf\xbd)"
+    "s1(a\xef\xbf\xbd)s1(\xc3\xa9/)p(1)]}";
+
+void test_jsmn_stream_decoded_any_split(void)
+{
+    size_t length = strlen(escaped_json);
+    unsigned char snapshot[JSMN_STREAM_SNAPSHOT_MAX_SIZE(JSMN_STREAM_MAX_DEPTH, JSMN_STREAM_BUFFER_SIZE)];
+    jsmn_stream_parser parsers[2];
+    size_t written;
+
+    for (size_t split = 1; split <= length; split++)
+    {
+        size_t current = 0;
+        event_log[0] = '\0';
+        jsmn_stream_init(&parsers[current], &decoded_callbacks, NULL);
+
+        // surrogate pairs and escapes cut anywhere also survive a snapshot
+        for (size_t i = 0; i < length; i += split)
+        {
+            size_t size = length - i < split ? length - i : split;
+            TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parsers[current], escaped_json + i, size, NULL));
+            TEST_ASSERT_EQUAL(0, jsmn_stream_snapshot(&parsers[current], snapshot, sizeof(snapshot), &written));
+            current = !current;
+            jsmn_stream_init(&parsers[current], &decoded_callbacks, NULL);
+            TEST_ASSERT_EQUAL(0, jsmn_stream_restore(&parsers[current], snapshot, written));
+        }
+        TEST_ASSERT_EQUAL_STRING(expected_decoded, event_log);
+
+        event_log[0] = '\0';
+        jsmn_stream_init(&parsers[0], &decoded_callbacks, NULL);
+        for (size_t i = 0; i < length; i += split)
+        {
+            size_t size = length - i < split ? length - i : split;
+            TEST_ASSERT_EQUAL(0, jsmn_stream_parse_indexed(&parsers[0], escaped_json + i, size, NULL));
+        }
+        TEST_ASSERT_EQUAL_STRING(expected_decoded, event_log);
+    }
+}
+
+void test_jsmn_stream_decoded_escape_free_values_are_spans(void)
+{
+    const char *chunk = "[\"abc\", \"a\\u0000b\", \"x\\q\"]";
+    jsmn_stream_parser parser;
+    jsmn_stream_init(&parser, &decoded_callbacks, NULL);
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, chunk, 7, NULL));
+    TEST_ASSERT_EQUAL_STRING("[s0(abc)", event_log);
+    TEST_ASSERT_EQUAL_PTR(chunk + 2, decoded_value);
+    TEST_ASSERT_EQUAL(2, decoded_offset);
+
+    // a decoded value is a copy, \u0000 included
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, chunk + 7, 12, NULL));
+    TEST_ASSERT_EQUAL_PTR(parser.buffer, decoded_value);
+    TEST_ASSERT_EQUAL_MEMORY("a\0b", decoded_value, 4);
+    TEST_ASSERT_EQUAL(9, decoded_offset);
+
+    // escape sequences are checked as usual
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_parse_buffer(&parser, chunk + 19, strlen(chunk) - 19, NULL));
+    TEST_ASSERT_EQUAL(23, parser.position);
+
+    // the raw callbacks still get the escape sequences
+    event_log[0] = '\0';
+    jsmn_stream_init(&parser, &callbacks, NULL);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, "[\"\\ud83d\\ude00\"]", 16, NULL));
+    TEST_ASSERT_EQUAL_STRING("[s(\\ud83d\\ude00)]", event_log);
+}
+
+static jsmn_stream_callbacks_t decoded_fragment_callbacks = {
+    .string_decoded_callback = decoded_string,
+    .string_fragment_callback = record_fragment
+};
+
+void test_jsmn_stream_decoded_long_string_in_fragments(void)
+{
+    char json_string[JSMN_STREAM_BUFFER_SIZE * 3];
+    size_t escapes = (sizeof(json_string) - 2) / 6;
+    size_t length = 0;
+    jsmn_stream_parser parser;
+
+    // every \u20ac becomes three bytes, so the decoded value is half as long
+    json_string[length++] = '"';
+    for (size_t i = 0; i < escapes; i++)
+    {
+        memcpy(json_string + length, "\\u20ac", 6);
+        length += 6;
+    }
+    json_string[length++] = '"';
+
+    fragment_length = 0;
+    fragment_count = 0;
+    fragment_final = false;
+    jsmn_stream_init(&parser, &decoded_fragment_callbacks, NULL);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, json_string, length, NULL));
+
+    TEST_ASSERT_EQUAL_STRING("", event_log);
+    TEST_ASSERT_TRUE(fragment_final);
+    TEST_ASSERT_EQUAL(escapes * 3, fragment_length);
+    for (size_t i = 0; i < escapes; i++)
+    {
+        TEST_ASSERT_EQUAL_MEMORY("\xe2\x82\xac", fragment_value + i * 3, 3);
+    }
+}
@@ -0,0 +1,155 @@
+#include "unity.h"
+
+/* The module to test */
+#include "jsmn_stream_bind.h"
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+    int32_t id;
+    int64_t serial;
+    uint32_t flags;
+    double period;
+    bool enabled;
+    char label[8];
+    char port[2];
+} operation_t;
+
+static const jsmn_stream_binding_t bindings[] = {
+    JSMN_STREAM_BIND_FIELD("/id", operation_t, id, JSMN_STREAM_BIND_INT32),
+    JSMN_STREAM_BIND_FIELD("/serial", operation_t, serial, JSMN_STREAM_BIND_INT64),
+    JSMN_STREAM_BIND_FIELD("/flags", operation_t, flags, JSMN_STREAM_BIND_UINT32),
+    JSMN_STREAM_BIND_FIELD("/properties/period", operation_t, period, JSMN_STREAM_BIND_DOUBLE),
+    JSMN_STREAM_BIND_FIELD("/properties/enabled", operation_t, enabled, JSMN_STREAM_BIND_BOOL),
+    JSMN_STREAM_BIND_FIELD("/label", operation_t, label, JSMN_STREAM_BIND_STRING),
+    JSMN_STREAM_BIND_FIELD("/ports/1", operation_t, port, JSMN_STREAM_BIND_STRING),
+};
+
+static jsmn_stream_bind_t bind;
+static operation_t operation;
+
+void setUp(void)
+{
+    memset(&operation, 0, sizeof(operation));
+}
+
+void tearDown(void)
+{
+
+}
+
+void test_jsmn_stream_bind_any_split(void)
+{
+    const char *json =
+        "{\"label\": \"pwm\", \"skipped\": {\"id\": 7, \"list\": [1, 2]}, \"id\": -1234,"
+        " \"serial\": 9007199254740993, \"flags\": 4294967295, \"ports\": [\"A\", \"B\", \"C\"],"
+        " \"properties\": {\"period\": 50.5e-1, \"enabled\": true}}";
+    size_t length = strlen(json);
+
+    for (size_t split = 0; split <= length; split++)
+    {
+        memset(&operation, 0, sizeof(operation));
+        TEST_ASSERT_EQUAL(0, jsmn_stream_bind_init(&bind, bindings, 7, &operation));
+
+        TEST_ASSERT_EQUAL(0, jsmn_stream_bind_parse(&bind, json, split, NULL));
+        TEST_ASSERT_EQUAL(0, jsmn_stream_bind_parse(&bind, json + split, length - split, NULL));
+        TEST_ASSERT_EQUAL_HEX32(0x7f, bind.seen);
+        TEST_ASSERT_EQUAL_HEX32(0, bind.invalid);
+        TEST_ASSERT_EQUAL_HEX32(0, bind.truncated);
+
+        TEST_ASSERT_EQUAL(-1234, operation.id);
+        TEST_ASSERT_TRUE(operation.serial == 9007199254740993LL);
+        TEST_ASSERT_EQUAL_HEX32(UINT32_MAX, operation.flags);
+        TEST_ASSERT_EQUAL_DOUBLE(5.05, operation.period);
+        TEST_ASSERT_TRUE(operation.enabled);
+        TEST_ASSERT_EQUAL_STRING("pwm", operation.label);
+        TEST_ASSERT_EQUAL_STRING("B", operation.port);
+    }
+}
+
+void test_jsmn_stream_bind_missing_fields(void)
+{
+    const char *json = "{\"id\": 5, \"properties\": {\"enabled\": false}}";
+
+    operation.period = 1.5;
+    TEST_ASSERT_EQUAL(0, jsmn_stream_bind_init(&bind, bindings, 7, &operation));
+    TEST_ASSERT_EQUAL(0, jsmn_stream_bind_parse(&bind, json, strlen(json), NULL));
+    TEST_ASSERT_EQUAL_HEX32((1 << 0) | (1 << 4), bind.seen);
+    TEST_ASSERT_EQUAL(5, operation.id);
+    TEST_ASSERT_FALSE(operation.enabled);
+    TEST_ASSERT_EQUAL_DOUBLE(1.5, operation.period);
+}
+
+void test_jsmn_stream_bind_wrong_types(void)
+{
+    const char *json =
+        "{\"id\": 2147483648, \"flags\": -1, \"serial\": 1.5, \"label\": 3,"
+        " \"properties\": {\"period\": \"50\", \"enabled\": null}, \"ports\": [\"A\", {\"x\": 1}]}";
+
+    operation.id = 9;
+    TEST_ASSERT_EQUAL(0, jsmn_stream_bind_init(&bind, bindings, 7, &operation));
+    TEST_ASSERT_EQUAL(0, jsmn_stream_bind_parse(&bind, json, strlen(json), NULL));
+    TEST_ASSERT_EQUAL_HEX32(0, bind.seen);
+    TEST_ASSERT_EQUAL_HEX32(0x6f, bind.invalid);
+    TEST_ASSERT_EQUAL(9, operation.id);
+}
+
+void test_jsmn_stream_bind_skips_objects_and_arrays(void)
+{
+    char json[JSMN_STREAM_BUFFER_SIZE * 3];
+    size_t key_length = JSMN_STREAM_BUFFER_SIZE * 2;
+
+    // the long key inside the bound value is skipped, not reported
+    strcpy(json, "{\"label\": {\"");
+    memset(json + 12, 'k', key_length);
+    strcpy(json + 12 + key_length, "\": [\"x\"]}, \"id\": 4}");
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_bind_init(&bind, bindings, 7, &operation));
+    TEST_ASSERT_EQUAL(0, jsmn_stream_bind_parse(&bind, json, strlen(json), NULL));
+    TEST_ASSERT_EQUAL_HEX32(0x01, bind.seen);
+    TEST_ASSERT_EQUAL_HEX32(0x20, bind.invalid);
+    TEST_ASSERT_EQUAL(4, operation.id);
+    TEST_ASSERT_EQUAL_STRING("", operation.label);
+}
+
+void test_jsmn_stream_bind_decoded_strings(void)
+{
+    const char *json = "{\"label\": \"a\\\"b\\u00e9\", \"ports\": [\"A\", \"\\u0042\"]}";
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_bind_init(&bind, bindings, 7, &operation));
+    TEST_ASSERT_EQUAL(0, jsmn_stream_bind_parse(&bind, json, strlen(json), NULL));
+    TEST_ASSERT_EQUAL_HEX32(0x60, bind.seen);
+    TEST_ASSERT_EQUAL_HEX32(0, bind.invalid);
+    TEST_ASSERT_EQUAL_STRING("a\"b\xc3\xa9", operation.label);
+    TEST_ASSERT_EQUAL_STRING("B", operation.port);
+}
+
+void test_jsmn_stream_bind_truncated_strings(void)
+{
+    char json[JSMN_STREAM_BUFFER_SIZE * 3];
+    size_t label_length = sizeof(json) - 64;
+    size_t prefix_length;
+
+    // the label is too long for the parser buffer, so it comes in fragments
+    strcpy(json, "{\"ports\": [\"A\", \"BC\"], \"label\": \"");
+    prefix_length = strlen(json);
+    memset(json + prefix_length, 'x', label_length);
+    strcpy(json + prefix_length + label_length, "\"}");
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_bind_init(&bind, bindings, 7, &operation));
+    TEST_ASSERT_EQUAL(0, jsmn_stream_bind_parse(&bind, json, strlen(json), NULL));
+    TEST_ASSERT_EQUAL_HEX32((1 << 5) | (1 << 6), bind.seen);
+    TEST_ASSERT_EQUAL_HEX32((1 << 5) | (1 << 6), bind.truncated);
+    TEST_ASSERT_EQUAL_STRING("xxxxxxx", operation.label);
+    TEST_ASSERT_EQUAL_STRING("B", operation.port);
+}
+
+void test_jsmn_stream_bind_invalid_bindings(void)
+{
+    jsmn_stream_binding_t empty_string = { "/label", 0, JSMN_STREAM_BIND_STRING, 0 };
+    jsmn_stream_binding_t relative = { "label", 0, JSMN_STREAM_BIND_INT32, 4 };
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_bind_init(&bind, &empty_string, 1, &operation));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_bind_init(&bind, &relative, 1, &operation));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_bind_init(&bind, bindings, JSMN_STREAM_BIND_MAX_BINDINGS + 1, &operation));
+}
@@ -0,0 +1,180 @@
+#include "unity.h"
+
+/* The module to test */
+#include "jsmn_stream_filter.h"
+#include <stdio.h>
+#include <string.h>
+
+static char event_log[1024];
+static jsmn_stream_filter_t filter;
+
+static void log_event(const char *format, const char *value)
+{
+    size_t used = strlen(event_log);
+    snprintf(event_log + used, sizeof(event_log) - used, format, value);
+}
+
+static void log_match(void)
+{
+    char text[8];
+    snprintf(text, sizeof(text), "%d", jsmn_stream_filter_match(&filter));
+    log_event("#%s", text);
+}
+
+static void start_array(void *user_arg) { log_event("[%s", ""); }
+static void end_array(void *user_arg) { log_event("]%s", ""); }
+static void start_object(void *user_arg) { log_event("{%s", ""); }
+static void end_object(void *user_arg) { log_event("}%s", ""); }
+static void object_key(const char *key, size_t key_length, void *user_arg) { log_event("k(%s)", key); }
+static void string(const char *value, size_t length, void *user_arg) { log_match(); log_event("s(%s)", value); }
+static void primitive(const char *value, size_t length, void *user_arg) { log_match(); log_event("p(%s)", value); }
+
+static jsmn_stream_callbacks_t callbacks = {
+    .start_array_callback = start_array,
+    .end_array_callback = end_array,
+    .start_object_callback = start_object,
+    .end_object_callback = end_object,
+    .object_key_callback = object_key,
+    .string_callback = string,
+    .primitive_callback = primitive
+};
+
+static const char *json =
+    "{\"version\": 2, \"operations\": [{\"id\": \"a\", \"body\": {\"id\": \"x\", \"list\": [1, 2]}},"
+    " {\"body\": \"\\\"}]\", \"id\": \"b\"}, 7, {\"id\": {\"nested\": [true]}}],"
+    " \"meta\": {\"count\": 3, \"tags\": [\"p\", \"q\"]}}";
+
+void setUp(void)
+{
+    event_log[0] = '\0';
+}
+
+void tearDown(void)
+{
+
+}
+
+void test_jsmn_stream_filter_wildcard_any_split(void)
+{
+    const char *patterns[] = { "/operations/*/id", "/meta/tags/1" };
+    const char *expected = "#0s(a)#0s(b){k(nested)[#0p(true)]}#1s(q)";
+    size_t length = strlen(json);
+
+    for (size_t split = 0; split <= length; split++)
+    {
+        event_log[0] = '\0';
+        TEST_ASSERT_EQUAL(0, jsmn_stream_filter_init(&filter, patterns, 2, &callbacks, NULL));
+
+        TEST_ASSERT_EQUAL(0, jsmn_stream_filter_parse(&filter, json, split, NULL));
+        TEST_ASSERT_EQUAL(0, jsmn_stream_filter_parse(&filter, json + split, length - split, NULL));
+        TEST_ASSERT_EQUAL_STRING(expected, event_log);
+        TEST_ASSERT_EQUAL(0, filter.depth);
+    }
+}
+
+void test_jsmn_stream_filter_whole_subtrees(void)
+{
+    const char *patterns[] = { "/operations/0/body", "/version", "/operations/2" };
+    size_t consumed = 0;
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_filter_init(&filter, patterns, 3, &callbacks, NULL));
+    TEST_ASSERT_EQUAL(0, jsmn_stream_filter_parse(&filter, json, strlen(json), &consumed));
+    TEST_ASSERT_EQUAL(strlen(json), consumed);
+    TEST_ASSERT_EQUAL_STRING("#1p(2){k(id)#0s(x)k(list)[#0p(1)#0p(2)]}#2p(7)", event_log);
+}
+
+void test_jsmn_stream_filter_whole_document(void)
+{
+    const char *patterns[] = { "" };
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_filter_init(&filter, patterns, 1, &callbacks, NULL));
+    TEST_ASSERT_EQUAL(0, jsmn_stream_filter_parse(&filter, "[1, {\"a\": \"b\"}]", 15, NULL));
+    TEST_ASSERT_EQUAL_STRING("[#0p(1){k(a)#0s(b)}]", event_log);
+}
+
+void test_jsmn_stream_filter_invalid_patterns(void)
+{
+    const char *relative[] = { "operations/id" };
+    const char *too_deep[] = { "/a/b/c/d/e/f/g/h/i/j/k/l/m/n/o/p/q" };
+    const char *patterns[JSMN_STREAM_FILTER_MAX_PATTERNS + 1] = { 0 };
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_filter_init(&filter, relative, 1, &callbacks, NULL));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_filter_init(&filter, too_deep, 1, &callbacks, NULL));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_filter_init(&filter, patterns, JSMN_STREAM_FILTER_MAX_PATTERNS + 1, &callbacks, NULL));
+}
+
+static void object_key_decoded(const char *key, size_t key_length, size_t offset, bool escaped, void *user_arg)
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%.*s", (int)key_length, key);
+    log_event("k(%s)", text);
+}
+
+static void string_decoded(const char *value, size_t length, size_t offset, bool escaped, void *user_arg)
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%.*s", (int)length, value);
+    log_match();
+    log_event("s(%s)", text);
+}
+
+void test_jsmn_stream_filter_decoded_callbacks(void)
+{
+    const char *patterns[] = { "/a", "/b" };
+    jsmn_stream_callbacks_t decoded_callbacks = {
+        .object_key_decoded_callback = object_key_decoded,
+        .string_decoded_callback = string_decoded
+    };
+    // keys are matched decoded too, "\u0061" is "a"
+    const char *escaped = "{\"\\u0061\": \"x\\u00e9y\", \"b\": [\"c\\\"d\", {\"e\": 1}], \"c\": \"z\"}";
+    size_t length = strlen(escaped);
+
+    for (size_t split = 0; split <= length; split++)
+    {
+        event_log[0] = '\0';
+        TEST_ASSERT_EQUAL(0, jsmn_stream_filter_init(&filter, patterns, 2, &decoded_callbacks, NULL));
+        TEST_ASSERT_EQUAL(0, jsmn_stream_filter_parse(&filter, escaped, split, NULL));
+        TEST_ASSERT_EQUAL(0, jsmn_stream_filter_parse(&filter, escaped + split, length - split, NULL));
+        TEST_ASSERT_EQUAL_STRING("#0s(x\xc3\xa9y)#1s(c\"d)k(e)", event_log);
+    }
+}
+
+static jsmn_stream_action_t stop_event(jsmn_stream_event_t event, const char *value, size_t length, size_t offset, void *user_arg)
+{
+    return JSMN_STREAM_STOP;
+}
+
+static void stop_primitive(const char *value, size_t length, void *user_arg)
+{
+    log_event("p(%s)", value);
+    jsmn_stream_stop(&filter.stream_parser);
+}
+
+void test_jsmn_stream_filter_stop(void)
+{
+    const char *patterns[] = { "/*/id" };
+    jsmn_stream_callbacks_t event_callbacks = { .event_callback = stop_event };
+    jsmn_stream_callbacks_t stopping_callbacks = { .primitive_callback = stop_primitive };
+    const char *records = "[{\"id\": 1, \"x\": [2]}, {\"id\": 3}]";
+    size_t consumed = 0;
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_filter_init(&filter, patterns, 1, &event_callbacks, NULL));
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_filter_init(&filter, patterns, 1, &stopping_callbacks, NULL));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_STOPPED, jsmn_stream_filter_parse(&filter, records, strlen(records), &consumed));
+    TEST_ASSERT_EQUAL(9, consumed);
+    TEST_ASSERT_EQUAL_STRING("p(1)", event_log);
+}
+
+void test_jsmn_stream_filter_parse_error(void)
+{
+    const char *patterns[] = { "/a" };
+    /* Skipped arrays are not checked, the rest of the document is */
+    const char *invalid = "{\"b\": [1, x], x, \"a\": 1}";
+    size_t consumed = 0;
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_filter_init(&filter, patterns, 1, &callbacks, NULL));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_filter_parse(&filter, invalid, strlen(invalid), &consumed));
+    TEST_ASSERT_EQUAL(14, consumed);
+    TEST_ASSERT_EQUAL_STRING("", event_log);
+}
@@ -0,0 +1,294 @@
+#include "unity.h"
+
+/* The module to test */
+#include "jsmn_stream_ndjson.h"
+#include <stdio.h>
+#include <string.h>
+
+static char event_log[16384];
+
+static void log_event(const char *format, const char *value)
+{
+    size_t used = strlen(event_log);
+    snprintf(event_log + used, sizeof(event_log) - used, format, value);
+}
+
+static void log_range(const char *format, size_t first, size_t second)
+{
+    char text[48];
+    snprintf(text, sizeof(text), format, first, second);
+    log_event("%s", text);
+}
+
+static void start_array(void *user_arg) { log_event("[%s", ""); }
+static void end_array(void *user_arg) { log_event("]%s", ""); }
+static void start_object(void *user_arg) { log_event("{%s", ""); }
+static void end_object(void *user_arg) { log_event("}%s", ""); }
+static void object_key(const char *key, size_t key_length, void *user_arg) { log_event("k(%s)", key); }
+static void string(const char *value, size_t length, void *user_arg) { log_event("s(%s)", value); }
+static void primitive(const char *value, size_t length, void *user_arg) { log_event("p(%s)", value); }
+static void document_end(size_t start, size_t end, void *user_arg) { log_range("d(%zu,%zu)", start, end); }
+static void record_error(size_t offset, int error, void *user_arg) { log_range("E(%zu,%zu)", offset, (size_t)-error); }
+
+static jsmn_stream_callbacks_t callbacks = {
+    .start_array_callback = start_array,
+    .end_array_callback = end_array,
+    .start_object_callback = start_object,
+    .end_object_callback = end_object,
+    .object_key_callback = object_key,
+    .string_callback = string,
+    .primitive_callback = primitive,
+    .document_end_callback = document_end
+};
+
+static const char *lines = "{\"a\": 1}\n[1, x, 2]\n\"ok\"\n{\"b\": \n7 8\n";
+
+void setUp(void)
+{
+    event_log[0] = '\0';
+}
+
+void tearDown(void)
+{
+
+}
+
+void test_jsmn_stream_ndjson_resync_any_split(void)
+{
+    const char *expected = "{k(a)p(1)}d(0,8)[p(1)E(13,2)s(ok)d(19,23){k(b)E(30,2)p(7)d(31,32)p(8)d(33,34)";
+    size_t length = strlen(lines);
+
+    for (size_t split = 0; split <= length; split++)
+    {
+        jsmn_stream_ndjson_t ndjson;
+        size_t consumed = 0;
+        event_log[0] = '\0';
+        jsmn_stream_ndjson_init(&ndjson, &callbacks, NULL, record_error);
+
+        TEST_ASSERT_EQUAL(0, jsmn_stream_ndjson_parse(&ndjson, lines, split, &consumed));
+        TEST_ASSERT_EQUAL(split, consumed);
+        TEST_ASSERT_EQUAL(0, jsmn_stream_ndjson_parse(&ndjson, lines + split, length - split, &consumed));
+        TEST_ASSERT_EQUAL(length - split, consumed);
+        TEST_ASSERT_EQUAL(0, jsmn_stream_ndjson_finish(&ndjson));
+        TEST_ASSERT_EQUAL_STRING(expected, event_log);
+        TEST_ASSERT_EQUAL(2, ndjson.errors);
+        TEST_ASSERT_EQUAL(length + 1, ndjson.stream_parser.position);
+    }
+}
+
+void test_jsmn_stream_ndjson_finish(void)
+{
+    jsmn_stream_ndjson_t ndjson;
+
+    jsmn_stream_ndjson_init(&ndjson, &callbacks, NULL, record_error);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_ndjson_parse(&ndjson, "[1]\n7", 5, NULL));
+    TEST_ASSERT_EQUAL_STRING("[p(1)]d(0,3)", event_log);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_ndjson_finish(&ndjson));
+    TEST_ASSERT_EQUAL_STRING("[p(1)]d(0,3)p(7)d(4,5)", event_log);
+
+    event_log[0] = '\0';
+    jsmn_stream_ndjson_init(&ndjson, &callbacks, NULL, record_error);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_ndjson_parse(&ndjson, "[\"a", 3, NULL));
+    TEST_ASSERT_EQUAL(0, jsmn_stream_ndjson_finish(&ndjson));
+    TEST_ASSERT_EQUAL_STRING("[E(3,2)", event_log);
+    TEST_ASSERT_EQUAL(1, ndjson.errors);
+}
+
+static const char *event_names[] = { "{", "}", "[", "]", "k", "s", "p", "d" };
+static size_t stop_at_document = (size_t)-1;
+
+static jsmn_stream_action_t log_any_event(jsmn_stream_event_t event, const char *value,
+    size_t length, size_t offset, void *user_arg)
+{
+    char text[48];
+
+    snprintf(text, sizeof(text), "%s%.*s@%zu ", event_names[event], value ? (int)length : 0, value ? value : "", offset);
+    log_event("%s", text);
+    if (event == JSMN_STREAM_EVENT_KEY && length == 4 && memcmp(value, "skip", 4) == 0)
+    {
+        return JSMN_STREAM_SKIP_VALUE;
+    }
+    if (event == JSMN_STREAM_EVENT_DOCUMENT_END && offset == stop_at_document)
+    {
+        return JSMN_STREAM_STOP;
+    }
+    return JSMN_STREAM_CONTINUE;
+}
+
+static jsmn_stream_callbacks_t event_callbacks = {
+    .event_callback = log_any_event
+};
+
+static char records[4096];
+
+static size_t make_records(void)
+{
+    size_t used = 0;
+
+    for (int r = 0; r < 60; r++)
+    {
+        const char *format = r % 7 == 3 ? "{\"id\": %d, \"bad\": [}\n" :
+            r % 5 == 1 ? "{\"skip\": [%d, {\"x\": 1}], \"id\": 2}\n" : "{\"id\": %d, \"tags\": [\"t\", null]}\n";
+        used += (size_t)snprintf(records + used, sizeof(records) - used, format, r);
+    }
+    return used;
+}
+
+void test_jsmn_stream_ndjson_parallel_ordered(void)
+{
+    static char sequential_log[sizeof(event_log)];
+    size_t length = make_records();
+    jsmn_stream_ndjson_t ndjson;
+    jsmn_stream_ndjson_parallel_t config = {
+        .callbacks = &event_callbacks,
+        .error_callback = record_error,
+        .threads = 4,
+        .slice_size = 100,
+        .ordered = true
+    };
+
+    jsmn_stream_ndjson_init(&ndjson, &event_callbacks, NULL, record_error);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_ndjson_parse(&ndjson, records, length, NULL));
+    TEST_ASSERT_EQUAL(0, jsmn_stream_ndjson_finish(&ndjson));
+    TEST_ASSERT_EQUAL(9, ndjson.errors);
+    strcpy(sequential_log, event_log);
+
+    for (size_t threads = 1; threads <= 4; threads++)
+    {
+        event_log[0] = '\0';
+        config.threads = threads;
+        TEST_ASSERT_EQUAL(0, jsmn_stream_ndjson_parse_parallel(records, length, &config));
+        TEST_ASSERT_EQUAL_STRING(sequential_log, event_log);
+    }
+}
+
+void test_jsmn_stream_ndjson_parallel_ordered_stop(void)
+{
+    size_t length = make_records();
+    jsmn_stream_ndjson_parallel_t config = {
+        .callbacks = &event_callbacks,
+        .threads = 3,
+        .slice_size = 64,
+        .ordered = true
+    };
+    const char *last;
+
+    /* The third record starts at 64 */
+    stop_at_document = 64;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_STOPPED, jsmn_stream_ndjson_parse_parallel(records, length, &config));
+    stop_at_document = (size_t)-1;
+    last = strrchr(event_log, 'd');
+    TEST_ASSERT_NOT_NULL(last);
+    TEST_ASSERT_EQUAL_STRING("d@64 ", last);
+
+    config.callbacks = &callbacks;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_ndjson_parse_parallel(records, length, &config));
+    config.threads = 0;
+    config.ordered = false;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_ndjson_parse_parallel(records, length, &config));
+}
+
+typedef struct {
+    size_t documents;
+    size_t errors;
+} worker_count_t;
+
+static void count_document(size_t start, size_t end, void *user_arg) { ((worker_count_t *)user_arg)->documents++; }
+static void count_error(size_t offset, int error, void *user_arg) { ((worker_count_t *)user_arg)->errors++; }
+
+void test_jsmn_stream_ndjson_parallel_unordered(void)
+{
+    static jsmn_stream_callbacks_t counting_callbacks = {
+        .document_end_callback = count_document
+    };
+    worker_count_t counts[3] = { 0 };
+    void *worker_args[3] = { &counts[0], &counts[1], &counts[2] };
+    size_t length = make_records();
+    jsmn_stream_ndjson_parallel_t config = {
+        .callbacks = &counting_callbacks,
+        .error_callback = count_error,
+        .worker_args = worker_args,
+        .threads = 3,
+        .slice_size = 128
+    };
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_ndjson_parse_parallel(records, length, &config));
+    TEST_ASSERT_EQUAL(51, counts[0].documents + counts[1].documents + counts[2].documents);
+    TEST_ASSERT_EQUAL(9, counts[0].errors + counts[1].errors + counts[2].errors);
+}
+
+static const char *array =
+    " [{\"a\": \"x,]\\\\\", \"b\": [1, [2, {}]]}, \"q\\\"[,\", -12.5e3, [], {\"c\": \"\\\\\\\\\"},"
+    " true, [[\"]\", \",\"], null], \"\\\\\", {}]\n";
+
+void test_jsmn_stream_ndjson_array_parallel_ordered(void)
+{
+    static char sequential_log[sizeof(event_log)];
+    const size_t slice_sizes[] = { 1, 2, 3, 5, 7, 16, 64, 1000 };
+    size_t length = strlen(array);
+    const char *first = strchr(array, '[') + 1;
+    const char *last = strrchr(array, ']');
+    jsmn_stream_parser parser;
+    jsmn_stream_ndjson_parallel_t config = {
+        .callbacks = &event_callbacks,
+        .error_callback = record_error,
+        .ordered = true
+    };
+
+    /* The elements parsed as documents one after the other */
+    jsmn_stream_init(&parser, &event_callbacks, NULL);
+    parser.position = (size_t)(first - array);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, first, (size_t)(last - first), NULL));
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, ",", 1, NULL));
+    strcpy(sequential_log, event_log);
+
+    for (size_t s = 0; s < sizeof(slice_sizes) / sizeof(slice_sizes[0]); s++)
+    {
+        for (size_t threads = 1; threads <= 3; threads++)
+        {
+            event_log[0] = '\0';
+            config.slice_size = slice_sizes[s];
+            config.threads = threads;
+            TEST_ASSERT_EQUAL(0, jsmn_stream_ndjson_parse_array_parallel(array, length, &config));
+            TEST_ASSERT_EQUAL_STRING(sequential_log, event_log);
+        }
+    }
+}
+
+void test_jsmn_stream_ndjson_array_parallel_unordered(void)
+{
+    static jsmn_stream_callbacks_t counting_callbacks = {
+        .document_end_callback = count_document
+    };
+    worker_count_t counts[2] = { 0 };
+    void *worker_args[2] = { &counts[0], &counts[1] };
+    jsmn_stream_ndjson_parallel_t config = {
+        .callbacks = &counting_callbacks,
+        .error_callback = count_error,
+        .worker_args = worker_args,
+        .threads = 2,
+        .slice_size = 8
+    };
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_ndjson_parse_array_parallel(array, strlen(array), &config));
+    TEST_ASSERT_EQUAL(9, counts[0].documents + counts[1].documents);
+    TEST_ASSERT_EQUAL(0, counts[0].errors + counts[1].errors);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_ndjson_parse_array_parallel("{\"a\": 1}", 8, &config));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_ndjson_parse_array_parallel("[1, 2", 5, &config));
+}
+
+void test_jsmn_stream_ndjson_array_parallel_malformed_element(void)
+{
+    const char *malformed = "[1, 2, {\"a\": x}, 4, 5, 6, 7, 8]";
+    jsmn_stream_ndjson_parallel_t config = {
+        .callbacks = &event_callbacks,
+        .error_callback = record_error,
+        .threads = 2,
+        .slice_size = 4,
+        .ordered = true
+    };
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_ndjson_parse_array_parallel(malformed, strlen(malformed), &config));
+    TEST_ASSERT_EQUAL_STRING("p1@1 d@1 p2@4 d@4 {@7 ka@9 E(13,2)", event_log);
+}
@@ -0,0 +1,169 @@
+#include "unity.h"
+
+/* The module to test, built with JSMN_STREAM_PACKED_STACK set in project.yml */
+#include "jsmn_stream.h"
+#include <string.h>
+
+#define DEEP_LEVELS (500U)
+
+static size_t objects_started;
+static size_t objects_ended;
+static size_t arrays_started;
+static size_t arrays_ended;
+static size_t keys;
+static size_t primitives;
+
+static void start_array(void *user_arg) { arrays_started++; }
+static void end_array(void *user_arg) { arrays_ended++; }
+static void start_object(void *user_arg) { objects_started++; }
+static void end_object(void *user_arg) { objects_ended++; }
+static void object_key(const char *key, size_t key_length, void *user_arg) { keys++; }
+static void primitive(const char *value, size_t length, void *user_arg) { primitives++; }
+
+static jsmn_stream_callbacks_t callbacks = {
+    .start_array_callback = start_array,
+    .end_array_callback = end_array,
+    .start_object_callback = start_object,
+    .end_object_callback = end_object,
+    .object_key_callback = object_key,
+    .primitive_callback = primitive
+};
+
+/* Alternating {"k":[{"k":[ ... 1 ... ]}]} levels */
+static char deep_json[DEEP_LEVELS * 7 + 2];
+
+static size_t build_deep_json(size_t levels)
+{
+    char *p = deep_json;
+
+    for (size_t i = 0; i < levels; i++)
+    {
+        if (i % 2 == 0)
+        {
+            memcpy(p, "{\"k\":", 5);
+            p += 5;
+        }
+        else
+        {
+            *p++ = '[';
+        }
+    }
+    *p++ = '1';
+    for (size_t i = levels; i > 0; i--)
+    {
+        *p++ = (i - 1) % 2 == 0 ? '}' : ']';
+    }
+    return p - deep_json;
+}
+
+void setUp(void)
+{
+    objects_started = 0;
+    objects_ended = 0;
+    arrays_started = 0;
+    arrays_ended = 0;
+    keys = 0;
+    primitives = 0;
+}
+
+void tearDown(void)
+{
+
+}
+
+void test_jsmn_stream_packed_stack_default_storage_size(void)
+{
+    jsmn_stream_parser parser;
+
+    /* 512 levels in the bytes that 32 levels of enums used to take */
+    TEST_ASSERT_EQUAL(512, JSMN_STREAM_MAX_DEPTH);
+    TEST_ASSERT_EQUAL(128, sizeof(parser.default_type_stack));
+}
+
+void test_jsmn_stream_packed_stack_deep_document(void)
+{
+    jsmn_stream_parser parser;
+    size_t length = build_deep_json(DEEP_LEVELS);
+    jsmn_stream_init(&parser, &callbacks, NULL);
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, deep_json, length, NULL));
+    TEST_ASSERT_EQUAL(0, parser.stack_height);
+    TEST_ASSERT_EQUAL(DEEP_LEVELS / 2, objects_started);
+    TEST_ASSERT_EQUAL(DEEP_LEVELS / 2, objects_ended);
+    TEST_ASSERT_EQUAL(DEEP_LEVELS / 2, arrays_started);
+    TEST_ASSERT_EQUAL(DEEP_LEVELS / 2, arrays_ended);
+    TEST_ASSERT_EQUAL(DEEP_LEVELS / 2, keys);
+    TEST_ASSERT_EQUAL(1, primitives);
+}
+
+void test_jsmn_stream_packed_stack_keys_share_levels(void)
+{
+    const char *json = "{\"a\":{\"b\":[1,{\"c\":2}],\"d\":3},\"e\":[[4]]}";
+    jsmn_stream_stack_t type_stack[JSMN_STREAM_STACK_WORDS(4)];
+    char buffer[8];
+    jsmn_stream_parser parser;
+
+    jsmn_stream_init_with_storage(&parser, &callbacks, NULL, buffer, sizeof(buffer), type_stack, 4);
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, json, strlen(json), NULL));
+    TEST_ASSERT_EQUAL(0, parser.stack_height);
+    TEST_ASSERT_EQUAL(5, keys);
+    TEST_ASSERT_EQUAL(4, primitives);
+}
+
+void test_jsmn_stream_packed_stack_max_depth(void)
+{
+    jsmn_stream_stack_t type_stack[JSMN_STREAM_STACK_WORDS(40)];
+    char buffer[8];
+    jsmn_stream_parser parser;
+    size_t consumed = 0;
+    size_t length = build_deep_json(41);
+
+    jsmn_stream_init_with_storage(&parser, &callbacks, NULL, buffer, sizeof(buffer), type_stack, 40);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_MAX_DEPTH, jsmn_stream_parse_buffer(&parser, deep_json, length, &consumed));
+    TEST_ASSERT_EQUAL(20 * 5 + 20, consumed);
+}
+
+void test_jsmn_stream_packed_stack_snapshot_format(void)
+{
+    // the same bytes as with the byte stack, see test_jsmn_stream.c
+    const unsigned char expected[] = { 'j', 's', 's', JSMN_STREAM_SNAPSHOT_VERSION, JSMN_STREAM_PARSING_STRING, 0, 0,
+        200, 1, 197, 1, 185, 1, 0, 0, 3, 3, 0x3B, 'a', 'b', 'c' };
+    unsigned char snapshot[64];
+    char document[300];
+    size_t written = 0;
+    jsmn_stream_parser parser;
+
+    memset(document, ' ', sizeof(document));
+    memcpy(document + 188, "{\"k\":[{\"k\":\"abc", 15);
+    jsmn_stream_init(&parser, &callbacks, NULL);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, document + 3, 200, NULL));
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_snapshot(&parser, snapshot, sizeof(snapshot), &written));
+    TEST_ASSERT_EQUAL(sizeof(expected), written);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, snapshot, sizeof(expected));
+}
+
+void test_jsmn_stream_packed_stack_snapshot_deep_document(void)
+{
+    static unsigned char snapshot[JSMN_STREAM_SNAPSHOT_MAX_SIZE(JSMN_STREAM_MAX_DEPTH, JSMN_STREAM_BUFFER_SIZE)];
+    jsmn_stream_parser parser;
+    size_t length = build_deep_json(DEEP_LEVELS);
+    size_t written = 0;
+
+    // resume with all levels open, the innermost object with its key
+    jsmn_stream_init(&parser, &callbacks, NULL);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, deep_json, DEEP_LEVELS / 2 * 6 + 1, NULL));
+    TEST_ASSERT_EQUAL(0, jsmn_stream_snapshot(&parser, snapshot, sizeof(snapshot), &written));
+    TEST_ASSERT_TRUE(written < 32 + DEEP_LEVELS / 4);
+
+    jsmn_stream_init(&parser, &callbacks, NULL);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_restore(&parser, snapshot, written));
+    TEST_ASSERT_EQUAL(DEEP_LEVELS, parser.stack_height);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_parse_buffer(&parser, deep_json + DEEP_LEVELS / 2 * 6 + 1, length - (DEEP_LEVELS / 2 * 6 + 1), NULL));
+    TEST_ASSERT_EQUAL(0, parser.stack_height);
+    TEST_ASSERT_EQUAL(DEEP_LEVELS / 2, objects_ended);
+    TEST_ASSERT_EQUAL(DEEP_LEVELS / 2, arrays_ended);
+    TEST_ASSERT_EQUAL(1, primitives);
+}
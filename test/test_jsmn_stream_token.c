@@ -5,6 +5,7 @@
 /* The module to test */
 #include "jsmn_stream_token.h"
 #include "jsmn_stream.h"
+#include <stdlib.h>
 #include <string.h>
 
 
@@ -260,6 +261,403 @@ void test_object_with_nested_objects(void)
 
 }
 
+void test_array_of_strings(void)
+{
+    char *json = "[\"GML\", \"XML\"]";
+
+    jsmn_stream_token_parser_t parser;
+    jsmn_streamtok_t tokens[3];
+
+    parse_tokens_helper(&parser, tokens, 3, json);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, parser.error);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ARRAY, tokens[0].type);
+    TEST_ASSERT_EQUAL(0, tokens[0].start);
+    TEST_ASSERT_EQUAL(14, tokens[0].end);
+    TEST_ASSERT_EQUAL(2, tokens[0].size);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_STRING, tokens[1].type);
+    TEST_ASSERT_EQUAL(2, tokens[1].start);
+    TEST_ASSERT_EQUAL(5, tokens[1].end);
+    TEST_ASSERT_EQUAL(0, tokens[1].parent_id);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_STRING, tokens[2].type);
+    TEST_ASSERT_EQUAL(9, tokens[2].start);
+    TEST_ASSERT_EQUAL(12, tokens[2].end);
+    TEST_ASSERT_EQUAL(0, tokens[2].parent_id);
+}
+
+void test_end_ids_link_siblings(void)
+{
+    char *json = "{\"a\": [1, {\"b\": 2}], \"c\": 3}";
+    int end_ids[] = { 9, 7, 7, 4, 7, 7, 7, 9, 9 };
+
+    jsmn_stream_token_parser_t parser;
+    jsmn_streamtok_t tokens[9];
+
+    parse_tokens_helper(&parser, tokens, 9, json);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, parser.error);
+    for (int i = 0; i < 9; i++)
+    {
+        TEST_ASSERT_EQUAL(end_ids[i], tokens[i].end_id);
+    }
+
+    TEST_ASSERT_EQUAL(1, jsmn_stream_token_next_child(&parser, 0, JSMN_STREAM_TOKEN_UNDEFINED));
+    TEST_ASSERT_EQUAL(7, jsmn_stream_token_next_child(&parser, 0, 1));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_UNDEFINED, jsmn_stream_token_next_child(&parser, 0, 7));
+    TEST_ASSERT_EQUAL(3, jsmn_stream_token_next_child(&parser, 2, JSMN_STREAM_TOKEN_UNDEFINED));
+    TEST_ASSERT_EQUAL(4, jsmn_stream_token_next_child(&parser, 2, 3));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_UNDEFINED, jsmn_stream_token_next_child(&parser, 2, 4));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_UNDEFINED, jsmn_stream_token_next_child(&parser, 3, JSMN_STREAM_TOKEN_UNDEFINED));
+}
+
+void test_next_child_of_open_tokens(void)
+{
+    const char *json = "{\"a\": [1, {\"b\"";
+
+    jsmn_stream_token_parser_t parser;
+    jsmn_streamtok_t tokens[9];
+
+    jsmn_stream_parse_tokens_init(&parser, tokens, 9);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_buffer(&parser, json, strlen(json), NULL));
+    TEST_ASSERT_EQUAL(6, parser.next_token);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_UNDEFINED, tokens[0].end_id);
+    TEST_ASSERT_EQUAL(1, jsmn_stream_token_next_child(&parser, 0, JSMN_STREAM_TOKEN_UNDEFINED));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_UNDEFINED, jsmn_stream_token_next_child(&parser, 0, 1));
+    TEST_ASSERT_EQUAL(4, jsmn_stream_token_next_child(&parser, 2, 3));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_UNDEFINED, jsmn_stream_token_next_child(&parser, 2, 4));
+}
+
+void test_parse_tokens_buffer_matches_char_by_char(void)
+{
+    jsmn_stream_token_parser_t char_parser;
+    jsmn_stream_token_parser_t buffer_parser;
+    jsmn_streamtok_t char_tokens[64];
+    jsmn_streamtok_t buffer_tokens[64];
+    size_t consumed = 0;
+
+    parse_tokens_helper(&char_parser, char_tokens, 64, (char *)json_data);
+
+    jsmn_stream_parse_tokens_init(&buffer_parser, buffer_tokens, 64);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_buffer(&buffer_parser, json_data, strlen(json_data), &consumed));
+    TEST_ASSERT_EQUAL(strlen(json_data), consumed);
+    TEST_ASSERT_EQUAL(char_parser.next_token, buffer_parser.next_token);
+    TEST_ASSERT_EQUAL(char_parser.char_count, buffer_parser.char_count);
+    TEST_ASSERT_EQUAL_MEMORY(char_tokens, buffer_tokens, sizeof(jsmn_streamtok_t) * char_parser.next_token);
+}
+
+void test_parse_tokens_buffer_reports_malformed_json(void)
+{
+    jsmn_stream_token_parser_t parser;
+    jsmn_streamtok_t tokens[JSMN_STREAM_MAX_DEPTH + 1];
+    char deep[JSMN_STREAM_MAX_DEPTH + 1];
+    size_t consumed = 0;
+
+    jsmn_stream_parse_tokens_init(&parser, tokens, JSMN_STREAM_MAX_DEPTH + 1);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_INVALID, jsmn_stream_parse_tokens_buffer(&parser, "{\"a\":\"x\\qy\",\"b\":2}", 18, &consumed));
+    TEST_ASSERT_EQUAL(8, consumed);
+    TEST_ASSERT_EQUAL(8, parser.char_count);
+    // the error sticks
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_INVALID, jsmn_stream_parse_tokens_buffer(&parser, "}", 1, NULL));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_INVALID, jsmn_stream_parse_tokens(&parser, ' '));
+
+    memset(deep, '[', sizeof(deep));
+    jsmn_stream_parse_tokens_init(&parser, tokens, JSMN_STREAM_MAX_DEPTH + 1);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_INVALID, jsmn_stream_parse_tokens_buffer(&parser, deep, sizeof(deep), &consumed));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_MAX_DEPTH, consumed);
+}
+
+void test_string_longer_than_stream_buffer(void)
+{
+    char json[JSMN_STREAM_BUFFER_SIZE * 3];
+    size_t value_length = sizeof(json) - 16;
+
+    jsmn_stream_token_parser_t parser;
+    jsmn_streamtok_t tokens[3];
+
+    strcpy(json, "{\"key\":\"");
+    memset(json + 8, 'x', value_length);
+    strcpy(json + 8 + value_length, "\"}");
+
+    parse_tokens_helper(&parser, tokens, 3, json);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, parser.error);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_STRING, tokens[2].type);
+    TEST_ASSERT_EQUAL(8, tokens[2].start);
+    TEST_ASSERT_EQUAL_HEX32(jsmn_stream_token_hash(JSMN_STREAM_TOKEN_HASH_SEED, "key", 3), tokens[1].hash);
+    TEST_ASSERT_EQUAL(8 + value_length, tokens[2].end);
+    TEST_ASSERT_EQUAL(1, tokens[2].parent_id);
+}
+
+void test_key_hash_of_key_longer_than_stream_buffer(void)
+{
+    char json[JSMN_STREAM_BUFFER_SIZE * 6];
+    size_t key_length = JSMN_STREAM_BUFFER_SIZE * 2 + 5;
+
+    jsmn_stream_token_parser_t parser;
+    jsmn_streamtok_t tokens[5];
+
+    // two long keys, so the hash of the first one must not leak into the second
+    strcpy(json, "{\"");
+    memset(json + 2, 'k', key_length);
+    strcpy(json + 2 + key_length, "\":1,\"");
+    memset(json + 7 + key_length, 'v', key_length);
+    strcpy(json + 7 + 2 * key_length, "\":2}");
+
+    parse_tokens_helper(&parser, tokens, 5, json);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, parser.error);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_KEY, tokens[1].type);
+    TEST_ASSERT_EQUAL_HEX32(jsmn_stream_token_hash(JSMN_STREAM_TOKEN_HASH_SEED, json + 2, key_length), tokens[1].hash);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_KEY, tokens[3].type);
+    TEST_ASSERT_EQUAL_HEX32(jsmn_stream_token_hash(JSMN_STREAM_TOKEN_HASH_SEED, json + 7 + key_length, key_length), tokens[3].hash);
+    TEST_ASSERT_EQUAL(0, tokens[2].hash);
+}
+
+static size_t live_blocks;
+static size_t bytes_limit = (size_t)-1;
+
+static void *test_malloc(size_t size, void *user_arg)
+{
+    if (size > bytes_limit)
+    {
+        return NULL;
+    }
+    live_blocks++;
+    return malloc(size);
+}
+
+static void *test_realloc(void *ptr, size_t size, void *user_arg)
+{
+    return size <= bytes_limit ? realloc(ptr, size) : NULL;
+}
+
+static void test_free(void *ptr, void *user_arg)
+{
+    live_blocks--;
+    free(ptr);
+}
+
+static const jsmn_stream_token_allocator_t test_allocator = {
+    .malloc = test_malloc,
+    .realloc = test_realloc,
+    .free = test_free
+};
+
+void test_growable_tokens_match_fixed_array(void)
+{
+    jsmn_stream_token_parser_t fixed_parser;
+    jsmn_stream_token_parser_t growable_parser;
+    jsmn_streamtok_t fixed_tokens[64];
+
+    parse_tokens_helper(&fixed_parser, fixed_tokens, 64, (char *)json_data);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_init_growable(&growable_parser, &test_allocator, 2));
+    TEST_ASSERT_EQUAL(2, growable_parser.num_tokens);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_buffer(&growable_parser, json_data, strlen(json_data), NULL));
+    TEST_ASSERT_EQUAL(fixed_parser.next_token, growable_parser.next_token);
+    TEST_ASSERT_EQUAL(64, growable_parser.num_tokens);
+    TEST_ASSERT_EQUAL(1, live_blocks);
+    TEST_ASSERT_EQUAL_MEMORY(fixed_tokens, growable_parser.tokens, sizeof(jsmn_streamtok_t) * fixed_parser.next_token);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_UNDEFINED, growable_parser.tokens[growable_parser.num_tokens - 1].type);
+
+    jsmn_stream_parse_tokens_free(&growable_parser);
+    TEST_ASSERT_NULL(growable_parser.tokens);
+    TEST_ASSERT_EQUAL(0, growable_parser.num_tokens);
+    TEST_ASSERT_EQUAL(0, live_blocks);
+}
+
+void test_growable_tokens_out_of_memory(void)
+{
+    jsmn_stream_token_parser_t parser;
+
+    bytes_limit = 8 * sizeof(jsmn_streamtok_t);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NOMEM, jsmn_stream_parse_tokens_init_growable(&parser, &test_allocator, 16));
+    TEST_ASSERT_EQUAL(0, parser.num_tokens);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_init_growable(&parser, &test_allocator, 4));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NOMEM, jsmn_stream_parse_tokens_buffer(&parser, json_data, strlen(json_data), NULL));
+    TEST_ASSERT_EQUAL(8, parser.num_tokens);
+    TEST_ASSERT_EQUAL(8, parser.next_token);
+    bytes_limit = (size_t)-1;
+
+    jsmn_stream_parse_tokens_free(&parser);
+    TEST_ASSERT_EQUAL(0, live_blocks);
+}
+
+void test_compact_tokens_match_token_array(void)
+{
+    jsmn_stream_token_parser_t array_parser;
+    jsmn_stream_token_parser_t compact_parser;
+    jsmn_stream_token_parser_t growable_parser;
+    jsmn_streamtok_t tokens[64];
+    uint8_t types[64];
+    jsmn_stream_token_offset_t starts[64];
+    jsmn_stream_token_offset_t lengths[64];
+    int32_t sizes[64];
+    int32_t parent_ids[64];
+    int32_t end_ids[64];
+    uint32_t hashes[64];
+    jsmn_stream_token_store_t store = { types, starts, lengths, sizes, parent_ids, end_ids, hashes };
+
+    parse_tokens_helper(&array_parser, tokens, 64, (char *)json_data);
+
+    jsmn_stream_parse_tokens_init_compact(&compact_parser, &store, 64);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_buffer(&compact_parser, json_data, strlen(json_data), NULL));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_init_compact_growable(&growable_parser, &test_allocator, 2));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_buffer(&growable_parser, json_data, strlen(json_data), NULL));
+    TEST_ASSERT_EQUAL(7, live_blocks);
+
+    TEST_ASSERT_EQUAL(array_parser.next_token, compact_parser.next_token);
+    TEST_ASSERT_EQUAL(array_parser.next_token, growable_parser.next_token);
+    for (int i = 0; i < array_parser.next_token; i++)
+    {
+        TEST_ASSERT_EQUAL(tokens[i].type, jsmn_stream_token_type(&compact_parser, i));
+        TEST_ASSERT_EQUAL(tokens[i].start, jsmn_stream_token_start(&compact_parser, i));
+        TEST_ASSERT_EQUAL(tokens[i].end, jsmn_stream_token_end(&compact_parser, i));
+        TEST_ASSERT_EQUAL(tokens[i].size, jsmn_stream_token_size(&compact_parser, i));
+        TEST_ASSERT_EQUAL(tokens[i].parent_id, jsmn_stream_token_parent(&compact_parser, i));
+        TEST_ASSERT_EQUAL(tokens[i].end_id, jsmn_stream_token_end_id(&compact_parser, i));
+        TEST_ASSERT_EQUAL_HEX32(tokens[i].hash, jsmn_stream_token_key_hash(&compact_parser, i));
+
+        TEST_ASSERT_EQUAL(tokens[i].type, jsmn_stream_token_type(&growable_parser, i));
+        TEST_ASSERT_EQUAL(tokens[i].start, jsmn_stream_token_start(&growable_parser, i));
+        TEST_ASSERT_EQUAL(tokens[i].end, jsmn_stream_token_end(&growable_parser, i));
+        TEST_ASSERT_EQUAL(tokens[i].size, jsmn_stream_token_size(&growable_parser, i));
+        TEST_ASSERT_EQUAL(tokens[i].parent_id, jsmn_stream_token_parent(&growable_parser, i));
+        TEST_ASSERT_EQUAL(tokens[i].end_id, jsmn_stream_token_end_id(&growable_parser, i));
+        TEST_ASSERT_EQUAL_HEX32(tokens[i].hash, jsmn_stream_token_key_hash(&growable_parser, i));
+    }
+
+    jsmn_stream_parse_tokens_free(&growable_parser);
+    TEST_ASSERT_EQUAL(0, live_blocks);
+}
+
+void test_compact_tokens_past_2_gb(void)
+{
+    const char *json = "[1, \"a\"]";
+    size_t base = (size_t)3 << 30;
+    jsmn_stream_token_parser_t array_parser;
+    jsmn_stream_token_parser_t compact_parser;
+    jsmn_streamtok_t tokens[3];
+    uint8_t types[3];
+    jsmn_stream_token_offset_t starts[3];
+    jsmn_stream_token_offset_t lengths[3];
+    int32_t sizes[3];
+    int32_t parent_ids[3];
+    int32_t end_ids[3];
+    uint32_t hashes[3];
+    jsmn_stream_token_store_t store = { types, starts, lengths, sizes, parent_ids, end_ids, hashes };
+
+    // pretend 3 GB of whitespace came before
+    jsmn_stream_parse_tokens_init(&array_parser, tokens, 3);
+    array_parser.stream_parser.position = base;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NOMEM, jsmn_stream_parse_tokens_buffer(&array_parser, json, strlen(json), NULL));
+
+    jsmn_stream_parse_tokens_init_compact(&compact_parser, &store, 3);
+    compact_parser.stream_parser.position = base;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_buffer(&compact_parser, json, strlen(json), NULL));
+    TEST_ASSERT_EQUAL(base + strlen(json), compact_parser.char_count);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ARRAY, jsmn_stream_token_type(&compact_parser, 0));
+    TEST_ASSERT_TRUE(jsmn_stream_token_start(&compact_parser, 0) == base);
+    TEST_ASSERT_TRUE(jsmn_stream_token_end(&compact_parser, 0) == base + 8);
+    TEST_ASSERT_EQUAL(2, jsmn_stream_token_size(&compact_parser, 0));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_PRIMITIVE, jsmn_stream_token_type(&compact_parser, 1));
+    TEST_ASSERT_TRUE(jsmn_stream_token_start(&compact_parser, 1) == base + 1);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_STRING, jsmn_stream_token_type(&compact_parser, 2));
+    TEST_ASSERT_TRUE(jsmn_stream_token_start(&compact_parser, 2) == base + 5);
+    TEST_ASSERT_TRUE(jsmn_stream_token_end(&compact_parser, 2) == base + 6);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_token_parent(&compact_parser, 2));
+}
+
+void test_snapshot_restores_into_either_store(void)
+{
+    jsmn_stream_token_parser_t array_parser;
+    jsmn_stream_token_parser_t parser;
+    jsmn_stream_token_parser_t resumed;
+    jsmn_streamtok_t tokens[64];
+    jsmn_streamtok_t partial_tokens[64];
+    static unsigned char snapshot[4096];
+    size_t length = strlen(json_data);
+
+    parse_tokens_helper(&array_parser, tokens, 64, (char *)json_data);
+
+    for (size_t split = 0; split <= length; split++)
+    {
+        size_t written = 0;
+
+        jsmn_stream_parse_tokens_init(&parser, partial_tokens, 64);
+        TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_buffer(&parser, json_data, split, NULL));
+        TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_snapshot(&parser, snapshot, sizeof(snapshot), &written));
+
+        TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_init_compact_growable(&resumed, &test_allocator, 2));
+        TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_restore(&resumed, snapshot, written));
+        TEST_ASSERT_EQUAL(parser.next_token, resumed.next_token);
+        TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_buffer(&resumed, json_data + split, length - split, NULL));
+
+        TEST_ASSERT_EQUAL(array_parser.next_token, resumed.next_token);
+        TEST_ASSERT_EQUAL(length, resumed.char_count);
+        for (int i = 0; i < array_parser.next_token; i++)
+        {
+            TEST_ASSERT_EQUAL(tokens[i].type, jsmn_stream_token_type(&resumed, i));
+            TEST_ASSERT_EQUAL(tokens[i].start, jsmn_stream_token_start(&resumed, i));
+            TEST_ASSERT_EQUAL(tokens[i].end, jsmn_stream_token_end(&resumed, i));
+            TEST_ASSERT_EQUAL(tokens[i].size, jsmn_stream_token_size(&resumed, i));
+            TEST_ASSERT_EQUAL(tokens[i].parent_id, jsmn_stream_token_parent(&resumed, i));
+            TEST_ASSERT_EQUAL(tokens[i].end_id, jsmn_stream_token_end_id(&resumed, i));
+            TEST_ASSERT_EQUAL_HEX32(tokens[i].hash, jsmn_stream_token_key_hash(&resumed, i));
+        }
+        jsmn_stream_parse_tokens_free(&resumed);
+    }
+    TEST_ASSERT_EQUAL(0, live_blocks);
+}
+
+void test_snapshot_restore_errors(void)
+{
+    const char *json = "[1, \"a\", {\"b\": ";
+    jsmn_stream_token_parser_t parser;
+    jsmn_streamtok_t tokens[8];
+    uint8_t types[8];
+    jsmn_stream_token_offset_t starts[8];
+    jsmn_stream_token_offset_t lengths[8];
+    int32_t sizes[8];
+    int32_t parent_ids[8];
+    int32_t end_ids[8];
+    uint32_t hashes[8];
+    jsmn_stream_token_store_t store = { types, starts, lengths, sizes, parent_ids, end_ids, hashes };
+    unsigned char snapshot[128];
+    size_t written = 0;
+
+    jsmn_stream_parse_tokens_init_compact(&parser, &store, 8);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_buffer(&parser, json, strlen(json), NULL));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NOMEM, jsmn_stream_token_snapshot(&parser, snapshot, 10, &written));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_snapshot(&parser, snapshot, sizeof(snapshot), &written));
+
+    // five tokens in a fixed array of four
+    jsmn_stream_parse_tokens_init(&parser, tokens, 4);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NOMEM, jsmn_stream_token_restore(&parser, snapshot, written));
+
+    jsmn_stream_parse_tokens_init(&parser, tokens, 8);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_INVALID, jsmn_stream_token_restore(&parser, snapshot, written - 1));
+    snapshot[3]++;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_INVALID, jsmn_stream_token_restore(&parser, snapshot, written));
+    snapshot[3]--;
+
+    jsmn_stream_parse_tokens_init(&parser, tokens, 8);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_restore(&parser, snapshot, written));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_buffer(&parser, "2}]", 3, NULL));
+    TEST_ASSERT_EQUAL(6, parser.next_token);
+    TEST_ASSERT_EQUAL(3, tokens[0].size);
+    TEST_ASSERT_EQUAL(6, tokens[0].end_id);
+    TEST_ASSERT_EQUAL(18, tokens[0].end);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_KEY, tokens[4].type);
+    TEST_ASSERT_EQUAL_HEX32(jsmn_stream_token_hash(JSMN_STREAM_TOKEN_HASH_SEED, "b", 1), tokens[4].hash);
+    TEST_ASSERT_EQUAL(4, tokens[5].parent_id);
+}
+
 // ** These tests are not active. I used them to confirm
 // ** that the we get the same behaviour as the original
 // ** jsmn library. I'm leaving this here as a reference.
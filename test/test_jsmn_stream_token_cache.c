@@ -0,0 +1,153 @@
+#include "unity.h"
+
+/* The module to test */
+#include "jsmn_stream_token_cache.h"
+#include "jsmn_stream_token_utils.h"
+#include <stdint.h>
+#include <string.h>
+
+#define PAGE_SIZE 16
+#define NUM_PAGES 4
+
+const char *json_data =
+    "{\"id\": 1234, \"version\": 1, \"class\": \"pwm\", \"label\": \"instance of pwm\","
+    " \"properties\": {\"id\": \"PWMA\", \"period\": 50.5, \"polarity\": \"positive\"}}";
+
+static jsmn_stream_token_cache_t cache;
+static jsmn_stream_token_cache_page_t pages[NUM_PAGES];
+static char data[NUM_PAGES * PAGE_SIZE];
+static size_t backing_reads;
+static uint32_t failing_index = UINT32_MAX;
+
+static int32_t get_char_cb(uint32_t index, size_t length, void *user_arg, char *ch)
+{
+    const char *source = (const char *)user_arg;
+    backing_reads++;
+    if (index <= failing_index && index + length > failing_index)
+    {
+        return JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_FAIL;
+    }
+    memcpy(ch, &source[index], length);
+    return JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE;
+}
+
+void setUp(void)
+{
+    backing_reads = 0;
+    failing_index = UINT32_MAX;
+    jsmn_stream_token_cache_init(&cache, get_char_cb, (void *)json_data, strlen(json_data), pages, data, PAGE_SIZE, NUM_PAGES);
+}
+
+void tearDown(void)
+{
+
+}
+
+void test_jsmn_stream_token_cache_reads_match_source(void)
+{
+    size_t length = strlen(json_data);
+    char buffer[NUM_PAGES * PAGE_SIZE];
+
+    // every read that fits the cache, with pages evicted along the way
+    for (size_t read_length = 1; read_length <= sizeof(buffer); read_length += 7)
+    {
+        for (size_t index = 0; index + read_length <= length; index += 3)
+        {
+            TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE, jsmn_stream_token_cache_get_char((uint32_t)index, read_length, &cache, buffer));
+            TEST_ASSERT_EQUAL_MEMORY(json_data + index, buffer, read_length);
+        }
+    }
+    // the last page is shorter and is not read past the source
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE, jsmn_stream_token_cache_get_char((uint32_t)length - 1, 1, &cache, buffer));
+    TEST_ASSERT_EQUAL(json_data[length - 1], buffer[0]);
+}
+
+void test_jsmn_stream_token_cache_counts_and_evicts_least_recently_used(void)
+{
+    char buffer[PAGE_SIZE];
+
+    // pages 0 to 3 fill the cache
+    for (uint32_t page = 0; page < NUM_PAGES; page++)
+    {
+        jsmn_stream_token_cache_get_char(page * PAGE_SIZE + 1, 2, &cache, buffer);
+    }
+    TEST_ASSERT_EQUAL(0, cache.hits);
+    TEST_ASSERT_EQUAL(NUM_PAGES, cache.misses);
+
+    // page 0 becomes the most recently used, so page 4 evicts page 1
+    jsmn_stream_token_cache_get_char(3, 4, &cache, buffer);
+    jsmn_stream_token_cache_get_char(4 * PAGE_SIZE, 4, &cache, buffer);
+    TEST_ASSERT_EQUAL(1, cache.hits);
+    TEST_ASSERT_EQUAL(NUM_PAGES + 1, cache.misses);
+
+    jsmn_stream_token_cache_get_char(0, 1, &cache, buffer);
+    TEST_ASSERT_EQUAL(2, cache.hits);
+    jsmn_stream_token_cache_get_char(PAGE_SIZE, 1, &cache, buffer);
+    TEST_ASSERT_EQUAL(NUM_PAGES + 2, cache.misses);
+    TEST_ASSERT_EQUAL(NUM_PAGES + 2, backing_reads);
+
+    // a read spanning two cached pages is two hits
+    jsmn_stream_token_cache_get_char(PAGE_SIZE - 2, 4, &cache, buffer);
+    TEST_ASSERT_EQUAL(4, cache.hits);
+}
+
+void test_jsmn_stream_token_cache_read_error(void)
+{
+    char buffer[NUM_PAGES * PAGE_SIZE + 1];
+
+    failing_index = PAGE_SIZE + 3;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_FAIL, jsmn_stream_token_cache_get_char(PAGE_SIZE + 8, 2, &cache, buffer));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE, jsmn_stream_token_cache_get_char(0, 2, &cache, buffer));
+
+    // the failed page is read again once the backing store recovers
+    failing_index = UINT32_MAX;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE, jsmn_stream_token_cache_get_char(PAGE_SIZE + 8, 2, &cache, buffer));
+    TEST_ASSERT_EQUAL_MEMORY(json_data + PAGE_SIZE + 8, buffer, 2);
+
+    // bigger than the cache, straight to the backing store
+    backing_reads = 0;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_NONE, jsmn_stream_token_cache_get_char(0, sizeof(buffer), &cache, buffer));
+    TEST_ASSERT_EQUAL(1, backing_reads);
+    TEST_ASSERT_EQUAL_MEMORY(json_data, buffer, sizeof(buffer));
+}
+
+void test_jsmn_stream_token_cache_init_length_limit(void)
+{
+    jsmn_stream_token_cache_t large;
+
+    // the get char callback addresses up to 4 GB
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_cache_init(&large, get_char_cb, (void *)json_data, UINT32_MAX, pages, data, PAGE_SIZE, NUM_PAGES));
+#if SIZE_MAX > UINT32_MAX
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_INVALID, jsmn_stream_token_cache_init(&large, get_char_cb, (void *)json_data, (size_t)UINT32_MAX + 1, pages, data, PAGE_SIZE, NUM_PAGES));
+#endif
+}
+
+void test_jsmn_stream_token_cache_utils_lookups(void)
+{
+    jsmn_stream_token_parser_t parser;
+    jsmn_streamtok_t tokens[32];
+    jsmn_streamtok_t *value_token;
+    int32_t id;
+    double period;
+    char class[8] = {0};
+
+    jsmn_stream_parse_tokens_init(&parser, tokens, 32);
+    parser.cb = get_char_cb;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_parse_with_cb(&parser, strlen(json_data), (void *)json_data));
+
+    parser.cb = jsmn_stream_token_cache_get_char;
+    parser.user_arg = &cache;
+    backing_reads = 0;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_int_by_key(&parser, tokens, "id", &id));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_string_by_key(&parser, tokens, "class", class));
+    TEST_ASSERT_EQUAL(1234, id);
+    TEST_ASSERT_EQUAL_STRING("pwm", class);
+    // the key and the value of "id", and "class", are all in the first three pages
+    TEST_ASSERT_EQUAL(3, backing_reads);
+    TEST_ASSERT_EQUAL(3, cache.misses);
+    TEST_ASSERT_TRUE(cache.hits > 0);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_value_token_by_key(&parser, tokens, "properties", &value_token));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_double_by_key(&parser, value_token, "period", &period));
+    TEST_ASSERT_EQUAL_DOUBLE(50.5, period);
+}
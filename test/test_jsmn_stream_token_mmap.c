@@ -0,0 +1,144 @@
+#include "unity.h"
+
+/* The module to test */
+#include "jsmn_stream_token_mmap.h"
+#include "jsmn_stream_token_utils.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+const char *json_data =
+    "{\"id\": 1234, \"class\": \"pwm\", \"enabled\": true,"
+    " \"properties\": {\"id\": \"PWMA\", \"period\": 50.5}}";
+
+static char path[] = "/tmp/test_jsmn_stream_token_mmap_XXXXXX";
+static jsmn_stream_token_parser_t parser;
+static jsmn_streamtok_t tokens[32];
+static jsmn_stream_token_mmap_t map;
+
+static void write_file(const char *data)
+{
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL(strlen(data), write(fd, data, strlen(data)));
+    close(fd);
+}
+
+void setUp(void)
+{
+    strcpy(path + strlen(path) - 6, "XXXXXX");
+    jsmn_stream_parse_tokens_init(&parser, tokens, 32);
+    // the utils must not fall back to the callback
+    parser.cb = NULL;
+}
+
+void tearDown(void)
+{
+    jsmn_stream_token_mmap_close(&map);
+    unlink(path);
+}
+
+void test_jsmn_stream_token_mmap_spans(void)
+{
+    const char *value;
+    size_t length;
+    int properties_id;
+    int32_t id;
+    bool enabled;
+
+    write_file(json_data);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_MMAP_ERROR_NONE, jsmn_stream_token_mmap_open(&map, path));
+    TEST_ASSERT_EQUAL(strlen(json_data), map.length);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_mmap_parse(&parser, &map));
+    TEST_ASSERT_EQUAL(strlen(json_data), parser.char_count);
+
+    // the spans point into the mapping
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_span_by_key(&parser, 0, "class", &value, &length));
+    TEST_ASSERT_EQUAL_PTR(map.data + (strstr(json_data, "pwm") - json_data), value);
+    TEST_ASSERT_EQUAL(3, length);
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_value_id_by_key(&parser, 0, "properties", &properties_id));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_span_by_key(&parser, properties_id, "id", &value, &length));
+    TEST_ASSERT_EQUAL(4, length);
+    TEST_ASSERT_EQUAL_MEMORY("PWMA", value, length);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_UTILS_ERROR_KEY_NOT_FOUND, jsmn_stream_token_utils_get_span_by_key(&parser, properties_id, "class", &value, &length));
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_span_from_id(&parser, properties_id, &value, &length));
+    TEST_ASSERT_EQUAL('{', value[0]);
+    TEST_ASSERT_EQUAL('}', value[length - 1]);
+
+    // the copying accessors read the mapping too
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_int_by_key(&parser, tokens, "id", &id));
+    TEST_ASSERT_EQUAL(1234, id);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_bool_by_key(&parser, tokens, "enabled", &enabled));
+    TEST_ASSERT_TRUE(enabled);
+}
+
+void test_jsmn_stream_token_mmap_spans_need_text(void)
+{
+    const char *value;
+    size_t length;
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_buffer(&parser, json_data, strlen(json_data), NULL));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_INVALID, jsmn_stream_token_utils_get_span_from_id(&parser, 2, &value, &length));
+
+    parser.text = json_data;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_span_from_id(&parser, 2, &value, &length));
+    TEST_ASSERT_EQUAL_PTR(json_data + 7, value);
+    TEST_ASSERT_EQUAL(4, length);
+}
+
+void test_jsmn_stream_token_mmap_malformed_files(void)
+{
+    static const char *files[] = {
+        "{\"a\":\"x\001y\",\"b\":2}",
+        "{\"a\":1,\"b\":[1,2",
+        "{\"a\":\"x",
+        "\"abc",
+        "",
+        " \n\t ",
+    };
+
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        write_file(files[i]);
+        TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_MMAP_ERROR_NONE, jsmn_stream_token_mmap_open(&map, path));
+        jsmn_stream_parse_tokens_init(&parser, tokens, 32);
+        TEST_ASSERT_EQUAL_MESSAGE(JSMN_STREAM_TOKEN_ERROR_INVALID, jsmn_stream_token_mmap_parse(&parser, &map), files[i]);
+        jsmn_stream_token_mmap_close(&map);
+        unlink(path);
+        strcpy(path + strlen(path) - 6, "XXXXXX");
+    }
+}
+
+void test_jsmn_stream_token_mmap_primitive_file(void)
+{
+    const char *value;
+    size_t length;
+
+    // the number is only complete at the end of the file
+    write_file("-12.5");
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_MMAP_ERROR_NONE, jsmn_stream_token_mmap_open(&map, path));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_mmap_parse(&parser, &map));
+    TEST_ASSERT_EQUAL(1, parser.next_token);
+    TEST_ASSERT_EQUAL(5, parser.char_count);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_span_from_id(&parser, 0, &value, &length));
+    TEST_ASSERT_EQUAL(5, length);
+    TEST_ASSERT_EQUAL_PTR(map.data, value);
+}
+
+void test_jsmn_stream_token_mmap_empty_and_missing_files(void)
+{
+    write_file("");
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_MMAP_ERROR_NONE, jsmn_stream_token_mmap_open(&map, path));
+    TEST_ASSERT_EQUAL(0, map.length);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_INVALID, jsmn_stream_token_mmap_parse(&parser, &map));
+    TEST_ASSERT_EQUAL(0, parser.next_token);
+    jsmn_stream_token_mmap_close(&map);
+
+    unlink(path);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_MMAP_ERROR_OPEN, jsmn_stream_token_mmap_open(&map, path));
+    TEST_ASSERT_NULL(map.data);
+}
@@ -39,13 +39,32 @@ const char* json_data = "{\n"
 "}";
 
 
+static size_t get_char_calls;
+
 static int32_t get_char_cb(uint32_t index, size_t length, void *user_arg, char *ch)
 {
+    get_char_calls++;
     const char *data = (const char *)user_arg;
     memcpy(ch, &data[index], length);
     return 0;
 }
 
+/**
+ * @brief Keys are looked up among the direct children of an object.
+ * 
+ */
+static jsmn_streamtok_t *get_operation(jsmn_stream_token_parser_t *parser, jsmn_streamtok_t *tokens, int index)
+{
+    jsmn_streamtok_t *array_token = NULL;
+    jsmn_streamtok_t *iterator_token = NULL;
+    jsmn_stream_token_utils_get_value_token_by_key(parser, tokens, "operations", &array_token);
+    for (int i = 0; i <= index; i++)
+    {
+        jsmn_stream_token_utils_array_get_next_object_token(parser, array_token, &iterator_token);
+    }
+    return iterator_token;
+}
+
 void setUp(void)
 {
 
@@ -105,7 +124,8 @@ void test_jsmn_stream_token_utils_get_value_token_by_key_success(void)
     jsmn_stream_parse_tokens_init(&parser, tokens, 100);
     jsmn_stream_token_utils_parse_with_cb(&parser, strlen(json_data), (void *)json_data);
 
-    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_value_token_by_key(&parser, tokens, "id", &value_token));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_value_token_by_key(&parser, tokens, "operations", &value_token));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ARRAY, value_token->type);
 }
 
 void test_jsmn_stream_token_utils_array_get_next_object_token_success(void)
@@ -133,7 +153,7 @@ void test_jsmn_stream_token_utils_get_string_from_token(void)
     char buffer[100] = {0};
     jsmn_stream_parse_tokens_init(&parser, tokens, 100);
     jsmn_stream_token_utils_parse_with_cb(&parser, strlen(json_data), (void *)json_data);
-    jsmn_stream_token_utils_get_value_token_by_key(&parser, tokens, "class", &value_token);
+    jsmn_stream_token_utils_get_value_token_by_key(&parser, get_operation(&parser, tokens, 0), "class", &value_token);
     TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_string_from_token(&parser, value_token, buffer));
     TEST_ASSERT_EQUAL_STRING("pwm", buffer);
 }
@@ -148,7 +168,7 @@ void test_jsmn_stream_token_utils_get_int_from_token(void)
     int32_t value;
     jsmn_stream_parse_tokens_init(&parser, tokens, 100);
     jsmn_stream_token_utils_parse_with_cb(&parser, strlen(json_data), (void *)json_data);
-    jsmn_stream_token_utils_get_value_token_by_key(&parser, tokens, "id", &value_token);
+    jsmn_stream_token_utils_get_value_token_by_key(&parser, get_operation(&parser, tokens, 0), "id", &value_token);
     TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_int_from_token(&parser, value_token, &value));
     TEST_ASSERT_EQUAL(1234, value);
 }
@@ -163,7 +183,8 @@ void test_jsmn_stream_token_utils_get_double_from_token(void)
     double value;
     jsmn_stream_parse_tokens_init(&parser, tokens, 100);
     jsmn_stream_token_utils_parse_with_cb(&parser, strlen(json_data), (void *)json_data);
-    jsmn_stream_token_utils_get_value_token_by_key(&parser, tokens, "period", &value_token);
+    jsmn_stream_token_utils_get_value_token_by_key(&parser, get_operation(&parser, tokens, 0), "operation properties", &value_token);
+    jsmn_stream_token_utils_get_value_token_by_key(&parser, value_token, "period", &value_token);
     TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_double_from_token(&parser, value_token, &value));
     TEST_ASSERT_EQUAL_DOUBLE(50.5, value);
 }
@@ -178,7 +199,189 @@ void test_jsmn_stream_token_utils_get_bool_from_token(void)
     bool value;
     jsmn_stream_parse_tokens_init(&parser, tokens, 100);
     jsmn_stream_token_utils_parse_with_cb(&parser, strlen(json_data), (void *)json_data);
-    jsmn_stream_token_utils_get_value_token_by_key(&parser, tokens, "enabled", &value_token);
+    jsmn_stream_token_utils_get_value_token_by_key(&parser, get_operation(&parser, tokens, 1), "operation properties", &value_token);
+    jsmn_stream_token_utils_get_value_token_by_key(&parser, value_token, "enabled", &value_token);
     TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_bool_from_token(&parser, value_token, &value));
     TEST_ASSERT_EQUAL(false, value);
-}
\ No newline at end of file
+}
+
+void test_jsmn_stream_token_utils_compact_store(void)
+{
+    jsmn_stream_token_parser_t parser;
+    uint8_t types[100];
+    jsmn_stream_token_offset_t starts[100];
+    jsmn_stream_token_offset_t lengths[100];
+    int32_t sizes[100];
+    int32_t parent_ids[100];
+    int32_t end_ids[100];
+    uint32_t hashes[100];
+    jsmn_stream_token_store_t store = { types, starts, lengths, sizes, parent_ids, end_ids, hashes };
+    int array_id;
+    int object_id = JSMN_STREAM_TOKEN_UNDEFINED;
+    int value_id;
+    int32_t value;
+    char buffer[100] = {0};
+    jsmn_stream_parse_tokens_init_compact(&parser, &store, 100);
+    parser.cb = get_char_cb;
+    parser.user_arg = (void *)json_data;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_parse_with_cb(&parser, strlen(json_data), (void *)json_data));
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_value_id_by_key(&parser, 0, "operations", &array_id));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_array_get_next_object_id(&parser, array_id, &object_id));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_array_get_next_object_id(&parser, array_id, &object_id));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_UTILS_ERROR_OBJECT_NOT_FOUND, jsmn_stream_token_utils_array_get_next_object_id(&parser, array_id, &object_id));
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_value_id_by_key(&parser, object_id, "id", &value_id));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_int_from_id(&parser, value_id, &value));
+    TEST_ASSERT_EQUAL(5678, value);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_value_id_by_key(&parser, object_id, "class", &value_id));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_string_from_id(&parser, value_id, buffer));
+    TEST_ASSERT_EQUAL_STRING("gpio", buffer);
+}
+
+static size_t text_base;
+static size_t based_calls;
+
+static int32_t based_get_char_cb(uint32_t index, size_t length, void *user_arg, char *ch)
+{
+    based_calls++;
+    return get_char_cb((uint32_t)(index - text_base), length, user_arg, ch);
+}
+
+void test_jsmn_stream_token_utils_callback_stops_at_4_gb(void)
+{
+    const char *json = "{\"a\": \"0123456789\", \"bc\": 1}";
+    jsmn_stream_token_parser_t parser;
+    uint8_t types[8];
+    jsmn_stream_token_offset_t starts[8];
+    jsmn_stream_token_offset_t lengths[8];
+    int32_t sizes[8];
+    int32_t parent_ids[8];
+    int32_t end_ids[8];
+    uint32_t hashes[8];
+    jsmn_stream_token_store_t store = { types, starts, lengths, sizes, parent_ids, end_ids, hashes };
+    int value_id;
+    char buffer[16];
+
+    // key "a" ends before 4 GB, its string crosses it and key "bc" is past it
+    text_base = UINT32_MAX - 10;
+    jsmn_stream_parse_tokens_init_compact(&parser, &store, 8);
+    parser.stream_parser.position = text_base;
+    parser.cb = based_get_char_cb;
+    parser.user_arg = (void *)json;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_parse_tokens_buffer(&parser, json, strlen(json), NULL));
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_value_id_by_key(&parser, 0, "a", &value_id));
+    based_calls = 0;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_UTILS_ERROR_INVALID, jsmn_stream_token_utils_get_string_from_id(&parser, value_id, buffer));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_UTILS_ERROR_INVALID, jsmn_stream_token_utils_get_value_id_by_key(&parser, 0, "bc", &value_id));
+    TEST_ASSERT_EQUAL(0, based_calls);
+}
+
+void test_jsmn_stream_token_utils_get_value_token_by_key_direct_children_only(void)
+{
+    jsmn_stream_token_parser_t parser;
+    parser.cb = get_char_cb;
+    parser.user_arg = (void *)json_data;
+    jsmn_streamtok_t tokens[100];
+    jsmn_streamtok_t *value_token;
+    jsmn_stream_parse_tokens_init(&parser, tokens, 100);
+    jsmn_stream_token_utils_parse_with_cb(&parser, strlen(json_data), (void *)json_data);
+
+    // "id" of the operation, not of its properties, and none at the root
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_UTILS_ERROR_KEY_NOT_FOUND, jsmn_stream_token_utils_get_value_token_by_key(&parser, tokens, "id", &value_token));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_UTILS_ERROR_KEY_NOT_FOUND, jsmn_stream_token_utils_get_value_token_by_key(&parser, get_operation(&parser, tokens, 1), "period", &value_token));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_value_token_by_key(&parser, get_operation(&parser, tokens, 1), "id", &value_token));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_PRIMITIVE, value_token->type);
+}
+
+void test_jsmn_stream_token_utils_get_value_token_by_key_reads_matching_key_only(void)
+{
+    jsmn_stream_token_parser_t parser;
+    parser.cb = get_char_cb;
+    parser.user_arg = (void *)json_data;
+    jsmn_streamtok_t tokens[100];
+    jsmn_streamtok_t *object_token;
+    jsmn_streamtok_t *value_token;
+    jsmn_stream_parse_tokens_init(&parser, tokens, 100);
+    jsmn_stream_token_utils_parse_with_cb(&parser, strlen(json_data), (void *)json_data);
+    object_token = get_operation(&parser, tokens, 1);
+
+    // "operation properties" is the last of five keys
+    get_char_calls = 0;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_get_value_token_by_key(&parser, object_token, "operation properties", &value_token));
+    TEST_ASSERT_EQUAL(1, get_char_calls);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_UTILS_ERROR_KEY_NOT_FOUND, jsmn_stream_token_utils_get_value_token_by_key(&parser, object_token, "missing", &value_token));
+    TEST_ASSERT_EQUAL(1, get_char_calls);
+}
+
+static int32_t failing_get_char_cb(uint32_t index, size_t length, void *user_arg, char *ch)
+{
+    return index >= 100 ? JSMN_STREAM_TOKEN_GET_CHAR_CB_ERROR_FAIL : get_char_cb(index, length, user_arg, ch);
+}
+
+void test_jsmn_stream_token_utils_parse_with_cb_blocks(void)
+{
+    jsmn_stream_token_parser_t parser;
+    jsmn_stream_token_parser_t buffer_parser;
+    jsmn_streamtok_t tokens[100];
+    jsmn_streamtok_t buffer_tokens[100];
+    char block[16];
+    size_t length = strlen(json_data);
+    jsmn_stream_parse_tokens_init(&parser, tokens, 100);
+    parser.cb = get_char_cb;
+    parser.user_arg = (void *)json_data;
+    jsmn_stream_parse_tokens_init(&buffer_parser, buffer_tokens, 100);
+    jsmn_stream_parse_tokens_buffer(&buffer_parser, json_data, length, NULL);
+
+    get_char_calls = 0;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_NONE, jsmn_stream_token_utils_parse_with_cb_blocks(&parser, length, (void *)json_data, block, sizeof(block)));
+    TEST_ASSERT_EQUAL((length + sizeof(block) - 1) / sizeof(block), get_char_calls);
+    TEST_ASSERT_EQUAL(buffer_parser.next_token, parser.next_token);
+    TEST_ASSERT_EQUAL_MEMORY(buffer_tokens, tokens, sizeof(jsmn_streamtok_t) * parser.next_token);
+}
+
+void test_jsmn_stream_token_utils_parse_with_cb_malformed(void)
+{
+    const char *json = "{\"a\":\"x\001y\",\"b\":2}";
+    jsmn_stream_token_parser_t parser;
+    jsmn_streamtok_t tokens[8];
+    char block[4];
+    jsmn_stream_parse_tokens_init(&parser, tokens, 8);
+    parser.cb = get_char_cb;
+    parser.user_arg = (void *)json;
+
+    get_char_calls = 0;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_INVALID, jsmn_stream_token_utils_parse_with_cb_blocks(&parser, strlen(json), (void *)json, block, sizeof(block)));
+    // reading stops with the block of the control character
+    TEST_ASSERT_EQUAL(2, get_char_calls);
+    TEST_ASSERT_EQUAL(7, parser.char_count);
+}
+
+void test_jsmn_stream_token_utils_parse_with_cb_past_4_gb(void)
+{
+    jsmn_stream_token_parser_t parser;
+    jsmn_streamtok_t tokens[8];
+    jsmn_stream_parse_tokens_init(&parser, tokens, 8);
+    parser.cb = get_char_cb;
+    parser.user_arg = (void *)json_data;
+
+#if SIZE_MAX > UINT32_MAX
+    get_char_calls = 0;
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_ERROR_INVALID, jsmn_stream_token_utils_parse_with_cb(&parser, (size_t)UINT32_MAX + 1, (void *)json_data));
+    TEST_ASSERT_EQUAL(0, get_char_calls);
+#endif
+}
+
+void test_jsmn_stream_token_utils_parse_with_cb_read_error(void)
+{
+    jsmn_stream_token_parser_t parser;
+    jsmn_streamtok_t tokens[100];
+    jsmn_stream_parse_tokens_init(&parser, tokens, 100);
+    parser.cb = failing_get_char_cb;
+    parser.user_arg = (void *)json_data;
+
+    TEST_ASSERT_EQUAL(JSMN_STREAM_TOKEN_UTILS_ERROR_READ, jsmn_stream_token_utils_parse_with_cb(&parser, strlen(json_data), (void *)json_data));
+    // the blocks before the first one starting at 100 were parsed
+    TEST_ASSERT_EQUAL((100 + JSMN_STREAM_TOKEN_UTILS_BLOCK_SIZE - 1) / JSMN_STREAM_TOKEN_UTILS_BLOCK_SIZE * JSMN_STREAM_TOKEN_UTILS_BLOCK_SIZE, parser.char_count);
+}
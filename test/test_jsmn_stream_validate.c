@@ -0,0 +1,230 @@
+#include "unity.h"
+
+/* The module to test */
+#include "jsmn_stream_validate.h"
+#include <stdio.h>
+#include <string.h>
+
+static jsmn_stream_validator_t validator;
+
+static const char *valid_documents[] = {
+    "{\"a\": [1, \"x\\\"y\", true, {\"b\": null}], \"c\": -2.5e3}",
+    " [ ] ",
+    "{}",
+    "\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 \\u00e9\\n\"",
+    "[0, -0, 0.5, 1e10, 1E+2, 2e-3, 123456789, -0.0e0]",
+    "[false, null, true, [[[]]], {\"\": {}}]\n",
+    "42",
+};
+
+/* Documents and the offset of their first error */
+static const struct {
+    const char *json;
+    size_t offset;
+    int error;
+} invalid_documents[] = {
+    { "[1, 2,]", 6, JSMN_STREAM_ERROR_INVAL },
+    { "{\"a\" 1}", 5, JSMN_STREAM_ERROR_INVAL },
+    { "{\"a\": 1,}", 8, JSMN_STREAM_ERROR_INVAL },
+    { "[1 2]", 3, JSMN_STREAM_ERROR_INVAL },
+    { "[1}", 2, JSMN_STREAM_ERROR_INVAL },
+    { "{1: 2}", 1, JSMN_STREAM_ERROR_INVAL },
+    { "[01]", 2, JSMN_STREAM_ERROR_INVAL },
+    { "[1.]", 3, JSMN_STREAM_ERROR_INVAL },
+    { "[-]", 2, JSMN_STREAM_ERROR_INVAL },
+    { "[1e]", 3, JSMN_STREAM_ERROR_INVAL },
+    { "[tru]", 4, JSMN_STREAM_ERROR_INVAL },
+    { "[truex]", 5, JSMN_STREAM_ERROR_INVAL },
+    { "[\"a\\x\"]", 4, JSMN_STREAM_ERROR_INVAL },
+    { "[\"\\u12g4\"]", 6, JSMN_STREAM_ERROR_INVAL },
+    { "[\"a\tb\"]", 3, JSMN_STREAM_ERROR_INVAL },
+    { "{} {}", 3, JSMN_STREAM_ERROR_INVAL },
+    { "]", 0, JSMN_STREAM_ERROR_INVAL },
+    { "\"\xc0\xaf\"", 1, JSMN_STREAM_ERROR_INVAL }, // overlong /
+    { "\"\xe0\x80\xaf\"", 2, JSMN_STREAM_ERROR_INVAL }, // overlong /
+    { "\"\xed\xa0\x80\"", 2, JSMN_STREAM_ERROR_INVAL }, // surrogate U+D800
+    { "\"\xf4\x90\x80\x80\"", 2, JSMN_STREAM_ERROR_INVAL }, // U+110000
+    { "\"\xff\"", 1, JSMN_STREAM_ERROR_INVAL },
+    { "\"a\x80\"", 2, JSMN_STREAM_ERROR_INVAL }, // continuation without lead
+    { "\"\xe2\x82\"", 3, JSMN_STREAM_ERROR_INVAL }, // cut by the quote
+    { "\"\xe2\x82\\n\"", 3, JSMN_STREAM_ERROR_INVAL }, // cut by an escape
+    { "[1, [2", 6, JSMN_STREAM_ERROR_PART },
+    { "\"\xe2\x82", 3, JSMN_STREAM_ERROR_PART },
+    { "-", 1, JSMN_STREAM_ERROR_PART },
+    { "  ", 2, JSMN_STREAM_ERROR_PART },
+};
+
+/* Validates in chunks of split characters */
+static int validate_in_chunks(const char *json, size_t length, size_t split)
+{
+    size_t i;
+    int error = 0;
+
+    jsmn_stream_validate_init(&validator);
+    for (i = 0; i < length && error == 0; i += split)
+    {
+        error = jsmn_stream_validate(&validator, json + i, length - i < split ? length - i : split);
+    }
+    if (error == 0)
+    {
+        error = jsmn_stream_validate_finish(&validator);
+    }
+    return error;
+}
+
+/* Plain byte at a time UTF-8 check, the reference for the vector scan */
+static size_t first_invalid_utf8(const unsigned char *data, size_t length)
+{
+    size_t i = 0;
+
+    while (i < length)
+    {
+        unsigned char c = data[i];
+        size_t n, k;
+        unsigned char low = 0x80, high = 0xbf;
+        if (c < 0x80) { i++; continue; }
+        if (c >= 0xc2 && c <= 0xdf) n = 1;
+        else if (c >= 0xe0 && c <= 0xef) { n = 2; if (c == 0xe0) low = 0xa0; if (c == 0xed) high = 0x9f; }
+        else if (c >= 0xf0 && c <= 0xf4) { n = 3; if (c == 0xf0) low = 0x90; if (c == 0xf4) high = 0x8f; }
+        else return i;
+        for (k = 1; k <= n; k++)
+        {
+            if (i + k >= length || data[i + k] < low || data[i + k] > high) return i + k;
+            low = 0x80;
+            high = 0xbf;
+        }
+        i += n + 1;
+    }
+    return length;
+}
+
+void setUp(void)
+{
+
+}
+
+void tearDown(void)
+{
+
+}
+
+void test_jsmn_stream_validate_valid_any_split(void)
+{
+    size_t d, split;
+
+    for (d = 0; d < sizeof(valid_documents) / sizeof(valid_documents[0]); d++)
+    {
+        size_t length = strlen(valid_documents[d]);
+        TEST_ASSERT_EQUAL(0, jsmn_stream_validate_buffer(valid_documents[d], length, NULL));
+        for (split = 1; split <= length; split++)
+        {
+            TEST_ASSERT_EQUAL_MESSAGE(0, validate_in_chunks(valid_documents[d], length, split), valid_documents[d]);
+            TEST_ASSERT_EQUAL(length, validator.position);
+        }
+    }
+}
+
+void test_jsmn_stream_validate_error_offset_any_split(void)
+{
+    size_t d, split, offset;
+
+    for (d = 0; d < sizeof(invalid_documents) / sizeof(invalid_documents[0]); d++)
+    {
+        const char *json = invalid_documents[d].json;
+        size_t length = strlen(json);
+
+        offset = 0;
+        TEST_ASSERT_EQUAL_MESSAGE(invalid_documents[d].error, jsmn_stream_validate_buffer(json, length, &offset), json);
+        TEST_ASSERT_EQUAL_MESSAGE(invalid_documents[d].offset, offset, json);
+        for (split = 1; split <= length; split++)
+        {
+            TEST_ASSERT_EQUAL_MESSAGE(invalid_documents[d].error, validate_in_chunks(json, length, split), json);
+            TEST_ASSERT_EQUAL_MESSAGE(invalid_documents[d].offset, validator.position, json);
+        }
+        // the error sticks
+        TEST_ASSERT_EQUAL(invalid_documents[d].error, jsmn_stream_validate(&validator, "1", 1));
+        TEST_ASSERT_EQUAL(invalid_documents[d].error, jsmn_stream_validate_finish(&validator));
+    }
+}
+
+void test_jsmn_stream_validate_max_depth(void)
+{
+    char json[JSMN_STREAM_VALIDATE_MAX_DEPTH * 2 + 2];
+    size_t offset;
+
+    memset(json, '[', JSMN_STREAM_VALIDATE_MAX_DEPTH);
+    memset(json + JSMN_STREAM_VALIDATE_MAX_DEPTH, ']', JSMN_STREAM_VALIDATE_MAX_DEPTH);
+    TEST_ASSERT_EQUAL(0, jsmn_stream_validate_buffer(json, JSMN_STREAM_VALIDATE_MAX_DEPTH * 2, NULL));
+
+    memset(json, '[', JSMN_STREAM_VALIDATE_MAX_DEPTH + 1);
+    memset(json + JSMN_STREAM_VALIDATE_MAX_DEPTH + 1, ']', JSMN_STREAM_VALIDATE_MAX_DEPTH + 1);
+    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_MAX_DEPTH, jsmn_stream_validate_buffer(json, JSMN_STREAM_VALIDATE_MAX_DEPTH * 2 + 2, &offset));
+    TEST_ASSERT_EQUAL(JSMN_STREAM_VALIDATE_MAX_DEPTH, offset);
+}
+
+void test_jsmn_stream_validate_long_strings(void)
+{
+    // multibyte sequences land on every offset of the vector blocks
+    static const char *pieces[] = { "a", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\\n", " " };
+    char json[1024];
+    size_t length = 0, piece = 0, split;
+
+    json[length++] = '"';
+    while (length < sizeof(json) - 8)
+    {
+        const char *p = pieces[piece++ % 6];
+        memcpy(json + length, p, strlen(p));
+        length += strlen(p);
+        piece += length % 3 == 0;
+    }
+    json[length++] = '"';
+
+    TEST_ASSERT_EQUAL(0, jsmn_stream_validate_buffer(json, length, NULL));
+    for (split = 1; split <= 70; split++)
+    {
+        TEST_ASSERT_EQUAL(0, validate_in_chunks(json, length, split));
+    }
+}
+
+void test_jsmn_stream_validate_utf8_matches_byte_at_a_time(void)
+{
+    // one bad byte at every position of a long multibyte string
+    static const unsigned char bad[] = { 0x80, 0xbf, 0xc0, 0xc1, 0xe0, 0xed, 0xf0, 0xf4, 0xf5, 0xff };
+    char json[300];
+    size_t length = 0, position, b, offset, split;
+
+    json[length++] = '"';
+    while (length < sizeof(json) - 4)
+    {
+        memcpy(json + length, "\xe2\x82\xac" "ab" "\xc3\xa9" "\xf0\x9f\x98\x80", 11);
+        length += 11;
+    }
+    json[length++] = '"';
+
+    for (position = 1; position < length - 1; position++)
+    {
+        for (b = 0; b < sizeof(bad); b++)
+        {
+            char saved = json[position];
+            size_t expected;
+            json[position] = (char)bad[b];
+            // the closing quote ends the string, and any sequence it cuts
+            expected = 1 + first_invalid_utf8((const unsigned char *)json + 1, length - 1);
+            if (expected == length)
+            {
+                TEST_ASSERT_EQUAL(0, jsmn_stream_validate_buffer(json, length, NULL));
+            }
+            else
+            {
+                TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, jsmn_stream_validate_buffer(json, length, &offset));
+                TEST_ASSERT_EQUAL(expected, offset);
+                for (split = 7; split <= 64; split += 19)
+                {
+                    TEST_ASSERT_EQUAL(JSMN_STREAM_ERROR_INVAL, validate_in_chunks(json, length, split));
+                    TEST_ASSERT_EQUAL(expected, validator.position);
+                }
+            }
+            json[position] = saved;
+        }
+    }
+}